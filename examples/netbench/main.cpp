@@ -0,0 +1,727 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/TcpSocket.h"
+#include "network/UdpSocket.h"
+#include "network/Fragmenter.h"
+#include "network/LoopbackSocket.h"
+#include "network/Reactor.h"
+#include "network/Replayer.h"
+#include "network/LinkConditioner.h"
+#include "network/MetricsReporter.h"
+#include "Log.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <random>
+#include <vector>
+#include <string.h>
+
+/*
+ *	netbench, load generator for the network backends
+ *
+ *	simulated clients send fixed size messages to an echo server at a given
+ *	rate, every message carries its send time so the round trip latency is
+ *	measured when its echo comes back. With a null rate each client sends its
+ *	next message as soon as the previous one is echoed.
+ *
+ *	the server and the clients run in the same process by default, -m server
+ *	and -m client split them so each side gets its own descriptors: SDL_net
+ *	polls with select, which can't watch descriptors above FD_SETSIZE.
+ *
+ *	-C degrades the link of the echo server, see LinkConditioner, to see how
+ *	the latency distribution holds under latency, loss and bandwidth caps.
+ *
+ *	the echo server can record its traffic with -o, a capture given with -f
+ *	is replayed instead of the synthetic clients, so the server can be run
+ *	under a production shaped load. -M logs the server socket metrics.
+ */
+
+using namespace	ExoEngine;
+using namespace	network;
+
+#define HEADER_SIZE	(sizeof(uint64_t) + sizeof(uint32_t))
+
+typedef struct	s_options
+{
+	std::string	backend;
+	std::string	mode;
+	std::string	host;
+	uint16_t	port;
+	size_t		clients;
+	size_t		size;
+	double		rate;
+	size_t		duration;
+	size_t		threads;
+	size_t		shards;
+	std::string	record;
+	std::string	capture;
+	double		speed;
+	std::string	link;
+	uint32_t	seed;
+	uint32_t	metrics;
+}				t_options;
+
+static uint64_t	now(void)
+{
+	return (std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/*
+ *	a thread driving a share of the clients
+ *
+ *	backends only connect, write and poll, received bytes go through
+ *	receive which cuts them back into messages, tcp may split or merge them
+ */
+class	Worker
+{
+	public:
+		Worker(const t_options &options, size_t first, size_t count) : sent(0), received(0), failed(0), _options(options), _first(first)
+		{
+			_clients.resize(count);
+		}
+		virtual ~Worker(void)
+		{
+		}
+
+		void	run(const std::atomic<bool> &running)
+		{
+			std::mt19937_64	random(_first);
+			uint64_t		period = _options.rate > 0 ? (uint64_t)(1e9 / _options.rate) : 0;
+			uint64_t		start = now();
+			uint64_t		current;
+
+			//	clients start at random offsets so the load isn't sent in bursts
+			for (size_t i = 0; i < _clients.size(); i++)
+			{
+				_clients[i].alive = true;
+				_clients[i].next = period ? start + random() % period : start;
+				if (!period)
+					send(i);
+			}
+			while (running)
+			{
+				if (period)
+				{
+					current = now();
+					for (size_t i = 0; i < _clients.size(); i++)
+						if (_clients[i].alive && _clients[i].next <= current)
+						{
+							send(i);
+							_clients[i].next += period;
+						}
+				}
+				poll();
+			}
+		}
+
+		std::vector<uint32_t>	latencies;
+		std::atomic<uint64_t>	sent;
+		std::atomic<uint64_t>	received;
+		std::atomic<uint64_t>	failed;
+	protected:
+		virtual void	write(size_t client, Message &&message) = 0;
+		virtual void	poll(void) = 0;
+
+		void	receive(size_t client, const void *data, size_t size)
+		{
+			std::vector<uint8_t>	&pending = _clients[client].pending;
+			const uint8_t			*ptr;
+			uint64_t				current = now();
+			uint64_t				time;
+			size_t					i;
+
+			if (pending.empty() && size == _options.size)
+				ptr = (const uint8_t *)data;
+			else
+			{
+				pending.insert(pending.end(), (const uint8_t *)data, (const uint8_t *)data + size);
+				ptr = pending.data();
+				size = pending.size();
+			}
+			for (i = 0; i + _options.size <= size; i += _options.size)
+			{
+				memcpy(&time, ptr + i, sizeof(time));
+				latencies.push_back((uint32_t)std::min<uint64_t>((current - time) / 1000, UINT32_MAX));
+				received++;
+				if (_options.rate <= 0 && _clients[client].alive)
+					send(client);
+			}
+			if (ptr == pending.data())
+				pending.erase(pending.begin(), pending.begin() + i);
+		}
+		void	close(size_t client)
+		{
+			if (_clients[client].alive)
+				failed++;
+			_clients[client].alive = false;
+		}
+
+		const t_options	&_options;
+		size_t			_first;
+	private:
+		typedef struct	s_client
+		{
+			std::vector<uint8_t>	pending;
+			uint64_t				next;
+			bool					alive;
+		}				t_client;
+
+		void	send(size_t client)
+		{
+			Message		message(_options.size);
+			uint64_t	time = now();
+			uint32_t	id = (uint32_t)(_first + client);
+
+			memcpy(&message[0], &time, sizeof(time));
+			memcpy(&message[sizeof(time)], &id, sizeof(id));
+			try
+			{
+				write(client, std::move(message));
+				sent++;
+			}
+			catch (const std::exception &e)
+			{
+				_log.error << "client " << id << ": " << e.what() << std::endl;
+				close(client);
+			}
+		}
+
+		std::vector<t_client>	_clients;
+};
+
+class	TcpWorker : public Worker
+{
+	public:
+		TcpWorker(const t_options &options, size_t first, size_t count) : Worker(options, first, count)
+		{
+			IPaddress	ip;
+
+			if (SDLNet_ResolveHost(&ip, options.host.c_str(), options.port))
+				throw (std::runtime_error(std::string("cannot resolve ").append(options.host).append(": ").append(SDLNet_GetError())));
+			_set = SDLNet_AllocSocketSet((int)count);
+			if (!_set)
+				throw (std::runtime_error(std::string("cannot allocate socket set: ").append(SDLNet_GetError())));
+			for (size_t i = 0; i < count; i++)
+			{
+				TCPsocket	socket = SDLNet_TCP_Open(&ip);
+
+				if (!socket)
+				{
+					clear();
+					throw (std::runtime_error(std::string("cannot connect client ").append(std::to_string(first + i)).append(": ").append(SDLNet_GetError())));
+				}
+				SDLNet_TCP_AddSocket(_set, socket);
+				_sockets.push_back(socket);
+			}
+		}
+		~TcpWorker(void)
+		{
+			clear();
+		}
+	protected:
+		virtual void	write(size_t client, Message &&message)
+		{
+			if (!_sockets[client])
+				throw (std::runtime_error("connection closed"));
+			if (SDLNet_TCP_Send(_sockets[client], message.getPtr(), (int)message.getSize()) < (int)message.getSize())
+				throw (std::runtime_error(std::string("cannot send: ").append(SDLNet_GetError())));
+		}
+		virtual void	poll(void)
+		{
+			char	buffer[65536];
+			int		ret;
+			int		read;
+
+			ret = SDLNet_CheckSockets(_set, 1);
+			for (size_t i = 0; i < _sockets.size() && ret > 0; i++)
+			{
+				if (!_sockets[i] || !SDLNet_SocketReady(_sockets[i]))
+					continue ;
+				ret--;
+				read = SDLNet_TCP_Recv(_sockets[i], buffer, sizeof(buffer));
+				if (read > 0)
+				{
+					receive(i, buffer, read);
+					continue ;
+				}
+				SDLNet_TCP_DelSocket(_set, _sockets[i]);
+				SDLNet_TCP_Close(_sockets[i]);
+				_sockets[i] = nullptr;
+				close(i);
+			}
+		}
+	private:
+		void	clear(void)
+		{
+			for (auto socket = _sockets.begin(); socket != _sockets.end(); socket++)
+				if (*socket)
+					SDLNet_TCP_Close(*socket);
+			_sockets.clear();
+			SDLNet_FreeSocketSet(_set);
+		}
+
+		SDLNet_SocketSet		_set;
+		std::vector<TCPsocket>	_sockets;
+};
+
+class	UdpWorker : public Worker
+{
+	public:
+		UdpWorker(const t_options &options, size_t first, size_t count) : Worker(options, first, count), _packet(nullptr)
+		{
+			if (SDLNet_ResolveHost(&_server, options.host.c_str(), options.port))
+				throw (std::runtime_error(std::string("cannot resolve ").append(options.host).append(": ").append(SDLNet_GetError())));
+			_set = SDLNet_AllocSocketSet((int)count);
+			if (!_set)
+				throw (std::runtime_error(std::string("cannot allocate socket set: ").append(SDLNet_GetError())));
+			_packet = SDLNet_AllocPacket((int)options.size + 1);
+			for (size_t i = 0; _packet && i < count; i++)
+			{
+				UDPsocket	socket = SDLNet_UDP_Open(0);
+
+				if (!socket)
+					break ;
+				SDLNet_UDP_AddSocket(_set, socket);
+				_sockets.push_back(socket);
+			}
+			if (_sockets.size() != count)
+			{
+				clear();
+				throw (std::runtime_error(std::string("cannot open udp socket: ").append(SDLNet_GetError())));
+			}
+		}
+		~UdpWorker(void)
+		{
+			clear();
+		}
+	protected:
+		//	sizes are kept under the mtu so datagrams are whole messages, see Fragmenter
+		virtual void	write(size_t client, Message &&message)
+		{
+			UDPpacket	packet;
+
+			_datagram.resize(message.getSize() + 1);
+			_datagram[0] = Fragmenter::WHOLE;
+			memcpy(_datagram.data() + 1, message.getPtr(), message.getSize());
+			packet.channel = -1;
+			packet.data = _datagram.data();
+			packet.len = (int)_datagram.size();
+			packet.maxlen = packet.len;
+			packet.address = _server;
+			if (!SDLNet_UDP_Send(_sockets[client], -1, &packet))
+				throw (std::runtime_error(std::string("cannot send: ").append(SDLNet_GetError())));
+		}
+		virtual void	poll(void)
+		{
+			int	ret;
+
+			ret = SDLNet_CheckSockets(_set, 1);
+			for (size_t i = 0; i < _sockets.size() && ret > 0; i++)
+			{
+				if (!SDLNet_SocketReady(_sockets[i]))
+					continue ;
+				ret--;
+				while (SDLNet_UDP_Recv(_sockets[i], _packet) == 1)
+					if (_packet->len && _packet->data[0] == Fragmenter::WHOLE)
+						receive(i, _packet->data + 1, _packet->len - 1);
+			}
+		}
+	private:
+		void	clear(void)
+		{
+			for (auto socket = _sockets.begin(); socket != _sockets.end(); socket++)
+				SDLNet_UDP_Close(*socket);
+			_sockets.clear();
+			if (_packet)
+				SDLNet_FreePacket(_packet);
+			SDLNet_FreeSocketSet(_set);
+		}
+
+		IPaddress				_server;
+		SDLNet_SocketSet		_set;
+		UDPpacket				*_packet;
+		std::vector<UDPsocket>	_sockets;
+		std::vector<uint8_t>	_datagram;
+};
+
+class	LoopbackWorker : public Worker
+{
+	public:
+		LoopbackWorker(const t_options &options, size_t first, size_t count) : Worker(options, first, count), _socket(count)
+		{
+			_socket.attachData(this);
+			_socket.setTimeout(1);
+			_socket.setClientAddCb(onAdd);
+			_socket.setClientDelCb(onDel);
+			_socket.setMessageReceiveCb(onReceive);
+			for (size_t i = 0; i < count; i++)
+				_socket.connect(options.host, options.port);
+		}
+	protected:
+		virtual void	write(size_t client, Message &&message)
+		{
+			_socket.send(_peers[client], std::move(message));
+		}
+		virtual void	poll(void)
+		{
+			_socket.pollEvent(SOCKET_ALLOW_READ);
+		}
+	private:
+		static void	onAdd(ISocket &socket, IClient *client)
+		{
+			LoopbackWorker	*worker = (LoopbackWorker *)socket.getData();
+
+			client->attachData((void *)worker->_peers.size());
+			worker->_peers.push_back(client);
+		}
+		static void	onDel(ISocket &socket, IClient *client)
+		{
+			((LoopbackWorker *)socket.getData())->close((size_t)client->getData());
+		}
+		static void	onReceive(ISocket &socket, IClient *client, const Message &message)
+		{
+			((LoopbackWorker *)socket.getData())->receive((size_t)client->getData(), message.getPtr(), message.getSize());
+		}
+
+		LoopbackSocket			_socket;
+		std::vector<IClient *>	_peers;
+};
+
+/*
+ *	echo server on the backend being measured, a tcp server is spread over
+ *	a Reactor when shards are asked for
+ */
+class	Server
+{
+	public:
+		Server(const t_options &options) : _running(true)
+		{
+			if (!options.record.empty())
+			{
+				if (options.backend == "tcp" && options.shards)
+					throw (std::invalid_argument("a reactor server cannot be recorded, its shards give clients the same handles"));
+				_recorder.reset(new Recorder(options.record, options.backend == "tcp" ? ISocket::TCP : options.backend == "udp" ? ISocket::UDP : ISocket::LOOPBACK));
+			}
+			if (options.metrics && options.backend == "tcp" && options.shards)
+				throw (std::invalid_argument("metrics of a reactor server are per shard, they cannot be reported"));
+			if (!options.link.empty())
+			{
+				if (options.backend == "tcp" && options.shards)
+					throw (std::invalid_argument("a reactor server cannot be conditioned"));
+				_conditioner.reset(new LinkConditioner(options.seed));
+				_conditioner->setProfile(profile(options.link));
+			}
+			if (options.backend == "tcp" && options.shards)
+			{
+				_reactor.reset(new Reactor(options.shards, options.clients + 1));
+				_reactor->setMessageReceiveCb(echo);
+				_reactor->bind(options.port);
+				return ;
+			}
+			if (options.backend == "tcp")
+				_socket.reset(new TcpSocket(options.clients + 1));
+			else if (options.backend == "udp")
+				_socket.reset(new UdpSocket(options.clients + 1));
+			else
+				_socket.reset(new LoopbackSocket(options.clients + 1));
+			_socket->setTimeout(1);
+			_socket->setMessageReceiveCb(echo);
+			_socket->setRecorder(_recorder.get());
+			_socket->setLinkConditioner(_conditioner.get());
+			_socket->bind(options.port);
+			if (options.metrics)
+				_reporter.reset(new MetricsReporter(*_socket, "server", options.metrics));
+			_thread = std::thread(&Server::loop, this);
+		}
+		~Server(void)
+		{
+			_running = false;
+			if (_thread.joinable())
+				_thread.join();
+			if (_reporter)
+				_reporter->report();
+			_reporter.reset();
+			if (!_conditioner)
+				return ;
+			for (int way = LinkConditioner::INBOUND; way <= LinkConditioner::OUTBOUND; way++)
+			{
+				t_linkStats	stats = _conditioner->getStats((LinkConditioner::direction)way);
+
+				std::cout << (way == LinkConditioner::INBOUND ? "server inbound: " : "server outbound: ")
+					<< stats.passed << " passed, " << stats.dropped << " dropped, " << stats.duplicated << " duplicated, "
+					<< stats.reordered << " reordered" << std::endl;
+			}
+		}
+	private:
+		//	latency,jitter,loss,duplicate,reorder,bandwidth, missing fields are null
+		static t_linkProfile	profile(const std::string &link)
+		{
+			t_linkProfile	profile = {0, 0, 0, 0, 0, 0, 0, 0};
+			double			fields[6] = {0, 0, 0, 0, 0, 0};
+			size_t			start = 0;
+			size_t			end;
+
+			for (size_t i = 0; i < 6 && start <= link.size(); i++)
+			{
+				end = link.find(',', start);
+				if (end == std::string::npos)
+					end = link.size();
+				if (end > start)
+					fields[i] = std::stod(link.substr(start, end - start));
+				start = end + 1;
+			}
+			profile.latency = (uint32_t)fields[0];
+			profile.jitter = (uint32_t)fields[1];
+			profile.loss = fields[2];
+			profile.duplicate = fields[3];
+			profile.reorder = fields[4];
+			profile.reorderDelay = profile.latency + profile.jitter;
+			profile.bandwidth = (uint64_t)fields[5];
+			profile.burst = profile.bandwidth / 10;
+			return (profile);
+		}
+
+		static void	echo(ISocket &socket, IClient *client, const Message &message)
+		{
+			socket.send(client, message);
+		}
+
+		void	loop(void)
+		{
+			while (_running)
+			{
+				try
+				{
+					_socket->pollEvent(SOCKET_ALLOW_READ | SOCKET_ALLOW_WRITE);
+				}
+				catch (const std::exception &e)
+				{
+					_log.error << "server: " << e.what() << std::endl;
+				}
+			}
+		}
+
+		std::unique_ptr<Recorder>			_recorder;
+		std::unique_ptr<LinkConditioner>	_conditioner;
+		std::unique_ptr<Reactor>			_reactor;
+		std::unique_ptr<ISocket>			_socket;
+		std::unique_ptr<MetricsReporter>	_reporter;
+		std::thread							_thread;
+		std::atomic<bool>					_running;
+};
+
+static double	percentile(const std::vector<uint32_t> &sorted, double p)
+{
+	if (sorted.empty())
+		return (0);
+	return (sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))] / 1000.0);
+}
+
+static void	bench(const t_options &options)
+{
+	std::vector<Worker *>		workers;
+	std::vector<std::thread>	threads;
+	std::vector<uint32_t>		latencies;
+	std::atomic<bool>			running(true);
+	uint64_t					sent, received, failed, last = 0;
+	size_t						first = 0;
+
+	try
+	{
+		for (size_t i = 0; i < options.threads; i++)
+		{
+			size_t	count = options.clients / options.threads + (i < options.clients % options.threads);
+
+			if (!count)
+				continue ;
+			if (options.backend == "tcp")
+				workers.push_back(new TcpWorker(options, first, count));
+			else if (options.backend == "udp")
+				workers.push_back(new UdpWorker(options, first, count));
+			else
+				workers.push_back(new LoopbackWorker(options, first, count));
+			first += count;
+		}
+	}
+	catch (const std::exception &)
+	{
+		for (auto worker = workers.begin(); worker != workers.end(); worker++)
+			delete *worker;
+		throw ;
+	}
+	for (auto worker = workers.begin(); worker != workers.end(); worker++)
+		threads.push_back(std::thread(&Worker::run, *worker, std::cref(running)));
+	for (size_t second = 1; second <= options.duration; second++)
+	{
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		received = 0;
+		for (auto worker = workers.begin(); worker != workers.end(); worker++)
+			received += (*worker)->received;
+		std::cout << "[" << second << "s] " << received - last << " msg/s, "
+			<< std::fixed << std::setprecision(2) << (received - last) * options.size / 1048576.0 << " MB/s" << std::endl;
+		last = received;
+	}
+	running = false;
+	sent = 0;
+	received = 0;
+	failed = 0;
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		threads[i].join();
+		sent += workers[i]->sent;
+		received += workers[i]->received;
+		failed += workers[i]->failed;
+		latencies.insert(latencies.end(), workers[i]->latencies.begin(), workers[i]->latencies.end());
+		delete workers[i];
+	}
+	std::sort(latencies.begin(), latencies.end());
+	std::cout << std::fixed << std::setprecision(3)
+		<< options.backend << ", " << first << " clients, " << options.size << " bytes, ";
+	if (options.rate > 0)
+		std::cout << options.rate << " msg/s per client" << std::endl;
+	else
+		std::cout << "closed loop" << std::endl;
+	std::cout
+		<< "sent " << sent << ", received " << received << ", unanswered " << (sent > received ? sent - received : 0) << ", clients failed " << failed << std::endl
+		<< "throughput " << received / (double)options.duration << " msg/s, " << received * options.size / 1048576.0 / options.duration << " MB/s" << std::endl
+		<< "latency ms p50 " << percentile(latencies, 0.5) << ", p99 " << percentile(latencies, 0.99)
+		<< ", p999 " << percentile(latencies, 0.999) << ", max " << (latencies.empty() ? 0 : latencies.back() / 1000.0) << std::endl;
+}
+
+static void	replay(const t_options &options)
+{
+	Replayer		replayer(options.capture);
+	t_replayStats	stats;
+
+	std::cout << "replaying " << replayer.getClientsNumber() << " clients, " << replayer.getMessagesNumber() << " messages over "
+		<< replayer.getDuration() << "s at ";
+	if (options.speed > 0)
+		std::cout << options.speed << "x" << std::endl;
+	else
+		std::cout << "full speed" << std::endl;
+	stats = replayer.replay(options.host, options.port, options.speed);
+	std::cout << std::fixed << std::setprecision(3)
+		<< "replayed " << stats.clients << " clients, " << stats.messages << " messages, " << stats.bytes << " bytes in " << stats.duration << "s" << std::endl
+		<< "throughput " << stats.messages / stats.duration << " msg/s, " << stats.bytes / 1048576.0 / stats.duration << " MB/s, worst lag " << stats.lag << " ms" << std::endl;
+}
+
+static void	usage(const char *name)
+{
+	std::cerr << "usage: " << name << " [options]" << std::endl
+		<< "  -b tcp|udp|loopback   backend (tcp)" << std::endl
+		<< "  -m both|server|client run the echo server, the clients or both (both)" << std::endl
+		<< "  -H host               server address (localhost)" << std::endl
+		<< "  -p port               server port (4242)" << std::endl
+		<< "  -c clients            simulated clients, or clients the server accepts (100)" << std::endl
+		<< "  -s size               message size in bytes, at least " << HEADER_SIZE << " (64)" << std::endl
+		<< "  -r rate               messages per second per client, 0 for closed loop (10)" << std::endl
+		<< "  -d seconds            duration of the run (10)" << std::endl
+		<< "  -t threads            client threads (hardware threads)" << std::endl
+		<< "  -R shards             serve tcp with a reactor of this many shards (0)" << std::endl
+		<< "  -o capture            record the echo server traffic to this file" << std::endl
+		<< "  -f capture            replay this capture instead of simulating clients" << std::endl
+		<< "  -x speed              replay speed, 0 for as fast as possible (1)" << std::endl
+		<< "  -C l,j,p,d,r,b        server link: latency ms, jitter ms, loss, duplicate and" << std::endl
+		<< "                        reorder probabilities, bandwidth bytes/s (none)" << std::endl
+		<< "  -S seed               link conditioner seed (0)" << std::endl
+		<< "  -M milliseconds       log the server metrics at this period, 0 for never (0)" << std::endl;
+}
+
+static bool	parse(int ac, char **av, t_options &options)
+{
+	for (int i = 1; i < ac; i += 2)
+	{
+		if (av[i][0] != '-' || !av[i][1] || av[i][2] || i + 1 >= ac)
+			return (false);
+		switch (av[i][1])
+		{
+			case 'b': options.backend = av[i + 1]; break ;
+			case 'm': options.mode = av[i + 1]; break ;
+			case 'H': options.host = av[i + 1]; break ;
+			case 'p': options.port = (uint16_t)std::stoul(av[i + 1]); break ;
+			case 'c': options.clients = std::stoul(av[i + 1]); break ;
+			case 's': options.size = std::stoul(av[i + 1]); break ;
+			case 'r': options.rate = std::stod(av[i + 1]); break ;
+			case 'd': options.duration = std::stoul(av[i + 1]); break ;
+			case 't': options.threads = std::stoul(av[i + 1]); break ;
+			case 'R': options.shards = std::stoul(av[i + 1]); break ;
+			case 'o': options.record = av[i + 1]; break ;
+			case 'f': options.capture = av[i + 1]; break ;
+			case 'x': options.speed = std::stod(av[i + 1]); break ;
+			case 'C': options.link = av[i + 1]; break ;
+			case 'S': options.seed = (uint32_t)std::stoul(av[i + 1]); break ;
+			case 'M': options.metrics = (uint32_t)std::stoul(av[i + 1]); break ;
+			default: return (false);
+		}
+	}
+	if (options.backend != "tcp" && options.backend != "udp" && options.backend != "loopback")
+		return (false);
+	if (options.mode != "both" && options.mode != "server" && options.mode != "client")
+		return (false);
+	if (options.backend == "loopback" && options.mode != "both")
+		throw (std::invalid_argument("loopback clients and server must run in the same process"));
+	if (options.size < HEADER_SIZE || (options.backend == "udp" && options.size >= UDP_MTU_DEFAULT))
+		throw (std::invalid_argument(std::string("message size must be between ").append(std::to_string(HEADER_SIZE))
+			.append(" and ").append(options.backend == "udp" ? std::to_string(UDP_MTU_DEFAULT - 1) : "any size")));
+	if (!options.clients || !options.duration || !options.threads)
+		throw (std::invalid_argument("clients, duration and threads cannot be null"));
+	return (true);
+}
+
+int	main(int ac, char **av)
+{
+	t_options	options = {"tcp", "both", "localhost", 4242, 100, 64, 10, 10, std::max(1u, std::thread::hardware_concurrency()), 0, "", "", 1, "", 0, 0};
+
+	try
+	{
+		if (!parse(ac, av, options))
+		{
+			usage(av[0]);
+			return (1);
+		}
+
+		std::unique_ptr<Server>	server(options.mode != "client" ? new Server(options) : nullptr);
+
+		if (options.mode == "server")
+		{
+			std::cout << "echo server on port " << options.port << " for " << options.duration << "s" << std::endl;
+			std::this_thread::sleep_for(std::chrono::seconds(options.duration));
+		}
+		else if (!options.capture.empty())
+			replay(options);
+		else
+			bench(options);
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << av[0] << ": " << e.what() << std::endl;
+		return (1);
+	}
+	return (0);
+}
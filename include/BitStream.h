@@ -0,0 +1,99 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "Message.h"
+
+#include <stdint.h>
+#include <string>
+
+namespace	ExoEngine
+{
+
+/*
+ *	bit level writer appending to a Message
+ *
+ *	bits are packed least significant first, flush pads the last byte with
+ *	zeros and must be called once everything is written (the destructor
+ *	does it as well).
+ *
+ *	varints are written by groups of 7 bits with a continuation bit, signed
+ *	values are zigzag encoded first so small negative values stay small.
+ *	floats can be quantized on a given number of bits inside [min, max].
+ */
+
+class	BitWriter
+{
+	public:
+		BitWriter(Message &dst);
+		~BitWriter(void);
+
+		void	writeBits(uint64_t value, uint8_t bits);
+		void	writeBool(bool value);
+		void	writeVarint(uint64_t value);
+		void	writeSigned(int64_t value);
+		void	writeFloat(float value);
+		void	writeFloat(float value, float min, float max, uint8_t bits);
+		void	writeDouble(double value);
+		void	writeBytes(const void *ptr, size_t size);
+		void	writeString(const std::string &str, size_t maxLength);
+		void	flush(void);
+
+		size_t	getBits(void) const;
+	private:
+		Message&	_dst;
+		uint64_t	_scratch;
+		uint8_t		_scratchBits;
+		size_t		_bits;
+};
+
+class	BitReader
+{
+	public:
+		BitReader(const Message &src, size_t index = 0);
+		~BitReader(void);
+
+		uint64_t	readBits(uint8_t bits);
+		bool		readBool(void);
+		uint64_t	readVarint(void);
+		int64_t		readSigned(void);
+		float		readFloat(void);
+		float		readFloat(float min, float max, uint8_t bits);
+		double		readDouble(void);
+		void		readBytes(void *ptr, size_t size);
+		std::string	readString(size_t maxLength);
+
+		//	index of the first byte after the bits read
+		size_t		getIndex(void) const;
+	private:
+		const uint8_t	*_data;
+		size_t			_size;
+		size_t			_bit;
+};
+
+uint64_t	zigzag(int64_t value);
+int64_t		unzigzag(uint64_t value);
+
+}
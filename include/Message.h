@@ -35,6 +35,7 @@ class Message
 	public:
 		Message(void);
 		Message(const Message &src);
+		Message(Message &&src) noexcept;
 		Message(const std::string &src);
 		Message(const void *ptr, size_t size);
 		Message(size_t size);
@@ -54,6 +55,7 @@ class Message
 		}
 
 		Message	&operator=(const Message &src);
+		Message	&operator=(Message &&src) noexcept;
 		Message	&operator=(const std::string &src);
 		template	<typename T>
 		Message	&operator=(const T &src)
@@ -84,6 +86,7 @@ class Message
 
 		const void	*getPtr(void) const;
 		size_t		getSize(void) const;
+		size_t		getCapacity(void) const;
 
 		std::string	to_string(void) const;
 	private:
@@ -0,0 +1,124 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace	ExoEngine
+{
+
+/*
+ *	unbounded lock-free queue with many producers and a single consumer
+ *
+ *	push can be called from any thread, it is a single atomic exchange.
+ *	pop must only be called by the consumer thread, it can miss an element
+ *	whose push is still in progress, which is then returned by a later pop.
+ */
+
+template	<typename T>
+class		MpscQueue
+{
+		public:
+			MpscQueue(void) : _head(&_stub), _tail(&_stub)
+			{
+				_stub.next = nullptr;
+			}
+			~MpscQueue(void)
+			{
+				T	tmp;
+
+				while (pop(tmp));
+			}
+
+			void	push(T &&src)
+			{
+				t_node	*node = new t_node{std::move(src), {nullptr}};
+				t_node	*prev;
+
+				prev = _head.exchange(node, std::memory_order_acq_rel);
+				prev->next.store(node, std::memory_order_release);
+			}
+			void	push(const T &src)
+			{
+				push(T(src));
+			}
+			bool	pop(T &dst)
+			{
+				t_node	*tail = _tail;
+				t_node	*next = tail->next.load(std::memory_order_acquire);
+
+				if (tail == &_stub)
+				{
+					if (!next)
+						return (false);
+					_tail = next;
+					tail = next;
+					next = next->next.load(std::memory_order_acquire);
+				}
+				if (next)
+				{
+					_tail = next;
+					dst = std::move(tail->value);
+					delete tail;
+					return (true);
+				}
+				if (tail != _head.load(std::memory_order_acquire))
+					return (false);
+				_stub.next.store(nullptr, std::memory_order_relaxed);
+				reinsert(&_stub);
+				next = tail->next.load(std::memory_order_acquire);
+				if (!next)
+					return (false);
+				_tail = next;
+				dst = std::move(tail->value);
+				delete tail;
+				return (true);
+			}
+			bool	isEmpty(void) const
+			{
+				return (_tail == &_stub ? !_stub.next.load(std::memory_order_acquire) : false);
+			}
+		private:
+			typedef struct	s_node
+			{
+				T						value;
+				std::atomic<s_node *>	next;
+			}				t_node;
+
+			void	reinsert(t_node *node)
+			{
+				t_node	*prev;
+
+				prev = _head.exchange(node, std::memory_order_acq_rel);
+				prev->next.store(node, std::memory_order_release);
+			}
+
+			std::atomic<t_node *>	_head;
+			t_node					*_tail;
+			t_node					_stub;
+};
+
+}
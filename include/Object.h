@@ -75,12 +75,16 @@ class	Object
 		bool		getField(uint32_t field) const;
 		void		removeField(uint32_t field);
 
+		uint32_t	getBitfield(void) const;
+		void		setBitfield(uint32_t bitfield);
+
 		size_t							getId(void) const;
 		const objectType				&getType(void) const;
 		const std::shared_ptr<hitboxes>	&getHitboxes(void) const;
 		ExoRenderer::sprite				*getSprite(void);
 
 		bool			collide(const glm::vec2 &pos) const;
+		static bool		collide(const glm::vec2 &pos, const glm::vec2 &scale, double angle, const glm::vec2 &point);
 
 		void			handlePhysic(const float &elapsedTime);
 		virtual void	handleMovement(const float &elapsedTime);
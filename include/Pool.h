@@ -0,0 +1,128 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <new>
+#include <utility>
+#include <stdexcept>
+
+namespace	ExoEngine
+{
+
+/*
+ *	fixed size object pool, objects are constructed in place inside chunks of
+ *	S slots, released slots are kept in a free list and reused before growing
+ *
+ *	the pool doesn't destroy objects still alive when deleted, only their memory
+ */
+
+template	<typename T, size_t S = 64>
+class		Pool
+{
+		public:
+			Pool(void) : _free(nullptr), _used(0)
+			{
+				if (!S)
+					throw (std::invalid_argument("Pool cannot have a null chunk size"));
+			}
+			~Pool(void) noexcept
+			{
+				for (auto chunk = _chunks.begin(); chunk != _chunks.end(); chunk++)
+					delete[] *chunk;
+			}
+
+			template	<typename ... Args>
+			T		*create(Args&& ... args)
+			{
+				node	*slot;
+				T		*object;
+
+				if (!_free)
+					grow();
+				slot = _free;
+				_free = slot->next;
+				try
+				{
+					object = new (slot->storage) T(std::forward<Args>(args) ...);
+				}
+				catch (const std::exception &)
+				{
+					slot->next = _free;
+					_free = slot;
+					throw ;
+				}
+				_used++;
+				return (object);
+			}
+			void	destroy(T *object)
+			{
+				node	*slot;
+
+				if (!object)
+					return ;
+				object->~T();
+				slot = reinterpret_cast<node *>(object);
+				slot->next = _free;
+				_free = slot;
+				_used--;
+			}
+
+			size_t	size(void) const noexcept
+			{
+				return (_used);
+			}
+			size_t	capacity(void) const noexcept
+			{
+				return (_chunks.size() * S);
+			}
+		private:
+			union	node
+			{
+				node					*next;
+				alignas(T) unsigned char	storage[sizeof(T)];
+			};
+
+			void	grow(void)
+			{
+				node	*chunk = new node[S];
+
+				_chunks.push_back(chunk);
+				for (size_t i = S; i-- > 0; )
+				{
+					chunk[i].next = _free;
+					_free = &chunk[i];
+				}
+			}
+
+			std::vector<node *>	_chunks;
+			node				*_free;
+			size_t				_used;
+
+			Pool(const Pool &);
+			Pool	&operator=(const Pool &);
+};
+
+}
@@ -25,10 +25,12 @@
 #pragma once
 
 #include "Message.h"
+#include "BitStream.h"
 #include "network/network.h"
 #include "Log.h"
 
 #include <string>
+#include <type_traits>
 
 #define REFLECT_ATTRIBUTES_START()		\
 	virtual void	initReflection(void)\
@@ -40,6 +42,24 @@
 		else\
 			_members.push_back(new reflection::ReflectableType<decltype(attr)>(attr));
 
+/*
+ *	the following attributes are only different when packed in a bit stream,
+ *	REFLECT_ATTRIBUTE packs integers as varints and floats on 32/64 bits
+ *
+ *	REFLECT_ATTRIBUTE_BITS		integer on a fixed number of bits (zigzag if signed)
+ *	REFLECT_ATTRIBUTE_RANGE		float quantized on bits inside [min, max]
+ *	REFLECT_ATTRIBUTE_STRING	string of at most maxLength bytes
+ */
+
+#define REFLECT_ATTRIBUTE_BITS(attr, bits)		\
+		_members.push_back(new reflection::ReflectableType<decltype(attr)>(attr, {(uint8_t)(bits), 0, 0, 0}));
+
+#define REFLECT_ATTRIBUTE_RANGE(attr, min, max, bits)		\
+		_members.push_back(new reflection::ReflectableType<decltype(attr)>(attr, {(uint8_t)(bits), (double)(min), (double)(max), 0}));
+
+#define REFLECT_ATTRIBUTE_STRING(attr, maxLength)		\
+		_members.push_back(new reflection::ReflectableType<decltype(attr)>(attr, {0, 0, 0, (size_t)(maxLength)}));
+
 #define REFLECT_ATTRIBUTES_END()		\
 	}
 
@@ -55,17 +75,114 @@ namespace	reflection
 			virtual ~IReflectable(void);
 
 			void	read(Message& src);
+			void	pack(Message& dst);
+			size_t	unpack(const Message& src, size_t index);
 
 			virtual void	write(Message& dst) = 0;
 			virtual size_t	read(Message& src, size_t index) = 0;
+			virtual void	pack(BitWriter& dst) = 0;
+			virtual void	unpack(BitReader& src) = 0;
+
+			//	bytes written by write, so a buffer of the right size can be prepared
+			virtual size_t	size(void) = 0;
+			//	same bytes as write into a buffer of at least size() bytes, returns their end
+			virtual uint8_t	*write(uint8_t* dst) = 0;
+			//	reads what write wrote from [src, end), returns the end of what was read
+			virtual const uint8_t	*read(const uint8_t* src, const uint8_t* end) = 0;
 		private:
 	};
 
+	typedef struct	s_encoding
+	{
+		uint8_t		bits;
+		double		min;
+		double		max;
+		size_t		maxLength;
+	}				t_encoding;
+
+	inline void	packValue(BitWriter& dst, const bool& value, const t_encoding&)
+	{
+		dst.writeBool(value);
+	}
+
+	inline void	unpackValue(BitReader& src, bool& value, const t_encoding&)
+	{
+		value = src.readBool();
+	}
+
+	template	<typename T>
+	typename std::enable_if<std::is_integral<T>::value>::type	packValue(BitWriter& dst, const T& value, const t_encoding& encoding)
+	{
+		uint64_t	raw = std::is_signed<T>::value ? zigzag((int64_t)value) : (uint64_t)value;
+
+		if (!encoding.bits)
+			return (dst.writeVarint(raw));
+		if (encoding.bits < 64 && raw >> encoding.bits)
+			throw (std::out_of_range("cannot pack " + std::to_string(value) + " on " + std::to_string(encoding.bits) + " bits"));
+		dst.writeBits(raw, encoding.bits);
+	}
+
+	template	<typename T>
+	typename std::enable_if<std::is_integral<T>::value>::type	unpackValue(BitReader& src, T& value, const t_encoding& encoding)
+	{
+		uint64_t	raw = encoding.bits ? src.readBits(encoding.bits) : src.readVarint();
+
+		value = std::is_signed<T>::value ? (T)unzigzag(raw) : (T)raw;
+	}
+
+	template	<typename T>
+	typename std::enable_if<std::is_floating_point<T>::value>::type	packValue(BitWriter& dst, const T& value, const t_encoding& encoding)
+	{
+		if (encoding.bits)
+			dst.writeFloat((float)value, (float)encoding.min, (float)encoding.max, encoding.bits);
+		else if (sizeof(T) == sizeof(float))
+			dst.writeFloat((float)value);
+		else
+			dst.writeDouble((double)value);
+	}
+
+	template	<typename T>
+	typename std::enable_if<std::is_floating_point<T>::value>::type	unpackValue(BitReader& src, T& value, const t_encoding& encoding)
+	{
+		if (encoding.bits)
+			value = (T)src.readFloat((float)encoding.min, (float)encoding.max, encoding.bits);
+		else if (sizeof(T) == sizeof(float))
+			value = (T)src.readFloat();
+		else
+			value = (T)src.readDouble();
+	}
+
+	inline void	packValue(BitWriter& dst, const std::string& value, const t_encoding& encoding)
+	{
+		dst.writeString(value, encoding.maxLength ? encoding.maxLength : PAQUET_MAX_SIZE);
+	}
+
+	inline void	unpackValue(BitReader& src, std::string& value, const t_encoding& encoding)
+	{
+		value = src.readString(encoding.maxLength ? encoding.maxLength : PAQUET_MAX_SIZE);
+	}
+
+	//	any other type is copied as is
+	template	<typename T>
+	typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_same<T, std::string>::value>::type	packValue(BitWriter& dst, const T& value, const t_encoding&)
+	{
+		dst.writeBytes((const void*)&value, sizeof(T));
+	}
+
+	template	<typename T>
+	typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_same<T, std::string>::value>::type	unpackValue(BitReader& src, T& value, const t_encoding&)
+	{
+		src.readBytes((void*)&value, sizeof(T));
+	}
+
 	template	<typename T>
 	class		ReflectableType : public IReflectable
 	{
 		public:
-			ReflectableType(T& data) : _data(data)
+			ReflectableType(T& data) : _data(data), _encoding({0, 0, 0, 0})
+			{
+			}
+			ReflectableType(T& data, const t_encoding& encoding) : _data(data), _encoding(encoding)
 			{
 			}
 			virtual ~ReflectableType(void)
@@ -84,6 +201,55 @@ namespace	reflection
 					dst.append(network::endian(_data));
 				}
 			}
+			virtual size_t	size(void)
+			{
+				if (typeid(T) == typeid(std::string))
+					return (sizeof(std::string::size_type) + ((std::string&)_data).length());
+				return (sizeof(T));
+			}
+			virtual uint8_t	*write(uint8_t* dst)
+			{
+				if (typeid(T) == typeid(std::string))
+				{
+					std::string::size_type	length = ((std::string&)_data).length();
+
+					memcpy(dst, &length, sizeof(length));
+					memcpy(dst + sizeof(length), ((std::string&)_data).data(), length);
+					return (dst + sizeof(length) + length);
+				}
+				else
+				{
+					T	data = network::endian(_data);
+
+					memcpy(dst, (const void*)&data, sizeof(T));
+					return (dst + sizeof(T));
+				}
+			}
+			virtual const uint8_t	*read(const uint8_t* src, const uint8_t* end)
+			{
+				if (typeid(T) == typeid(std::string))
+				{
+					std::string::size_type	length;
+
+					if ((size_t)(end - src) < sizeof(length))
+						throw (std::invalid_argument("cannot read string size, only " + std::to_string(end - src) + " bytes left"));
+					memcpy(&length, src, sizeof(length));
+					src += sizeof(length);
+					if ((size_t)(end - src) < length)
+						throw (std::invalid_argument("cannot read " + std::to_string(length) + " bytes, only " + std::to_string(end - src) + " left"));
+					((std::string&)_data).assign((const char*)src, length);
+					return (src + length);
+				}
+				else
+				{
+					if ((size_t)(end - src) < sizeof(T))
+						throw (std::invalid_argument("cannot read " + std::to_string(sizeof(T)) +
+							" bytes, only " + std::to_string(end - src) + " left"));
+					memcpy((void*)&_data, src, sizeof(T));
+					ENDIAN(_data);
+					return (src + sizeof(T));
+				}
+			}
 			virtual size_t	read(Message& src, size_t index)
 			{
 				if (typeid(T) == typeid(std::string))
@@ -105,8 +271,19 @@ namespace	reflection
 					return (index + sizeof(T));
 				}
 			}
+			virtual void	pack(BitWriter& dst)
+			{
+				packValue(dst, _data, _encoding);
+			}
+			virtual void	unpack(BitReader& src)
+			{
+				unpackValue(src, _data, _encoding);
+			}
+			using			IReflectable::pack;
+			using			IReflectable::unpack;
 		private:
-			T&	_data;
+			T&			_data;
+			t_encoding	_encoding;
 	};
 
 	class		ReflectableClass : public IReflectable
@@ -118,6 +295,13 @@ namespace	reflection
 
 			virtual void	write(Message& dst);
 			virtual size_t	read(Message& src, size_t index);
+			virtual void	pack(BitWriter& dst);
+			virtual void	unpack(BitReader& src);
+			virtual size_t			size(void);
+			virtual uint8_t			*write(uint8_t* dst);
+			virtual const uint8_t	*read(const uint8_t* src, const uint8_t* end);
+			using			IReflectable::pack;
+			using			IReflectable::unpack;
 		protected:
 			virtual void	initReflection(void) = 0;
 
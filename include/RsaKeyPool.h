@@ -0,0 +1,85 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "RsaKey.h"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#ifndef RSA_KEY_POOL_DEPTH
+# define RSA_KEY_POOL_DEPTH	4
+#endif
+
+namespace	ExoEngine
+{
+
+typedef struct	s_rsaKeyPoolStats
+{
+	size_t		depth;				//	keys ready
+	size_t		target;				//	keys kept ready
+	uint64_t	generated;
+	uint64_t	acquired;
+	uint64_t	misses;				//	acquires that found the pool empty and generated a key themselves
+	double		lastGenerationTime;	//	seconds
+	double		averageGenerationTime;
+	double		maxGenerationTime;
+}				t_rsaKeyPoolStats;
+
+/*
+ *	keeps generated rsa keys ready to be used
+ *
+ *	a background thread refills the pool up to its depth each time a key is
+ *	taken, so acquire only pops a key unless the pool is drained faster than
+ *	it is refilled, in which case the caller generates its key itself.
+ */
+
+class	RsaKeyPool
+{
+	public:
+		RsaKeyPool(size_t depth = RSA_KEY_POOL_DEPTH);
+		~RsaKeyPool(void);
+
+		std::unique_ptr<RsaKey>	acquire(void);
+
+		void				setDepth(size_t depth);
+		t_rsaKeyPoolStats	getStats(void);
+	private:
+		//	child thread
+		void	loop(void);
+		void	record(double time);
+
+		std::deque<std::unique_ptr<RsaKey>>	_keys;
+		std::mutex							_mutex;
+		std::condition_variable				_condition;
+		t_rsaKeyPoolStats					_stats;
+		bool								_joining;
+		std::thread							_thread;
+};
+
+}
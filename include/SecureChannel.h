@@ -0,0 +1,114 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include <openssl/evp.h>
+#include <mutex>
+#include "RsaKey.h"
+#include "SessionTickets.h"
+
+#define SECURE_CHANNEL_KEY_SIZE		32
+#define SECURE_CHANNEL_SALT_SIZE	4
+#define SECURE_CHANNEL_TAG_SIZE		16
+#define SECURE_CHANNEL_OVERHEAD		(sizeof(uint64_t) + SECURE_CHANNEL_TAG_SIZE)
+#define SECURE_CHANNEL_SECRET_SIZE	(SECURE_CHANNEL_KEY_SIZE + SECURE_CHANNEL_SALT_SIZE)
+#define SECURE_CHANNEL_RANDOM_SIZE	32
+
+namespace	ExoEngine
+{
+
+/*
+ *	authenticated session over any message transport
+ *
+ *	the client draws a random secret and a random and sends them encrypted
+ *	with the server's RSA public key, the server answers with its own random
+ *	and both derive the AES-256 key and nonce salt from the secret and the
+ *	randoms with HMAC-SHA512, so every connection gets its own key:
+ *
+ *		client							server
+ *		handshake(key)		->			accept(key, handshake)
+ *		accepted(response)	<-
+ *
+ *	after that every message is sealed with AES-256-GCM and followed by its
+ *	counter and tag:
+ *
+ *		ciphertext
+ *		uint64_t	counter
+ *		uint8_t		tag[16]
+ *
+ *	the nonce is the salt followed by the counter, whose high bit is the
+ *	direction so both sides can share the key. Counters must increase, a
+ *	replayed or reordered message is rejected by open.
+ *
+ *	the server can give the client a ticket sealing the session secret, the
+ *	client later resumes with the ticket and a random, the server answers
+ *	with its own random and both derive a new secret from the old one and
+ *	the randoms the same way, without any RSA operation:
+ *
+ *		client							server
+ *		resume(ticket)		->			accept(tickets, request)
+ *		resumed(response)	<-
+ */
+
+class	SecureChannel
+{
+	public:
+		SecureChannel(void);
+		~SecureChannel(void);
+
+		Message	handshake(RsaKey &peerKey);
+		Message	accept(RsaKey &key, const Message &handshake);
+		void	accepted(const Message &response);
+
+		Message	issueTicket(SessionTickets &tickets);
+		Message	resume(const Message &ticket);
+		Message	accept(SessionTickets &tickets, const Message &request);
+		void	resumed(const Message &response);
+
+		void	seal(Message &message);
+		void	open(Message &message);
+
+		bool	isEstablished(void) const;
+	private:
+		void	complete(const char *label, const Message &response);
+		void	establish(const uint8_t *secret, bool server);
+		void	derive(const char *label, const uint8_t *secret, const uint8_t *clientRandom, const uint8_t *serverRandom, uint8_t *dst);
+
+		EVP_CIPHER_CTX	*_sealCtx;
+		EVP_CIPHER_CTX	*_openCtx;
+		std::mutex		_sealMutex;
+		std::mutex		_openMutex;
+		uint8_t			_salt[SECURE_CHANNEL_SALT_SIZE];
+		uint8_t			_secret[SECURE_CHANNEL_SECRET_SIZE];
+		uint8_t			_random[SECURE_CHANNEL_RANDOM_SIZE];
+		uint64_t		_sealDirection;
+		uint64_t		_sealCounter;
+		uint64_t		_openDirection;
+		uint64_t		_openCounter;
+		bool			_pending;	//	handshake or resume waiting for the server random
+		bool			_established;
+};
+
+}
@@ -0,0 +1,105 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "Message.h"
+
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <deque>
+
+//	seconds a ticket can be used to resume a session
+#ifndef SESSION_TICKET_LIFETIME
+# define SESSION_TICKET_LIFETIME	3600
+#endif
+
+//	seconds a ticket key is used to issue tickets
+#ifndef SESSION_TICKET_ROTATION
+# define SESSION_TICKET_ROTATION	3600
+#endif
+
+#define SESSION_TICKET_KEY_SIZE		32
+#define SESSION_TICKET_NONCE_SIZE	12
+#define SESSION_TICKET_TAG_SIZE		16
+
+namespace	ExoEngine
+{
+
+/*
+ *	server side keys sealing session tickets
+ *
+ *	a ticket is a session secret and its issue time encrypted with a key
+ *	only the server knows, so the server keeps no state per session:
+ *
+ *		uint8_t		key id
+ *		uint8_t		nonce[12]
+ *		ciphertext	{ secret; uint64_t issued }
+ *		uint8_t		tag[16]
+ *
+ *	a new key replaces the current one each rotation period or on rotate(),
+ *	a retired key is kept until the lifetime has passed since its retirement
+ *	so tickets it sealed are still accepted until they expire. Key ids are
+ *	8 bits, past 255 retired keys the oldest is dropped early.
+ */
+
+class	SessionTickets
+{
+	public:
+		SessionTickets(size_t lifetime = SESSION_TICKET_LIFETIME, size_t rotation = SESSION_TICKET_ROTATION);
+		~SessionTickets(void);
+
+		Message	issue(const void *secret, size_t size);
+		void	open(const Message &ticket, void *secret, size_t size);
+		void	rotate(void);
+
+		uint64_t	getIssued(void) const;
+		uint64_t	getResumed(void) const;
+		uint64_t	getRejected(void) const;
+	private:
+		typedef struct	s_key
+		{
+			uint8_t									id;
+			uint8_t									key[SESSION_TICKET_KEY_SIZE];
+			std::chrono::steady_clock::time_point	created;
+			std::chrono::steady_clock::time_point	retired;
+		}				t_key;
+
+		void	generate(t_key &key, uint8_t id);
+		void	update(void);
+		void	retire(t_key &next, std::chrono::steady_clock::time_point current);
+		void	reject(const std::string &reason);
+
+		std::mutex				_mutex;
+		t_key					_current;
+		std::deque<t_key>		_retired;
+		std::chrono::seconds	_lifetime;
+		std::chrono::seconds	_rotation;
+		std::atomic<uint64_t>	_issued;
+		std::atomic<uint64_t>	_resumed;
+		std::atomic<uint64_t>	_rejected;
+};
+
+}
@@ -0,0 +1,170 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <stdexcept>
+
+namespace	ExoEngine
+{
+
+/*
+ *	generational slot map
+ *
+ *	values are stored contiguously for iteration, insertion returns a 64 bits
+ *	handle (generation << 32 | slot index) that stays valid until the value is
+ *	erased, erasing moves the last value into the hole so both are O(1).
+ *	handle 0 is never returned and can be used as an invalid handle.
+ */
+
+template	<typename T>
+class		SlotMap
+{
+		public:
+			typedef uint64_t								handle;
+			typedef typename std::vector<T>::iterator		iterator;
+			typedef typename std::vector<T>::const_iterator	const_iterator;
+
+			SlotMap(void) : _freeHead(NONE)
+			{
+			}
+			~SlotMap(void) noexcept
+			{
+			}
+
+			handle	insert(const T &value)
+			{
+				uint32_t	index;
+
+				if (_freeHead != NONE)
+				{
+					index = _freeHead;
+					_freeHead = _slots[index].index;
+				}
+				else
+				{
+					if (_slots.size() >= NONE)
+						throw (std::length_error("SlotMap is full"));
+					index = (uint32_t)_slots.size();
+					_slots.push_back({1, 0});
+				}
+				_slots[index].index = (uint32_t)_values.size();
+				_values.push_back(value);
+				_owners.push_back(index);
+				return (((handle)_slots[index].generation << 32) | index);
+			}
+			bool	erase(handle h)
+			{
+				uint32_t	index = (uint32_t)h;
+				uint32_t	dense;
+
+				if (!contains(h))
+					return (false);
+				dense = _slots[index].index;
+				if (dense != _values.size() - 1)
+				{
+					_values[dense] = _values.back();
+					_owners[dense] = _owners.back();
+					_slots[_owners[dense]].index = dense;
+				}
+				_values.pop_back();
+				_owners.pop_back();
+				if (!++_slots[index].generation)
+					_slots[index].generation = 1;
+				_slots[index].index = _freeHead;
+				_freeHead = index;
+				return (true);
+			}
+			bool	contains(handle h) const noexcept
+			{
+				uint32_t	index = (uint32_t)h;
+
+				return (h && index < _slots.size() && _slots[index].generation == (uint32_t)(h >> 32) &&
+					_slots[index].index < _owners.size() && _owners[_slots[index].index] == index);
+			}
+			T		*get(handle h) noexcept
+			{
+				if (!contains(h))
+					return (nullptr);
+				return (&_values[_slots[(uint32_t)h].index]);
+			}
+			void	clear(void) noexcept
+			{
+				for (size_t i = _owners.size(); i-- > 0; )
+					erase(handleAt(i));
+			}
+
+			//	dense access, indexes are invalidated by erase
+			T		&operator[](size_t index)
+			{
+				return (_values[index]);
+			}
+			handle	handleAt(size_t index) const
+			{
+				return (((handle)_slots[_owners[index]].generation << 32) | _owners[index]);
+			}
+
+			size_t	size(void) const noexcept
+			{
+				return (_values.size());
+			}
+			bool	isEmpty(void) const noexcept
+			{
+				return (_values.empty());
+			}
+
+			iterator		begin(void) noexcept
+			{
+				return (_values.begin());
+			}
+			iterator		end(void) noexcept
+			{
+				return (_values.end());
+			}
+			const_iterator	begin(void) const noexcept
+			{
+				return (_values.begin());
+			}
+			const_iterator	end(void) const noexcept
+			{
+				return (_values.end());
+			}
+		private:
+			static const uint32_t	NONE = 0xffffffff;
+
+			typedef struct	s_slot
+			{
+				uint32_t	generation;
+				uint32_t	index;
+			}				t_slot;
+
+			std::vector<t_slot>		_slots;
+			std::vector<T>			_values;
+			std::vector<uint32_t>	_owners;
+			uint32_t				_freeHead;
+};
+
+}
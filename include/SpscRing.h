@@ -0,0 +1,116 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+namespace	ExoEngine
+{
+
+/*
+ *	bounded lock-free ring with a single producer and a single consumer
+ *
+ *	the capacity is rounded up to a power of two, push fails instead of
+ *	overwriting when the ring is full. Elements are moved in and out so a
+ *	Message crosses the ring without its payload being copied.
+ */
+
+template	<typename T>
+class		SpscRing
+{
+		public:
+			SpscRing(size_t capacity) : _read(0), _write(0)
+			{
+				size_t	size = 1;
+
+				if (!capacity)
+					throw (std::invalid_argument("SpscRing cannot have a null capacity"));
+				while (size < capacity)
+					size <<= 1;
+				_buffer.resize(size);
+				_mask = size - 1;
+			}
+			~SpscRing(void) noexcept
+			{
+			}
+
+			//	src is left untouched when the ring is full
+			bool	push(T &&src)
+			{
+				size_t	write = _write.load(std::memory_order_relaxed);
+
+				if (write - _read.load(std::memory_order_acquire) > _mask)
+					return (false);
+				_buffer[write & _mask] = std::move(src);
+				_write.store(write + 1, std::memory_order_release);
+				return (true);
+			}
+			bool	push(const T &src)
+			{
+				size_t	write = _write.load(std::memory_order_relaxed);
+
+				if (write - _read.load(std::memory_order_acquire) > _mask)
+					return (false);
+				_buffer[write & _mask] = src;
+				_write.store(write + 1, std::memory_order_release);
+				return (true);
+			}
+			bool	pop(T &dst)
+			{
+				size_t	read = _read.load(std::memory_order_relaxed);
+
+				if (read == _write.load(std::memory_order_acquire))
+					return (false);
+				dst = std::move(_buffer[read & _mask]);
+				_read.store(read + 1, std::memory_order_release);
+				return (true);
+			}
+
+			bool	isEmpty(void) const noexcept
+			{
+				return (_read.load(std::memory_order_acquire) == _write.load(std::memory_order_acquire));
+			}
+			size_t	size(void) const noexcept
+			{
+				size_t	read = _read.load(std::memory_order_acquire);
+
+				return (_write.load(std::memory_order_acquire) - read);
+			}
+			size_t	capacity(void) const noexcept
+			{
+				return (_mask + 1);
+			}
+		private:
+			std::vector<T>						_buffer;
+			size_t								_mask;
+			//	producer and consumer indexes on their own cache lines
+			alignas(64) std::atomic<size_t>		_read;
+			alignas(64) std::atomic<size_t>		_write;
+};
+
+}
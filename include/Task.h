@@ -33,6 +33,7 @@ class	Task
 		Task(void);
 		Task(const Task &src);
 		Task(void (*function)(void), void (*finishCallback)(void), void (*cancelCallback)(void));
+		Task(void (*function)(void *), void *data, void (*finishCallback)(void *) = nullptr, void (*cancelCallback)(void *) = nullptr);
 		~Task(void);
 
 		void	launch(void) const;
@@ -42,6 +43,10 @@ class	Task
 		void	(*_function)(void);
 		void	(*_finishCallback)(void);
 		void	(*_cancelCallback)(void);
+		void	(*_dataFunction)(void *);
+		void	(*_dataFinishCallback)(void *);
+		void	(*_dataCancelCallback)(void *);
+		void	*_data;
 };
 
 }
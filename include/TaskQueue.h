@@ -43,6 +43,7 @@ class	TaskQueue
 		~TaskQueue(void);
 
 		void	add(const Task &task);
+		bool	tryAdd(const Task &task);
 		Task	getTask(void);
 
 		bool	joining(void) const;
@@ -64,7 +64,9 @@ namespace	network
 	typedef enum	e_type
 	{
 		TYPE_INVALID_PACKET_TYPE,
-		TYPE_INVALID_PACKET_SIZE
+		TYPE_INVALID_PACKET_SIZE,
+		TYPE_CLOCK_PING,
+		TYPE_CLOCK_PONG
 	}				t_type;
 
 	/*
@@ -97,6 +99,26 @@ namespace	network
 	 *	header.size = sizeof(t_header)
 	 */
 
+	/*
+	 *	TYPE_CLOCK_PING
+	 *
+	 *	clock synchronization request, answered by a TYPE_CLOCK_PONG.
+	 *	uint64_t: sender time when sent, in microseconds
+	 *
+	 *	header.size = sizeof(t_header) + 8
+	 */
+
+	/*
+	 *	TYPE_CLOCK_PONG
+	 *
+	 *	answer to a TYPE_CLOCK_PING, times in microseconds.
+	 *	uint64_t: ping sender time, copied from the ping
+	 *	uint64_t: answering peer time when the ping was received
+	 *	uint64_t: answering peer time when the pong was sent
+	 *
+	 *	header.size = sizeof(t_header) + 24
+	 */
+
 };
 
 }
@@ -0,0 +1,82 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "Message.h"
+
+#include <stdint.h>
+#include <vector>
+
+//	bytes a client may have waiting for a flush, lower priorities are dropped beyond
+#ifndef UDP_AGGREGATION_QUEUE_MAX
+# define UDP_AGGREGATION_QUEUE_MAX	65536
+#endif
+
+//	kind, then for each message its size on 2 bytes and its data
+#define UDP_BUNDLE_HEADER_SIZE		1
+#define UDP_BUNDLE_ENTRY_SIZE		2
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+/*
+ *	messages of a udp client waiting for the next flush, not thread safe
+ *
+ *	a flush takes messages by decreasing priority, in send order within a
+ *	priority, until the budget is spent, the others wait for the next one.
+ *	The messages taken keep their send order.
+ */
+
+class	Aggregator
+{
+	public:
+		typedef struct	s_entry
+		{
+			Message		message;
+			uint8_t		priority;
+			uint64_t	order;
+		}				t_entry;
+
+		Aggregator(void);
+		~Aggregator(void);
+
+		size_t	push(const Message &message, uint8_t priority);
+		void	take(size_t budget, std::vector<t_entry> &entries);
+		void	clear(void);
+
+		bool	isEmpty(void) const;
+		size_t	getPending(void) const;
+	private:
+		std::vector<t_entry>	_entries;
+		size_t					_pending;
+		uint64_t				_order;
+};
+
+}
+
+}
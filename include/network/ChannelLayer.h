@@ -0,0 +1,172 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/ISocket.h"
+
+#include <chrono>
+#include <deque>
+#include <unordered_map>
+
+#ifndef CHANNEL_PACKET_MAX_SIZE
+# define CHANNEL_PACKET_MAX_SIZE	1200
+#endif
+
+//	maximum number of reliable messages in flight per channel
+#ifndef CHANNEL_WINDOW_SIZE
+# define CHANNEL_WINDOW_SIZE	256
+#endif
+
+//	number of sent packets remembered to match incoming acks
+#ifndef CHANNEL_SENT_HISTORY
+# define CHANNEL_SENT_HISTORY	1024
+#endif
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+/*
+ *	message channels multiplexed over a datagram socket
+ *
+ *	each packet carries a sequence number, the last received sequence and a
+ *	bitfield acking the 32 sequences before it, followed by channel messages:
+ *
+ *		uint16_t	sequence
+ *		uint16_t	ack
+ *		uint32_t	ackBits
+ *		uint8_t		flags
+ *		{ uint8_t channel; uint16_t id; uint16_t size; data }...
+ *
+ *	the ack fields are only read when flags has CHANNEL_ACK_VALID, set once
+ *	the sender received a packet, so a peer that received nothing doesn't
+ *	ack the sequence 0.
+ *
+ *	reliable messages are sent again in a new packet when they haven't been
+ *	acked after the retransmission timeout, estimated from the round trip
+ *	time of acked packets (srtt + 4 * rttvar).
+ *
+ *	the layer doesn't own the socket callbacks: receive must be called from
+ *	the socket's message receive callback, remove from the client del
+ *	callback and update once per tick to send queued messages and acks.
+ */
+
+class	ChannelLayer
+{
+	public:
+		typedef enum
+		{
+			UNRELIABLE,
+			RELIABLE_UNORDERED,
+			RELIABLE_ORDERED
+		}		channelType;
+
+		ChannelLayer(ISocket &socket);
+		~ChannelLayer(void);
+
+		uint8_t	addChannel(channelType type);
+
+		void	send(IClient *client, uint8_t channel, const Message &message);
+		void	receive(IClient *client, const Message &packet);
+		void	update(void);
+		void	remove(IClient *client);
+
+		double	getRtt(IClient *client);
+
+		ISocket	&getSocket(void);
+
+		void	attachData(void *data);
+		void	*getData(void);
+
+		void	setMessageReceiveCb(void(*callback)(ChannelLayer &, IClient *, uint8_t, const Message &));
+	private:
+		typedef std::chrono::steady_clock::time_point	timePoint;
+
+		typedef struct	s_outgoing
+		{
+			uint16_t	id;
+			Message		message;
+			timePoint	lastSent;
+			bool		sent;
+			bool		acked;
+		}				t_outgoing;
+
+		typedef struct	s_incoming
+		{
+			bool		received;
+			Message		message;
+		}				t_incoming;
+
+		typedef struct	s_channel
+		{
+			channelType				type;
+			uint16_t				nextId;
+			std::deque<t_outgoing>	outgoing;
+			uint16_t				lowest;
+			t_incoming				incoming[CHANNEL_WINDOW_SIZE];
+		}				t_channel;
+
+		typedef struct	s_sentPacket
+		{
+			uint16_t										sequence;
+			bool											used;
+			bool											acked;
+			timePoint										time;
+			std::vector<std::pair<uint8_t, uint16_t>>		messages;
+		}				t_sentPacket;
+
+		typedef struct	s_connection
+		{
+			IClient					*client;
+			uint16_t				localSequence;
+			uint16_t				remoteSequence;
+			uint32_t				ackBits;
+			bool					received;
+			bool					ackPending;
+			double					srtt;
+			double					rttvar;
+			double					rto;
+			std::vector<t_channel>	channels;
+			t_sentPacket			sent[CHANNEL_SENT_HISTORY];
+		}				t_connection;
+
+		t_connection	*getConnection(IClient *client);
+		void			acknowledge(t_connection &connection, uint16_t sequence, const timePoint &now, bool sample);
+		void			deliver(t_connection &connection, uint8_t channel, uint16_t id, const uint8_t *data, uint16_t size);
+		void			flushPacket(t_connection &connection, Message &packet, std::vector<std::pair<uint8_t, uint16_t>> &messages, const timePoint &now);
+
+		std::recursive_mutex								_mutex;
+		ISocket&											_socket;
+		std::vector<channelType>							_channels;
+		std::unordered_map<IClient::handle, t_connection *>	_connections;
+		void												*_data;
+		void												(*_messageReceiveCb)(ChannelLayer &layer, IClient *client, uint8_t channel, const Message &message);
+};
+
+}
+
+}
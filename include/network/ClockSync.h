@@ -0,0 +1,149 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/ISocket.h"
+#include "network/PacketDispatcher.h"
+#include "Alarm.h"
+
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+//	milliseconds between pings once the clock is estimated
+#ifndef CLOCK_SYNC_INTERVAL
+# define CLOCK_SYNC_INTERVAL		1000
+#endif
+//	first pings sent quickly so the estimates are usable early
+#ifndef CLOCK_SYNC_BURST
+# define CLOCK_SYNC_BURST			4
+#endif
+#ifndef CLOCK_SYNC_BURST_INTERVAL
+# define CLOCK_SYNC_BURST_INTERVAL	100
+#endif
+//	samples the offset is chosen from, the one with the lowest rtt wins
+#ifndef CLOCK_SYNC_FILTER
+# define CLOCK_SYNC_FILTER			8
+#endif
+//	pings waiting for their pong per peer, the oldest is forgotten beyond
+#ifndef CLOCK_SYNC_PENDING
+# define CLOCK_SYNC_PENDING			4
+#endif
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+/*
+ *	round trip time and clock offset of the peers, estimated with pings
+ *
+ *	a ping carries the time it was sent (t0), the pong carries it back with
+ *	the times the ping was received (t1) and the pong sent (t2) on the
+ *	peer, the pong is received at t3. As in NTP:
+ *
+ *		rtt = (t3 - t0) - (t2 - t1)
+ *		offset = ((t1 - t0) + (t2 - t3)) / 2
+ *
+ *	the rtt is smoothed as in RFC 6298 (srtt, rttvar), the offset is the
+ *	one of the sample with the lowest rtt among the last CLOCK_SYNC_FILTER,
+ *	the least delayed by queues. Estimates are stored on the IClient.
+ *
+ *	the last CLOCK_SYNC_PENDING pings of a peer are remembered, a pong
+ *	whose t0 isn't one of them is dropped, so a forged or replayed pong
+ *	can't skew the estimates. t3 - t0 is measured on the steady clock
+ *	from the remembered ping, the clock packets carry microseconds of the
+ *	high resolution clock used by Alarm for the offset only: a client gets
+ *	the server time as its own time plus the server offset.
+ *
+ *	like ChannelLayer it doesn't own the socket callbacks: receive must be
+ *	called from the message receive callback before any other handler, it
+ *	returns true for a buffer of clock packets only. With a PacketDispatcher,
+ *	bind routes the clock packets through it instead, as a tcp socket needs.
+ *	Peers are added and removed from the client add and del callbacks,
+ *	update sends the pings due.
+ */
+
+class	ClockSync
+{
+	public:
+		typedef std::chrono::high_resolution_clock	clock;
+
+		ClockSync(ISocket &socket);
+		~ClockSync(void);
+
+		void	add(IClient *client);
+		void	remove(IClient *client);
+		bool	receive(IClient *client, const Message &packet);
+		void	bind(PacketDispatcher &dispatcher);
+		void	update(void);
+
+		static int64_t		getTime(void);
+		static int64_t		getRemoteTime(IClient *peer);
+		static clock::time_point	toLocal(IClient *peer, int64_t time);
+		static Alarm		alarm(IClient *peer, const Task &task, int64_t time);
+
+		ISocket	&getSocket(void);
+	private:
+		typedef struct	s_sample
+		{
+			int64_t	rtt;
+			int64_t	offset;
+		}				t_sample;
+
+		typedef struct	s_ping
+		{
+			int64_t									time;
+			std::chrono::steady_clock::time_point	sent;
+			bool									waiting;
+		}				t_ping;
+
+		typedef struct	s_peer
+		{
+			IClient									*client;
+			std::chrono::steady_clock::time_point	next;
+			t_ping									pings[CLOCK_SYNC_PENDING];
+			size_t									sent;
+			double									srtt;
+			double									rttvar;
+			t_sample								samples[CLOCK_SYNC_FILTER];
+			size_t									count;
+		}				t_peer;
+
+		Message	ping(t_peer &peer);
+		void	handle(IClient *client, int32_t type, const uint8_t *data, size_t size, std::chrono::steady_clock::time_point received, int64_t now);
+		void	sample(IClient *client, int64_t t0, int64_t t1, int64_t t2, int64_t t3, std::chrono::steady_clock::time_point received);
+
+		static void	dispatched(PacketDispatcher &dispatcher, IClient *client, const t_header &header, const uint8_t *data, size_t size);
+
+		std::recursive_mutex						_mutex;
+		ISocket&									_socket;
+		std::unordered_map<IClient::handle, t_peer>	_peers;
+};
+
+}
+
+}
@@ -0,0 +1,134 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "Message.h"
+
+#include <zlib.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//	messages smaller than this are sent raw, deflate wouldn't gain anything
+#ifndef COMPRESSOR_MIN_SIZE
+# define COMPRESSOR_MIN_SIZE	128
+#endif
+
+//	biggest frame or inflated message accepted from a peer
+#ifndef COMPRESSOR_MAX_FRAME_SIZE
+# define COMPRESSOR_MAX_FRAME_SIZE	(1 << 24)
+#endif
+
+#define COMPRESSOR_VERSION	1
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+typedef struct	s_compressionStats
+{
+	uint64_t	messagesSent;
+	uint64_t	messagesCompressed;
+	uint64_t	messagesReceived;
+	uint64_t	rawBytesSent;			//	size of compressed messages before deflate
+	uint64_t	compressedBytesSent;	//	and after
+	uint64_t	rawBytesReceived;		//	size of compressed messages after inflate
+	uint64_t	compressedBytesReceived;//	and before
+	uint64_t	deflateTime;			//	nanoseconds spent in deflate
+	uint64_t	inflateTime;			//	nanoseconds spent in inflate
+}				t_compressionStats;
+
+/*
+ *	per connection deflate stream over a stream socket
+ *
+ *	once enabled every message is sent in a frame:
+ *
+ *		uint8_t		type (RAW, DEFLATE or HELLO)
+ *		uint32_t	size
+ *		data
+ *
+ *	each side starts with a HELLO frame holding the version and the adler32
+ *	of its preset dictionary, and only sends DEFLATE frames once it received
+ *	a matching hello. Deflate frames share a single raw deflate stream per
+ *	direction, flushed after each message, so later messages reuse the
+ *	history of the previous ones and of the dictionary.
+ *
+ *	both ends of a connection must enable compression, framing isn't
+ *	compatible with a peer writing unframed messages.
+ */
+
+class	Compressor
+{
+	public:
+		typedef enum
+		{
+			RAW,
+			DEFLATE,
+			HELLO
+		}		frameType;
+
+		Compressor(int level = Z_DEFAULT_COMPRESSION, size_t minSize = COMPRESSOR_MIN_SIZE, const std::shared_ptr<const std::string> &dictionary = nullptr);
+		~Compressor(void);
+
+		void	hello(Message &dst);
+		bool	encode(const Message &src, Message &dst);
+		void	decode(const void *data, size_t size, std::vector<Message> &messages);
+
+		bool				isNegotiated(void) const;
+		t_compressionStats	getStats(void) const;
+		void				addStats(t_compressionStats &total) const;
+
+		static uint32_t		dictionaryId(const std::string &dictionary);
+		static double		getRatio(const t_compressionStats &stats);
+	private:
+		void	frame(frameType type, const void *data, size_t size, Message &dst);
+		void	receive(frameType type, const uint8_t *data, size_t size, std::vector<Message> &messages);
+
+		z_stream							_deflate;
+		z_stream							_inflate;
+		std::shared_ptr<const std::string>	_dictionary;
+		uint32_t							_dictionaryId;
+		size_t								_minSize;
+		std::vector<uint8_t>				_deflateBuffer;
+		std::vector<uint8_t>				_inflateBuffer;
+		Message								_pending;
+		std::atomic<bool>					_negotiated;
+
+		std::atomic<uint64_t>	_messagesSent;
+		std::atomic<uint64_t>	_messagesCompressed;
+		std::atomic<uint64_t>	_messagesReceived;
+		std::atomic<uint64_t>	_rawBytesSent;
+		std::atomic<uint64_t>	_compressedBytesSent;
+		std::atomic<uint64_t>	_rawBytesReceived;
+		std::atomic<uint64_t>	_compressedBytesReceived;
+		std::atomic<uint64_t>	_deflateTime;
+		std::atomic<uint64_t>	_inflateTime;
+};
+
+}
+
+}
@@ -0,0 +1,181 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "Message.h"
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+
+//	datagram payload used until a probe gets through, safe on any internet path
+#ifndef UDP_MTU_DEFAULT
+# define UDP_MTU_DEFAULT		1200
+#endif
+//	ethernet mtu minus the ip and udp headers
+#ifndef UDP_MTU_MAX
+# define UDP_MTU_MAX			1472
+#endif
+#ifndef UDP_MESSAGE_MAX_SIZE
+# define UDP_MESSAGE_MAX_SIZE	(1 << 20)
+#endif
+//	milliseconds an incomplete message waits for its missing fragments
+#ifndef UDP_REASSEMBLY_TIMEOUT
+# define UDP_REASSEMBLY_TIMEOUT	2000
+#endif
+//	incomplete messages kept per client, the oldest is dropped beyond
+#ifndef UDP_REASSEMBLY_MAX
+# define UDP_REASSEMBLY_MAX		8
+#endif
+//	bytes of incomplete messages kept per client, the oldest is dropped beyond
+#ifndef UDP_REASSEMBLY_CLIENT_SIZE
+# define UDP_REASSEMBLY_CLIENT_SIZE	(2 * UDP_MESSAGE_MAX_SIZE)
+#endif
+//	bytes of incomplete messages kept per socket, new messages are dropped beyond
+#ifndef UDP_REASSEMBLY_BUDGET
+# define UDP_REASSEMBLY_BUDGET	(16 * UDP_MESSAGE_MAX_SIZE)
+#endif
+#ifndef UDP_MTU_PROBE_INTERVAL
+# define UDP_MTU_PROBE_INTERVAL	1000
+#endif
+#ifndef UDP_MTU_PROBE_RETRIES
+# define UDP_MTU_PROBE_RETRIES	3
+#endif
+
+//	kind, message id, fragment index, fragment count, fragment size
+#define UDP_FRAGMENT_HEADER_SIZE	9
+//	kind, probed size
+#define UDP_PROBE_HEADER_SIZE		3
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+/*
+ *	recycles reassembly buffers so a message split in fragments is written
+ *	straight into its final storage, the buffers keep their capacity
+ *
+ *	shared by every client of a socket, it also holds the budget of bytes
+ *	all their incomplete messages can take: a reassembly reserves its size
+ *	before acquiring its buffer, so a first fragment from each of many
+ *	spoofed hosts can't make the socket allocate without bound.
+ */
+
+class	MessagePool
+{
+	public:
+		MessagePool(size_t max = UDP_REASSEMBLY_MAX, size_t budget = UDP_REASSEMBLY_BUDGET);
+		~MessagePool(void);
+
+		Message	acquire(size_t size);
+		void	release(Message &&message);
+		bool	reserve(size_t size);
+		void	unreserve(size_t size);
+	private:
+		std::vector<Message>	_free;
+		size_t					_max;
+		size_t					_budget;
+		size_t					_reserved;
+};
+
+/*
+ *	fragmentation state of a udp client, not thread safe
+ *
+ *	every datagram starts with its kind. A message larger than the mtu is
+ *	split in fragments of the same size but the last one, each fragment is
+ *	copied at its offset in a pooled buffer and a bitmap tracks the ones
+ *	received, so duplicates are ignored and the message is delivered
+ *	without another copy once complete. A client keeps at most
+ *	UDP_REASSEMBLY_MAX messages and UDP_REASSEMBLY_CLIENT_SIZE bytes in
+ *	flight, its oldest message is dropped to make room for a new one.
+ *
+ *	the mtu starts at UDP_MTU_DEFAULT, probes padded to larger sizes are
+ *	sent with the don't fragment bit where the system allows it, the
+ *	largest probe acknowledged by the peer becomes the mtu.
+ */
+
+class	Fragmenter
+{
+	public:
+		typedef enum
+		{
+			WHOLE,
+			FRAGMENT,
+			PROBE,
+			PROBE_ACK,
+			BUNDLE
+		}		kind;
+
+		typedef struct	s_fragment
+		{
+			uint16_t	id;
+			uint16_t	index;
+			uint16_t	count;
+			uint16_t	size;
+		}				t_fragment;
+
+		Fragmenter(void);
+		~Fragmenter(void);
+
+		size_t		getMtu(void) const;
+		uint16_t	nextId(void);
+
+		bool	probe(std::chrono::steady_clock::time_point now, std::vector<uint16_t> &sizes);
+		void	acknowledge(uint16_t size);
+
+		bool	add(const t_fragment &fragment, const uint8_t *data, size_t size, MessagePool &buffers, std::chrono::steady_clock::time_point now, Message &message);
+		size_t	expire(std::chrono::steady_clock::time_point now, MessagePool &buffers);
+		void	clear(MessagePool &buffers);
+
+		static void	write(uint8_t *data, const t_fragment &fragment);
+		static bool	read(const uint8_t *data, size_t size, t_fragment &fragment);
+	private:
+		typedef struct	s_reassembly
+		{
+			Message									buffer;
+			std::vector<uint64_t>					bitmap;
+			uint16_t								count;
+			uint16_t								received;
+			uint16_t								size;
+			size_t									last;	//	size of the last fragment
+			std::chrono::steady_clock::time_point	start;
+		}				t_reassembly;
+
+		void	drop(uint16_t id, MessagePool &buffers);
+
+		std::unordered_map<uint16_t, t_reassembly>	_reassembly;
+		size_t										_reserved;
+		size_t										_mtu;
+		uint16_t									_id;
+		unsigned									_probes;
+		std::chrono::steady_clock::time_point		_probeTime;
+};
+
+}
+
+}
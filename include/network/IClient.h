@@ -25,6 +25,7 @@
 #pragma once
 
 #include "Message.h"
+#include "network/Metrics.h"
 
 #ifndef SOCKET_BUFFER_SIZE
 # define SOCKET_BUFFER_SIZE	1024
@@ -46,6 +47,9 @@ namespace	network
 class	IClient
 {
 	public:
+		typedef uint64_t	handle;
+
+		IClient(void);
 		virtual ~IClient(void);
 
 		virtual const IPaddress	&getAddress(void) const = 0;
@@ -60,10 +64,33 @@ class	IClient
 		void			attachData(void *data);
 		void			*getData(void);
 
+		handle			getHandle(void) const;
+		void			setHandle(handle id);
+
+		void					addSent(uint64_t messages, uint64_t bytes);
+		void					addReceived(uint64_t messages, uint64_t bytes);
+		void					addDrop(void);
+		virtual t_clientMetrics	getMetrics(void);
+
+		void		setClock(int64_t rtt, int64_t rttVar, int64_t offset);
+		bool		hasClock(void) const;
+		int64_t		getRtt(void) const;
+		int64_t		getRttVar(void) const;
+		int64_t		getClockOffset(void) const;
+
 		virtual bool	operator==(const IPaddress &address) const = 0;
 		virtual bool	operator==(const IClient &client) const = 0;
 	private:
-		void	*_data;
+		void					*_data;
+		handle					_handle;
+		std::atomic<uint64_t>	_messagesSent;
+		std::atomic<uint64_t>	_messagesReceived;
+		std::atomic<uint64_t>	_bytesSent;
+		std::atomic<uint64_t>	_bytesReceived;
+		std::atomic<uint64_t>	_sendDrops;
+		std::atomic<int64_t>	_rtt;			//	microseconds, from ClockSync
+		std::atomic<int64_t>	_rttVar;
+		std::atomic<int64_t>	_clockOffset;	//	peer clock minus local clock
 };
 
 }
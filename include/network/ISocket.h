@@ -25,24 +25,50 @@
 #pragma once
 
 #include "network/IClient.h"
+#include "SlotMap.h"
+#include "TaskQueue.h"
 
 #include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <unordered_map>
 
 #ifndef SOCKET_READ_BUFFER_SIZE
 # define SOCKET_READ_BUFFER_SIZE	4096
 #endif
 
+//	ms the destructor of a socket waits for the workers to run any queued event before giving up
+#ifndef SOCKET_DRAIN_TIMEOUT
+# define SOCKET_DRAIN_TIMEOUT	1000
+#endif
+
 namespace	ExoEngine
 {
 
 namespace	network
 {
 
+class	Recorder;
+class	LinkConditioner;
+
+}
+
+namespace	reflection
+{
+
+class	IReflectable;
+
+}
+
+namespace	network
+{
+
 class	ISocket
 {
 	public:
 		ISocket(size_t size);
-		~ISocket(void);
+		virtual ~ISocket(void);
 
 		virtual void	bind(uint16_t port) = 0;
 		virtual void	bind(const std::string &port) = 0;
@@ -50,12 +76,17 @@ class	ISocket
 		virtual void	connect(const std::string &address, const std::string &port) = 0;
 		virtual void	connect(const std::string &address, uint16_t port) = 0;
 		virtual void	disconnect(IClient *client) = 0;
+		void			disconnect(IClient::handle handle);
 		virtual void	pollEvent(uint8_t mask) = 0;
 		virtual void	send(IClient *client, const Message &message) = 0;
+		virtual void	send(IClient *client, reflection::IReflectable &object);
+		void			broadcast(const Message &message);
 
 		virtual SDLNet_GenericSocket	getSocket(void) = 0;
 
-		size_t	getClientsNumber(void);
+		size_t			getClientsNumber(void);
+		IClient			*getClient(IClient::handle handle);
+		t_socketMetrics	getMetrics(void);
 
 		bool	isBind(void);
 		void	setTimeout(Uint32 timeout);
@@ -63,13 +94,18 @@ class	ISocket
 		typedef enum
 		{
 			TCP,
-			UDP
+			UDP,
+			LOOPBACK
 		}		type;
 		virtual type	getType(void) const = 0;
 
 		void	attachData(void *data);
 		void	*getData(void);
 
+		void	setTaskQueue(TaskQueue *tasks);
+		void	setRecorder(Recorder *recorder);
+		void	setLinkConditioner(LinkConditioner *conditioner);
+
 		void	setClientAddCb(void(*callback)(ISocket &, IClient *));
 		void	setClientDelCb(void(*callback)(ISocket &, IClient *));
 		void	setClientExceptionCb(void(*callback)(ISocket &, IClient *));
@@ -79,14 +115,37 @@ class	ISocket
 		void	setSocketUnbindCb(void(*callback)(ISocket &, uint16_t port));
 		void	setSocketExceptionCb(void(*callback)(ISocket &));
 	protected:
+		void			onClientAdd(IClient *client);
+		void			onClientDel(IClient *client);
+		void			onClientException(IClient *client);
+		void			onMessageSend(IClient *client, const Message &message);
+		void			onMessageReceive(IClient *client, const Message &message);
+		static void		messageSent(ISocket &socket, IClient *client, const Message &message);
+		bool			deferRelease(IClient *client);
+		void			schedulePending(void);
+		void			drainEvents(void);
+		bool			condition(IClient *client, const Message &message);
+		bool			owns(IClient *client);
+		void			countSent(IClient *client, uint64_t messages, uint64_t bytes);
+		void			countReceived(IClient *client, uint64_t bytes);
+		void			countDrop(IClient *client);
+		void			countBatch(uint64_t received);
+		void			releaseConditioned(void);
+		Uint32			pollTimeout(void);
+		virtual void	transmit(IClient *client, const Message &message) = 0;
+		virtual void	destroy(IClient *client) = 0;
+
 		std::recursive_mutex	_mutex;
 		SDLNet_SocketSet		_set;
 		size_t					_clients_max;
-		std::vector<IClient *>	_clients;
+		SlotMap<IClient *>		_clients;
 		bool					_binded;
 		uint16_t				_port;
 		Uint32					_timeout;
 		void					*_data;
+		Recorder				*_recorder;
+		LinkConditioner			*_conditioner;
+		SocketCounters			_counters;
 		void					(*_clientAddCb)(ISocket &socket, IClient *client);
 		void					(*_clientDelCb)(ISocket &socket, IClient *client);
 		void					(*_clientExceptionCb)(ISocket &socket, IClient *client);
@@ -95,6 +154,43 @@ class	ISocket
 		void					(*_socketBindCb)(ISocket &socket, uint16_t port);
 		void					(*_socketUnbindCb)(ISocket &socket, uint16_t port);
 		void					(*_socketExceptionCb)(ISocket &socket);
+	private:
+		typedef enum
+		{
+			CLIENT_ADD,
+			CLIENT_DEL,
+			CLIENT_EXCEPTION,
+			MESSAGE_SEND,
+			MESSAGE_RECEIVE
+		}		eventType;
+
+		typedef struct	s_event
+		{
+			eventType	type;
+			Message		message;
+		}				t_event;
+
+		//	events of a client waiting for a worker, run in order by at most one worker at a time
+		typedef struct	s_clientEvents
+		{
+			ISocket				*socket;
+			IClient				*client;
+			std::mutex			mutex;
+			std::deque<t_event>	events;
+			bool				scheduled;
+			bool				released;
+		}				t_clientEvents;
+
+		void		deliver(IClient *client, const Message &message);
+		void		dispatch(eventType type, IClient *client, const Message &message);
+		void		invoke(eventType type, IClient *client, const Message &message);
+		void		schedule(t_clientEvents *record);
+		static void	run(void *data);
+
+		TaskQueue											*_tasks;
+		std::unordered_map<IClient::handle, t_clientEvents *>	_events;
+		std::vector<t_clientEvents *>						_pending;
+		std::condition_variable_any							_drained;
 };
 
 }
@@ -0,0 +1,124 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/Snapshot.h"
+#include "network/IClient.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <glm/vec2.hpp>
+
+namespace	ExoEngine
+{
+
+class	World;
+
+namespace	network
+{
+
+/*
+ *	area of interest filtering
+ *
+ *	objects are hashed in a grid of square cells, each client sees the
+ *	cells within its view range around its view center (its camera).
+ *	Each cell knows the clients watching it, so an object changing cell or
+ *	a client moving its view only visits the cells involved: enter and
+ *	leave callbacks are called when an object becomes relevant to a client
+ *	or stops being relevant.
+ *
+ *	relevant objects accumulate a priority at each update, higher for
+ *	objects closer to the view center, so a bandwidth limited sender can
+ *	pick the most urgent objects first and reset them once sent.
+ */
+
+class	InterestManager
+{
+	public:
+		InterestManager(float cellSize, float viewRange);
+		~InterestManager(void);
+
+		void	update(World &world);
+
+		void	setView(IClient::handle client, const glm::vec2 &center);
+		void	remove(IClient::handle client);
+
+		bool	isRelevant(IClient::handle client, size_t object);
+		size_t	getPriorities(IClient::handle client, size_t max, std::vector<size_t> &dst);
+		void	resetPriority(IClient::handle client, size_t object);
+		void	filter(IClient::handle client, const Snapshot &src, Snapshot &dst);
+
+		void	attachData(void *data);
+		void	*getData(void);
+
+		void	setObjectEnterCb(void(*callback)(InterestManager &, IClient::handle, size_t));
+		void	setObjectLeaveCb(void(*callback)(InterestManager &, IClient::handle, size_t));
+	private:
+		typedef struct	s_cell
+		{
+			std::vector<size_t>				objects;
+			std::vector<IClient::handle>	watchers;
+		}				t_cell;
+
+		typedef struct	s_object
+		{
+			int32_t		x;
+			int32_t		y;
+			glm::vec2	pos;
+			uint32_t	stamp;
+		}				t_object;
+
+		typedef struct	s_client
+		{
+			int32_t								x;
+			int32_t								y;
+			glm::vec2							center;
+			bool								hasView;
+			std::unordered_map<size_t, float>	relevant;
+		}				t_client;
+
+		static uint64_t	key(int32_t x, int32_t y);
+		int32_t			cell(float position) const;
+
+		void			moveObject(size_t id, t_object &object, int32_t x, int32_t y);
+		void			removeObject(size_t id, const t_object &object);
+		void			enter(IClient::handle handle, t_client &client, size_t object);
+		void			leave(IClient::handle handle, t_client &client, size_t object);
+
+		std::recursive_mutex							_mutex;
+		float											_cellSize;
+		int32_t											_range;
+		uint32_t										_stamp;
+		std::unordered_map<uint64_t, t_cell>			_cells;
+		std::unordered_map<size_t, t_object>			_objects;
+		std::unordered_map<IClient::handle, t_client>	_clients;
+		void											*_data;
+		void											(*_objectEnterCb)(InterestManager &manager, IClient::handle client, size_t object);
+		void											(*_objectLeaveCb)(InterestManager &manager, IClient::handle client, size_t object);
+};
+
+}
+
+}
@@ -0,0 +1,133 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/Snapshot.h"
+
+#include <chrono>
+#include <unordered_map>
+
+//	states kept per remote object
+#ifndef INTERPOLATION_SAMPLES
+# define INTERPOLATION_SAMPLES				32
+#endif
+//	bounds of the playout delay, in seconds
+#ifndef INTERPOLATION_MIN_DELAY
+# define INTERPOLATION_MIN_DELAY			0.010
+#endif
+#ifndef INTERPOLATION_MAX_DELAY
+# define INTERPOLATION_MAX_DELAY			0.500
+#endif
+//	jitters of margin in the playout delay, on top of one snapshot interval
+#ifndef INTERPOLATION_JITTER_FACTOR
+# define INTERPOLATION_JITTER_FACTOR		4.0
+#endif
+//	part of the elapsed time the delay may change by, so the playout never jumps
+#ifndef INTERPOLATION_DELAY_SLEW
+# define INTERPOLATION_DELAY_SLEW			0.1
+#endif
+//	seconds a late object keeps moving at its last speed before it stops
+#ifndef INTERPOLATION_MAX_EXTRAPOLATION
+# define INTERPOLATION_MAX_EXTRAPOLATION	0.250
+#endif
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+/*
+ *	jitter buffer of the remote objects, not thread safe
+ *
+ *	snapshots are added with the server time they were taken at, each
+ *	object keeps its last INTERPOLATION_SAMPLES states in a fixed ring.
+ *	Objects are rendered in the past, at the local time minus the transit
+ *	time minus the playout delay, between the two states around that time.
+ *	When the next state is late, the object goes on at its last speed for
+ *	INTERPOLATION_MAX_EXTRAPOLATION seconds then stops.
+ *
+ *	the jitter is the mean deviation of the transit time, as in RFC 3550.
+ *	The playout delay targets one snapshot interval plus
+ *	INTERPOLATION_JITTER_FACTOR jitters, so it stays small on a steady
+ *	link and grows when arrivals get uneven. It moves towards the target
+ *	by a part of the elapsed time, the playout slows down or speeds up a bit
+ *	instead of jumping.
+ */
+
+class	Interpolator
+{
+	public:
+		typedef std::chrono::steady_clock::time_point	timePoint;
+
+		typedef struct	s_sample
+		{
+			double		time;
+			glm::vec2	pos;
+			glm::vec2	speed;
+			float		angle;
+		}				t_sample;
+
+		Interpolator(void);
+		~Interpolator(void);
+
+		void	add(double time, const Snapshot &snapshot, timePoint now = std::chrono::steady_clock::now());
+		void	add(size_t id, double time, const Snapshot::t_objectState &state);
+		void	arrival(double time, timePoint now);
+		void	remove(size_t id);
+		void	clear(void);
+
+		double	update(timePoint now = std::chrono::steady_clock::now());
+		bool	sample(size_t id, t_sample &dst) const;
+		bool	sample(size_t id, double time, t_sample &dst) const;
+		void	apply(World &world) const;
+
+		double	getRenderTime(void) const;
+		double	getDelay(void) const;
+		double	getJitter(void) const;
+		double	getInterval(void) const;
+	private:
+		typedef struct	s_track
+		{
+			t_sample	ring[INTERPOLATION_SAMPLES];
+			size_t		count;
+			size_t		next;
+		}				t_track;
+
+		std::unordered_map<size_t, t_track>	_tracks;
+		timePoint							_epoch;
+		bool								_started;
+		double								_lastTime;
+		double								_lastLocal;
+		double								_transit;
+		double								_jitter;
+		double								_interval;
+		double								_delay;
+		double								_renderTime;
+};
+
+}
+
+}
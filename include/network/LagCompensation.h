@@ -0,0 +1,114 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "Object.h"
+
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+#include <glm/vec2.hpp>
+
+//	ticks remembered, a second at 60 ticks per second
+#ifndef LAG_COMPENSATION_TICKS
+# define LAG_COMPENSATION_TICKS			64
+#endif
+//	objects remembered per tick, the ones with the highest ids are left out beyond
+#ifndef LAG_COMPENSATION_MAX_OBJECTS
+# define LAG_COMPENSATION_MAX_OBJECTS	4096
+#endif
+
+namespace	ExoEngine
+{
+
+class	World;
+
+namespace	network
+{
+
+/*
+ *	poses of the world objects over the last LAG_COMPENSATION_TICKS ticks,
+ *	so a hit can be tested against the world as the shooter saw it
+ *
+ *	each tick is stored as arrays of ids, positions, angles and scales
+ *	sorted by id, reused from one round of the ring to the next: memory is
+ *	bounded by the ticks times LAG_COMPENSATION_MAX_OBJECTS. A rewound pose
+ *	is interpolated between the two ticks around the time, found by a binary
+ *	search on the ids. Times older than the history are clamped to it.
+ *	Angles are kept in double, objects turning freely aren't wrapped and
+ *	lose their precision in float. They are blended along the shortest
+ *	turn, a hitbox looks the same every half turn.
+ */
+
+class	LagCompensation
+{
+	public:
+		typedef struct	s_pose
+		{
+			glm::vec2	pos;
+			glm::vec2	scale;
+			double		angle;
+		}				t_pose;
+
+		LagCompensation(void);
+		~LagCompensation(void);
+
+		void	record(World &world, double time);
+		void	clear(void);
+
+		bool	pose(size_t id, double time, t_pose &dst);
+		bool	collide(size_t id, double time, const glm::vec2 &point);
+		size_t	collide(double time, const glm::vec2 &point, std::vector<size_t> &hits);
+
+		double	getOldest(void);
+		double	getNewest(void);
+	private:
+		typedef struct	s_frame
+		{
+			double				time;
+			std::vector<size_t>	ids;
+			std::vector<float>	x;
+			std::vector<float>	y;
+			std::vector<double>	angle;
+			std::vector<float>	width;
+			std::vector<float>	height;
+		}				t_frame;
+
+		double	locate(double time, const t_frame *&before, const t_frame *&after);
+		bool	pose(const t_frame *before, const t_frame *after, double ratio, size_t id, t_pose &dst);
+
+		static size_t	find(const t_frame &frame, size_t id);
+		static void		get(const t_frame &frame, size_t index, t_pose &dst);
+		static void		blend(t_pose &dst, const t_pose &next, double ratio);
+
+		std::mutex	_mutex;
+		t_frame		_frames[LAG_COMPENSATION_TICKS];
+		size_t		_next;
+		size_t		_count;
+};
+
+}
+
+}
@@ -0,0 +1,133 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/IClient.h"
+
+#include <mutex>
+#include <queue>
+#include <random>
+#include <chrono>
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+typedef struct	s_linkProfile
+{
+	uint32_t	latency;		//	milliseconds added to every message
+	uint32_t	jitter;			//	up to this many milliseconds added at random
+	double		loss;			//	probability a message is dropped
+	double		duplicate;		//	probability a message is delivered twice
+	double		reorder;		//	probability a message is held back and overtaken
+	uint32_t	reorderDelay;	//	milliseconds a reordered message is held back
+	uint64_t	bandwidth;		//	bytes per second, 0 for unlimited
+	uint64_t	burst;			//	bytes sent at once before the bandwidth applies
+}				t_linkProfile;
+
+typedef struct	s_linkStats
+{
+	uint64_t	passed;
+	uint64_t	dropped;
+	uint64_t	duplicated;
+	uint64_t	reordered;
+	uint64_t	bytes;
+}				t_linkStats;
+
+/*
+ *	degrades the traffic of the sockets it's set on
+ *
+ *	each direction is a link with its own profile: a message waits for the
+ *	bandwidth, then for the latency and the jitter, and is delivered by the
+ *	first pollEvent of its socket after that time, sockets shorten their poll
+ *	timeout to the next due message. Messages of a link keep their order
+ *	unless reordered.
+ *
+ *	every random draw comes from a generator seeded at construction, a run
+ *	is reproduced as long as the messages come in the same order. Loss,
+ *	duplication and reordering break tcp streams, they are meant for udp.
+ */
+
+class	LinkConditioner
+{
+	public:
+		typedef enum
+		{
+			INBOUND,
+			OUTBOUND
+		}		direction;
+
+		typedef struct	s_event
+		{
+			std::chrono::steady_clock::time_point	time;
+			uint64_t								order;
+			direction								way;
+			IClient::handle							handle;
+			Message									message;
+		}				t_event;
+
+		LinkConditioner(uint32_t seed = 0);
+		~LinkConditioner(void);
+
+		void			setProfile(const t_linkProfile &profile);
+		void			setProfile(direction way, const t_linkProfile &profile);
+		t_linkProfile	getProfile(direction way);
+		t_linkStats		getStats(direction way);
+
+		bool	condition(direction way, IClient::handle handle, const Message &message);
+		bool	next(t_event &event);
+		bool	nextDue(std::chrono::steady_clock::time_point &time);
+	private:
+		typedef struct	s_link
+		{
+			t_linkProfile							profile;
+			t_linkStats								stats;
+			std::chrono::steady_clock::time_point	free;
+			std::chrono::steady_clock::time_point	last;
+		}				t_link;
+
+		struct	later
+		{
+			bool	operator()(const t_event &a, const t_event &b) const
+			{
+				return (a.time > b.time || (a.time == b.time && a.order > b.order));
+			}
+		};
+
+		double	random(void);
+		void	push(t_link &link, direction way, IClient::handle handle, const Message &message, std::chrono::steady_clock::time_point time);
+
+		std::mutex												_mutex;
+		std::mt19937											_random;
+		t_link													_links[2];
+		std::priority_queue<t_event, std::vector<t_event>, later>	_events;
+		uint64_t												_order;
+};
+
+}
+
+}
@@ -0,0 +1,115 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/IClient.h"
+#include "SpscRing.h"
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+//	messages each direction of a loopback connection can hold before send fails
+#ifndef LOOPBACK_RING_SIZE
+# define LOOPBACK_RING_SIZE	4096
+#endif
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+//	wakes a LoopbackSocket waiting in pollEvent
+typedef struct	s_loopbackDoorbell
+{
+	void	ring(void)
+	{
+		mutex.lock();
+		rung = true;
+		mutex.unlock();
+		cond.notify_one();
+	}
+
+	std::mutex				mutex;
+	std::condition_variable	cond;
+	bool					rung;
+}				t_loopbackDoorbell;
+
+/*
+ *	both ends of a loopback connection
+ *
+ *	end i reads rings[i] and is woken by doorbells[i], writers[i] serializes
+ *	the threads sending to end i so each ring keeps a single producer.
+ *	addresses[i] is the address end i sees its peer at.
+ */
+typedef struct	s_loopbackPipe
+{
+	s_loopbackPipe(size_t capacity) : rings{SpscRing<Message>(capacity), SpscRing<Message>(capacity)}, closed{{false}, {false}}
+	{
+	}
+
+	SpscRing<Message>					rings[2];
+	std::mutex							writers[2];
+	std::atomic<bool>					closed[2];
+	std::shared_ptr<t_loopbackDoorbell>	doorbells[2];
+	IPaddress							addresses[2];
+}				t_loopbackPipe;
+
+class	LoopbackClient : public virtual IClient
+{
+	public:
+		LoopbackClient(const std::shared_ptr<t_loopbackPipe> &pipe, uint8_t end);
+		virtual ~LoopbackClient(void);
+
+		virtual const IPaddress	&getAddress(void) const;
+		virtual std::string		getStrAddress(void) const;
+		virtual std::string		getStrPort(void) const;
+		virtual std::string		getHost(void) const;
+
+		virtual SDLNet_GenericSocket	&getSocket(void);
+
+		virtual void	updateAddress(const IPaddress &address);
+
+		bool	write(Message &&message);
+		bool	write(const Message &message);
+		bool	read(Message &message);
+		void	close(void);
+		bool	isClosed(void) const;
+
+		virtual bool	operator==(const IPaddress &address) const;
+		virtual bool	operator==(const IClient &client) const;
+	private:
+		void	ring(void);
+
+		std::shared_ptr<t_loopbackPipe>	_pipe;
+		uint8_t							_end;
+		SDLNet_GenericSocket			_socket;
+};
+
+}
+
+}
@@ -0,0 +1,96 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/ISocket.h"
+#include "network/LoopbackClient.h"
+#include "MpscQueue.h"
+#include "Pool.h"
+
+#include <unordered_map>
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+/*
+ *	in-process socket for a listen server and local bots
+ *
+ *	ports are a registry shared by every LoopbackSocket of the process,
+ *	bind claims a port and connect hands a pipe of two rings to the socket
+ *	bound to it, the address given to connect is ignored. Messages are moved
+ *	between threads through the rings, neither send nor pollEvent makes a
+ *	system call unless pollEvent has nothing to do and waits for its timeout.
+ *
+ *	send can be called from any thread, it takes the socket mutex so the
+ *	client can't be released meanwhile, pollEvent doesn't hold it while
+ *	waiting. It fails with an exception when the peer ring is full: unlike
+ *	tcp there is no kernel buffer behind it.
+ */
+
+class	LoopbackSocket : public ISocket
+{
+	public:
+		LoopbackSocket(size_t size, size_t capacity = LOOPBACK_RING_SIZE);
+		~LoopbackSocket(void);
+
+		virtual void	bind(uint16_t port);
+		virtual void	bind(const std::string &port);
+		virtual void	unbind(void);
+		virtual void	connect(const std::string &address, const std::string &port);
+		virtual void	connect(const std::string &address, uint16_t port);
+		virtual void	disconnect(IClient *client);
+		using			ISocket::disconnect;
+		using			ISocket::send;
+		virtual void	pollEvent(uint8_t mask);
+		virtual void	send(IClient *client, const Message &message);
+		void			send(IClient *client, Message &&message);
+		virtual void	send(IClient *client, reflection::IReflectable &object);
+
+		virtual SDLNet_GenericSocket	getSocket(void);
+		virtual type	getType(void) const;
+	private:
+		virtual void	transmit(IClient *client, const Message &message);
+		bool			process(void);
+		void			adopt(const std::shared_ptr<t_loopbackPipe> &pipe);
+		void			failed(LoopbackClient *client);
+		void			release(IClient *client);
+		virtual void	destroy(IClient *client);
+
+		static std::mutex									_registryMutex;
+		static std::unordered_map<uint16_t, LoopbackSocket *>	_registry;
+		static std::atomic<uint32_t>						_ephemeral;
+
+		size_t										_capacity;
+		std::shared_ptr<t_loopbackDoorbell>			_doorbell;
+		MpscQueue<std::shared_ptr<t_loopbackPipe>>	_incoming;
+		Pool<LoopbackClient>						_pool;
+};
+
+}
+
+}
@@ -0,0 +1,129 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+//	power of two buckets, bucket i counts values in [2^(i - 1), 2^i), bucket 0 counts zeros
+#define METRICS_HISTOGRAM_BUCKETS	40
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+typedef struct	s_histogram
+{
+	uint64_t	buckets[METRICS_HISTOGRAM_BUCKETS];
+	uint64_t	count;
+	uint64_t	sum;
+	uint64_t	max;
+}				t_histogram;
+
+typedef struct	s_clientMetrics
+{
+	uint64_t	messagesSent;
+	uint64_t	messagesReceived;
+	uint64_t	bytesSent;
+	uint64_t	bytesReceived;
+	uint64_t	sendDrops;
+	uint64_t	sendQueue;		//	bytes waiting to be written
+	uint64_t	rtt;			//	microseconds, 0 if unknown
+	uint64_t	rttVar;			//	microseconds
+}				t_clientMetrics;
+
+typedef struct	s_socketMetrics
+{
+	uint64_t	clients;
+	uint64_t	clientsAdded;
+	uint64_t	clientsRemoved;
+	uint64_t	clientExceptions;
+	uint64_t	messagesSent;
+	uint64_t	messagesReceived;
+	uint64_t	bytesSent;
+	uint64_t	bytesReceived;
+	uint64_t	sendDrops;
+	uint64_t	sendErrors;
+	uint64_t	sendQueue;		//	bytes waiting in every client queue
+	t_histogram	receiveBatch;	//	messages received per pollEvent
+	t_histogram	messageSize;	//	bytes per received message
+	t_histogram	rtt;			//	microseconds, one sample per client with a known rtt
+}				t_socketMetrics;
+
+/*
+ *	lock-free histogram, record can be called from any thread
+ *
+ *	a snapshot isn't atomic as a whole, a record running concurrently may
+ *	be counted in the buckets but not yet in the count
+ */
+
+class	Histogram
+{
+	public:
+		Histogram(void);
+		~Histogram(void);
+
+		void		record(uint64_t value);
+		t_histogram	snapshot(void) const;
+
+		static void		clear(t_histogram &histogram);
+		static void		add(t_histogram &histogram, uint64_t value);
+		static uint64_t	percentile(const t_histogram &histogram, double p);
+		static t_histogram	difference(const t_histogram &current, const t_histogram &previous);
+	private:
+		std::atomic<uint64_t>	_buckets[METRICS_HISTOGRAM_BUCKETS];
+		std::atomic<uint64_t>	_count;
+		std::atomic<uint64_t>	_sum;
+		std::atomic<uint64_t>	_max;
+};
+
+//	counters of a socket, bumped by its I/O paths without taking the socket mutex
+class	SocketCounters
+{
+	public:
+		SocketCounters(void);
+		~SocketCounters(void);
+
+		t_socketMetrics	snapshot(void) const;
+
+		std::atomic<uint64_t>	clientsAdded;
+		std::atomic<uint64_t>	clientsRemoved;
+		std::atomic<uint64_t>	clientExceptions;
+		std::atomic<uint64_t>	messagesSent;
+		std::atomic<uint64_t>	messagesReceived;
+		std::atomic<uint64_t>	bytesSent;
+		std::atomic<uint64_t>	bytesReceived;
+		std::atomic<uint64_t>	sendDrops;
+		std::atomic<uint64_t>	sendErrors;
+		Histogram				receiveBatch;
+		Histogram				messageSize;
+};
+
+}
+
+}
@@ -0,0 +1,74 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/ISocket.h"
+
+#include <thread>
+#include <condition_variable>
+#include <fstream>
+#include <chrono>
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+/*
+ *	dumps the metrics of a socket every period milliseconds, one line per
+ *	dump, to the log or appended to a file when a path is given. Rates and
+ *	the batch and size percentiles cover the time since the previous dump,
+ *	the rtt percentiles the clients connected at the dump. The socket must
+ *	outlive the reporter.
+ */
+
+class	MetricsReporter
+{
+	public:
+		MetricsReporter(ISocket &socket, const std::string &name, uint32_t period = 1000, const std::string &path = "");
+		~MetricsReporter(void);
+
+		void		report(void);
+
+		static std::string	format(const t_socketMetrics &metrics, const t_socketMetrics &last, double seconds);
+	private:
+		void	loop(void);
+
+		ISocket									&_socket;
+		std::string								_name;
+		uint32_t								_period;
+		std::ofstream							_file;
+		std::mutex								_mutex;
+		std::condition_variable					_cond;
+		bool									_stop;
+		t_socketMetrics							_last;
+		std::chrono::steady_clock::time_point	_time;
+		std::thread								_thread;
+};
+
+}
+
+}
@@ -0,0 +1,126 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "Message.h"
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+
+#ifndef OUTBOUND_QUEUE_HIGH_WATER_MARK
+# define OUTBOUND_QUEUE_HIGH_WATER_MARK	(1 << 20)
+#endif
+
+#ifndef OUTBOUND_QUEUE_IOV_MAX
+# define OUTBOUND_QUEUE_IOV_MAX	64
+#endif
+
+//	sent buffers kept for acquire
+#ifndef OUTBOUND_QUEUE_POOL_SIZE
+# define OUTBOUND_QUEUE_POOL_SIZE	64
+#endif
+
+//	capacity above which a sent buffer is freed instead of kept
+#ifndef OUTBOUND_QUEUE_POOL_MAX_CAPACITY
+# define OUTBOUND_QUEUE_POOL_MAX_CAPACITY	PAQUET_MAX_SIZE
+#endif
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+class	ISocket;
+class	IClient;
+
+/*
+ *	per client queue of messages waiting to be written on a stream socket
+ *
+ *	push can be called from any thread and never touches the socket,
+ *	flush must only be called by the thread polling the socket: it writes as
+ *	many queued messages as possible in a single non-blocking gathered write
+ *	and keeps the remaining bytes for the next call.
+ *
+ *	the buffers of sent messages are kept, acquire hands one out so a
+ *	message can be built in place and pushed without a copy.
+ *
+ *	a frame built from a message, compressed for instance, is pushed with
+ *	the message: the send callback is given the message and not the bytes
+ *	written. It isn't called for a frame pushed without one.
+ */
+
+class	OutboundQueue
+{
+	public:
+		//	what happens to a client whose queue exceeds the high-water mark
+		typedef enum
+		{
+			DROP,
+			DISCONNECT
+		}		policy;
+
+		OutboundQueue(size_t highWaterMark = OUTBOUND_QUEUE_HIGH_WATER_MARK, policy slowConsumer = DISCONNECT);
+		~OutboundQueue(void);
+
+		bool	push(const Message &message);
+		bool	push(Message &&message);
+		bool	push(Message &&frame, Message &&original);
+		Message	acquire(size_t size);
+		int		flush(int fd, ISocket &socket, IClient *client, void (*sentCb)(ISocket &, IClient *, const Message &));
+		void	clear(void);
+		void	abort(void);
+
+		size_t	getPending(void) const;
+		bool	isEmpty(void) const;
+		bool	overflowed(void) const;
+
+		void	setHighWaterMark(size_t highWaterMark);
+		void	setPolicy(policy slowConsumer);
+	private:
+		typedef struct	s_entry
+		{
+			Message	data;		//	bytes written
+			Message	original;	//	message the frame was built from
+			bool	framed;
+		}				t_entry;
+
+		bool	push(t_entry &&entry);
+
+		std::mutex				_mutex;
+		std::deque<t_entry>		_messages;
+		std::vector<t_entry>	_sent;
+		std::vector<Message>	_free;
+		size_t					_offset;
+		std::atomic<size_t>		_pending;
+		std::atomic<bool>		_overflow;
+		size_t					_highWaterMark;
+		policy					_policy;
+};
+
+}
+
+}
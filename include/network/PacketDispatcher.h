@@ -0,0 +1,157 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/network.h"
+#include "Reflectable.h"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <type_traits>
+
+//	packet types a dispatcher can bind, types are indexes in its table
+#ifndef PACKET_DISPATCHER_TYPES
+# define PACKET_DISPATCHER_TYPES	256
+#endif
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+/*
+ *	routes t_header packets to the handler bound to their type
+ *
+ *	the handler table is indexed by the type, so a dispatch is a bounds
+ *	check and an indirect call. A received buffer is split in packets by
+ *	their header.size: on a tcp socket a buffer can hold several packets
+ *	and end in the middle of one, whose start is kept for the next buffer
+ *	of the client until release. A packet is rejected when header.size is
+ *	shorter than the header, above PAQUET_MAX_SIZE or, on a datagram
+ *	socket, beyond the buffer, or when no handler is bound to its type, the
+ *	sender then gets a TYPE_INVALID_PACKET_SIZE or TYPE_INVALID_PACKET_TYPE
+ *	packet. Error packets are never answered.
+ *
+ *	bind<T> decodes the payload into a reflected T read straight from the
+ *	received buffer, the T is kept per thread and handler so no object is
+ *	built per packet: the handler must not keep the reference. A payload
+ *	whose size doesn't match the fields of T is rejected as an invalid size.
+ *	A raw handler can be bound with a context, read back by getContext.
+ *
+ *	handlers are bound before the socket is polled, the table isn't locked.
+ *	receive must be called from the socket's message receive callback and
+ *	release from its client del callback.
+ */
+
+class	PacketDispatcher
+{
+	public:
+		typedef struct	s_packetStats
+		{
+			uint64_t	received;
+			uint64_t	bytes;
+			uint64_t	rejected;
+		}				t_packetStats;
+
+		typedef void	(*rawHandler)(PacketDispatcher &, IClient *, const t_header &, const uint8_t *, size_t);
+
+		PacketDispatcher(ISocket &socket);
+		~PacketDispatcher(void);
+
+		void	bind(int32_t type, rawHandler handler, void *context = nullptr);
+		template	<typename T>
+		void	bind(int32_t type, void(*handler)(PacketDispatcher &, IClient *, T &))
+		{
+			static_assert(std::is_base_of<reflection::IReflectable, T>::value, "bound payloads must be reflectable");
+			set(type, &PacketDispatcher::decode<T>, (callback)handler);
+		}
+		void	unbind(int32_t type);
+
+		bool	receive(IClient *client, const Message &packet);
+		void	release(IClient *client);
+		void	send(IClient *client, int32_t type, const Message &payload);
+		void	send(IClient *client, int32_t type, reflection::IReflectable &payload);
+
+		t_packetStats	getStats(int32_t type) const;
+		uint64_t		getUnknown(void) const;
+		void			*getContext(int32_t type) const;
+
+		ISocket	&getSocket(void);
+
+		void	attachData(void *data);
+		void	*getData(void);
+
+		static void	writeHeader(uint8_t *dst, int32_t type, uint32_t size);
+	private:
+		typedef void	(*callback)(void);
+		typedef bool	(*trampoline)(PacketDispatcher &, IClient *, const t_header &, const uint8_t *, size_t, callback);
+
+		typedef struct	s_entry
+		{
+			trampoline				call;
+			callback				handler;
+			void					*context;
+			std::atomic<uint64_t>	received;
+			std::atomic<uint64_t>	bytes;
+			std::atomic<uint64_t>	rejected;
+		}				t_entry;
+
+		void	set(int32_t type, trampoline call, callback handler);
+		bool	dispatch(IClient *client, const t_header &header, const uint8_t *data);
+		void	reject(IClient *client, int32_t type, int32_t error);
+
+		static bool	raw(PacketDispatcher &dispatcher, IClient *client, const t_header &header, const uint8_t *data, size_t size, callback handler);
+		template	<typename T>
+		static bool	decode(PacketDispatcher &dispatcher, IClient *client, const t_header &, const uint8_t *data, size_t size, callback handler)
+		{
+			thread_local T	payload;
+
+			try
+			{
+				if (payload.read(data, data + size) != data + size)
+					return (false);
+			}
+			catch (const std::invalid_argument &)
+			{
+				return (false);
+			}
+			((void(*)(PacketDispatcher &, IClient *, T &))handler)(dispatcher, client, payload);
+			return (true);
+		}
+
+		ISocket										&_socket;
+		bool										_stream;
+		std::mutex									_partialMutex;
+		std::unordered_map<IClient::handle, Message>	_partial;
+		t_entry										_table[PACKET_DISPATCHER_TYPES];
+		std::atomic<uint64_t>						_unknown;
+		void										*_data;
+};
+
+}
+
+}
@@ -0,0 +1,118 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "Object.h"
+#include "network/Snapshot.h"
+
+#include <stdint.h>
+#include <glm/vec2.hpp>
+
+//	inputs kept waiting for the server, a bit more than 2 seconds at 60 ticks per second
+#ifndef PREDICTION_HISTORY
+# define PREDICTION_HISTORY		128
+#endif
+//	distance under which the server state is considered equal to the predicted one
+#ifndef PREDICTION_TOLERANCE
+# define PREDICTION_TOLERANCE	0.001f
+#endif
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+/*
+ *	client side prediction of an object driven by local inputs, not thread safe
+ *
+ *	apply runs an input on the object right away and keeps it in a ring with
+ *	the state it produced, the input is then sent to the server with its
+ *	sequence. The server runs it with the same step and sends back its state
+ *	along with the last sequence it has run.
+ *
+ *	reconcile drops the inputs the server has run. When the state the server
+ *	reached differs from the one predicted for that sequence, the object is
+ *	reset to it and the inputs the server hasn't run yet are run again.
+ *	Nothing is allocated, the ring is a fixed array.
+ */
+
+class	Prediction
+{
+	public:
+		typedef struct	s_input
+		{
+			uint32_t	sequence;
+			float		elapsedTime;
+			glm::vec2	acceleration;
+			float		rotation;
+		}				t_input;
+
+		typedef struct	s_state
+		{
+			glm::vec2	pos;
+			glm::vec2	speed;
+			double		angle;
+			double		rotSpeed;
+		}				t_state;
+
+		Prediction(Object &object);
+		~Prediction(void);
+
+		const t_input	&apply(float elapsedTime, const glm::vec2 &acceleration, float rotation = 0);
+		size_t			reconcile(uint32_t sequence, const t_state &state);
+		size_t			reconcile(uint32_t sequence, const Snapshot::t_objectState &state);
+		void			clear(void);
+
+		size_t			getPending(void) const;
+		const t_input	*getInput(uint32_t sequence) const;
+		float			getCorrection(void) const;
+		size_t			getOverflows(void) const;
+
+		Object			&getObject(void);
+
+		static void		step(Object &object, const t_input &input);
+		static t_state	capture(const Object &object);
+	private:
+		typedef struct	s_entry
+		{
+			t_input	input;
+			t_state	predicted;
+		}				t_entry;
+
+		t_entry	&at(uint32_t sequence);
+		void	restore(const t_state &state);
+
+		Object		&_object;
+		t_entry		_ring[PREDICTION_HISTORY];
+		uint32_t	_next;		//	sequence of the next input
+		uint32_t	_oldest;	//	oldest input the server hasn't run
+		float		_correction;
+		size_t		_overflows;
+};
+
+}
+
+}
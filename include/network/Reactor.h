@@ -0,0 +1,116 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/TcpSocket.h"
+#include "MpscQueue.h"
+
+#include <thread>
+#include <vector>
+#include <atomic>
+
+//	milliseconds a shard waits for its sockets when nothing is queued to it
+#ifndef REACTOR_POLL_TIMEOUT
+# define REACTOR_POLL_TIMEOUT	100
+#endif
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+/*
+ *	tcp server spread over several threads
+ *
+ *	each thread owns a shard, a TcpSocket polled only by it, so shards never
+ *	wait on each other's mutex. An acceptor thread accepts connections on
+ *	the listening socket and hands each one to a shard in turn through a
+ *	lock-free queue and wakes it, the shard adopts it on its next poll.
+ *	Shards are woken the same way when a message is queued to them, so
+ *	they can wait on their sockets with a long timeout.
+ *
+ *	callbacks are set on every shard and run on the shard's thread: a
+ *	callback can run concurrently with the same callback of another shard.
+ *	Inside a callback, the shard's own send can be used directly, other
+ *	threads send through the reactor with the client's shard and handle,
+ *	the message is queued to the shard and sent by its thread.
+ */
+
+class	Reactor
+{
+	public:
+		Reactor(size_t threads = std::thread::hardware_concurrency(), size_t size = 1024);
+		~Reactor(void);
+
+		void	bind(uint16_t port);
+		void	unbind(void);
+
+		void	send(size_t shard, IClient::handle handle, const Message &message);
+		void	send(ISocket &shard, IClient::handle handle, const Message &message);
+		void	broadcast(const Message &message);
+
+		size_t		getShardsNumber(void) const;
+		TcpSocket	&getShard(size_t shard);
+		size_t		getShardIndex(const ISocket &shard) const;
+		size_t		getClientsNumber(void);
+
+		void	setClientAddCb(void(*callback)(ISocket &, IClient *));
+		void	setClientDelCb(void(*callback)(ISocket &, IClient *));
+		void	setClientExceptionCb(void(*callback)(ISocket &, IClient *));
+		void	setMessageSendCb(void(*callback)(ISocket &, IClient *, const Message &));
+		void	setMessageReceiveCb(void(*callback)(ISocket &, IClient *, const Message &));
+	private:
+		typedef struct	s_outgoing
+		{
+			IClient::handle	handle;
+			Message			message;
+			bool			broadcast;
+		}				t_outgoing;
+
+		typedef struct	s_shard
+		{
+			TcpSocket				*socket;
+			std::thread				thread;
+			MpscQueue<TCPsocket>	incoming;
+			MpscQueue<t_outgoing>	outgoing;
+		}				t_shard;
+
+		//	child threads
+		void	accept(void);
+		void	loop(t_shard *shard);
+
+		std::vector<t_shard *>	_shards;
+		TCPsocket				_listener;
+		SDLNet_SocketSet		_set;
+		std::thread				_acceptor;
+		size_t					_next;
+		std::atomic<bool>		_running;
+		std::atomic<bool>		_listening;
+};
+
+}
+
+}
@@ -0,0 +1,101 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/ISocket.h"
+
+#include <fstream>
+#include <chrono>
+#include <atomic>
+
+#define CAPTURE_MAGIC	"EXOCAP"
+#define CAPTURE_VERSION	1
+
+//	bytes buffered before they are written to the capture file
+#ifndef CAPTURE_BUFFER_SIZE
+# define CAPTURE_BUFFER_SIZE	65536
+#endif
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+/*
+ *	records the traffic of a socket to a capture file
+ *
+ *	the file starts with the magic, the version and the socket type on a
+ *	byte each, then a record per event with varint fields:
+ *
+ *		uint8_t		event
+ *		varint		microseconds since the previous record
+ *		varint		client id
+ *		varint		size		(messages only)
+ *		uint8_t		data[size]	(messages only)
+ *
+ *	client ids are small numbers given in order of appearance, a client
+ *	already connected when the recording starts gets a CLIENT_ADD on its
+ *	first event. Records are written from the socket thread, the file is
+ *	written by blocks of CAPTURE_BUFFER_SIZE.
+ */
+
+class	Recorder
+{
+	public:
+		typedef enum
+		{
+			CLIENT_ADD,
+			CLIENT_DEL,
+			MESSAGE_SEND,
+			MESSAGE_RECEIVE
+		}		event;
+
+		Recorder(const std::string &path, ISocket::type type);
+		~Recorder(void);
+
+		void	record(event type, const IClient *client, const Message &message);
+		void	flush(void);
+
+		uint64_t	getRecords(void) const;
+		uint64_t	getBytes(void) const;
+	private:
+		void	write(event type, uint32_t id, const Message *message);
+		bool	writeBuffer(void);
+
+		std::mutex										_mutex;
+		std::ofstream									_file;
+		std::vector<uint8_t>							_buffer;
+		Message											_header;
+		std::chrono::steady_clock::time_point			_last;
+		std::unordered_map<IClient::handle, uint32_t>	_ids;
+		uint32_t										_next;
+		std::atomic<uint64_t>							_records;
+		std::atomic<uint64_t>							_bytes;
+};
+
+}
+
+}
@@ -0,0 +1,100 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/Recorder.h"
+
+//	ms a disconnecting client is given to write what it still has queued
+#ifndef REPLAY_DRAIN_TIMEOUT
+# define REPLAY_DRAIN_TIMEOUT	1000
+#endif
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+typedef struct	s_replayStats
+{
+	uint64_t	clients;
+	uint64_t	messages;
+	uint64_t	bytes;
+	double		duration;	//	seconds
+	double		lag;		//	milliseconds the replay fell behind the capture at worst
+}				t_replayStats;
+
+/*
+ *	plays a capture back against a server
+ *
+ *	every client of the capture gets its own socket, connected, fed and
+ *	disconnected at the capture times divided by the speed, a null speed
+ *	replays as fast as possible. Only the messages of the given direction
+ *	are sent: MESSAGE_RECEIVE for a capture taken on the server,
+ *	MESSAGE_SEND for one taken on a client. Replies are read and dropped.
+ */
+
+class	Replayer
+{
+	public:
+		Replayer(const std::string &path, Recorder::event direction = Recorder::MESSAGE_RECEIVE);
+		~Replayer(void);
+
+		t_replayStats	replay(const std::string &address, uint16_t port, double speed = 1);
+		t_replayStats	replay(const std::string &address, uint16_t port, double speed, ISocket::type type);
+
+		ISocket::type	getType(void) const;
+		size_t			getClientsNumber(void) const;
+		size_t			getMessagesNumber(void) const;
+		double			getDuration(void) const;
+	private:
+		typedef struct	s_record
+		{
+			uint64_t		time;
+			uint32_t		client;
+			Recorder::event	type;
+			Message			message;
+		}				t_record;
+
+		typedef struct	s_peer
+		{
+			ISocket	*socket;
+			IClient	*client;
+		}				t_peer;
+
+		static ISocket	*create(ISocket::type type);
+		static void		connected(ISocket &socket, IClient *client);
+		static void		poll(std::unordered_map<uint32_t, t_peer> &peers);
+		static void		drain(ISocket *socket);
+
+		std::vector<t_record>	_records;
+		ISocket::type			_type;
+		size_t					_clients;
+		size_t					_messages;
+};
+
+}
+
+}
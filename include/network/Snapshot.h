@@ -0,0 +1,106 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "Message.h"
+
+#include <stdint.h>
+#include <vector>
+#include <glm/vec2.hpp>
+
+namespace	ExoEngine
+{
+
+class	World;
+
+namespace	network
+{
+
+/*
+ *	replicated state of a World at a given tick, objects are sorted by id
+ *
+ *	a snapshot is encoded as a delta against a baseline snapshot the peer
+ *	already has: only objects with at least one changed field are written,
+ *	preceded by a mask of the fields that follow.
+ *
+ *		uint16_t	sequence
+ *		uint16_t	baseline sequence
+ *		uint8_t		has baseline
+ *		uint32_t	entries
+ *		{ uint32_t id; uint8_t mask; [pos] [speed] [angle] [bitfield] }...
+ *
+ *	a decoded snapshot only holds live objects, apply() against the previous
+ *	applied snapshot destroys the removed ones and reports the new ones.
+ */
+
+class	Snapshot
+{
+	public:
+		typedef struct	s_objectState
+		{
+			size_t		id;
+			glm::vec2	pos;
+			glm::vec2	speed;
+			float		angle;
+			uint32_t	bitfield;
+		}				t_objectState;
+
+		//	fields of the change mask
+		typedef enum
+		{
+			FIELD_POS = (1 << 0),
+			FIELD_SPEED = (1 << 1),
+			FIELD_ANGLE = (1 << 2),
+			FIELD_BITFIELD = (1 << 3),
+			FIELD_REMOVED = (1 << 4),
+			FIELD_ALL = FIELD_POS | FIELD_SPEED | FIELD_ANGLE | FIELD_BITFIELD
+		}		field;
+
+		Snapshot(uint16_t sequence = 0);
+		~Snapshot(void);
+
+		void	capture(World &world);
+		void	apply(World &world, const Snapshot *previous = nullptr, std::vector<size_t> *created = nullptr) const;
+
+		void					add(const t_objectState &state);
+		const t_objectState		*find(size_t id) const;
+		void					clear(void);
+
+		void	encode(const Snapshot *baseline, Message &dst) const;
+		size_t	decode(const Snapshot *baseline, const Message &src, size_t index);
+
+		static bool	peek(const Message &src, size_t index, uint16_t &sequence, uint16_t &baseline);
+
+		uint16_t							getSequence(void) const;
+		void								setSequence(uint16_t sequence);
+		const std::vector<t_objectState>	&getObjects(void) const;
+	private:
+		uint16_t					_sequence;
+		std::vector<t_objectState>	_objects;
+};
+
+}
+
+}
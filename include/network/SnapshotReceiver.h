@@ -0,0 +1,58 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/SnapshotReplicator.h"
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+/*
+ *	client side of the snapshot replication, decodes snapshots against the
+ *	ones previously received. The sequence given by receive must be
+ *	acknowledged to the server so it can be used as a baseline.
+ */
+
+class	SnapshotReceiver
+{
+	public:
+		SnapshotReceiver(void);
+		~SnapshotReceiver(void);
+
+		bool			receive(const Message &src, uint16_t &sequence);
+		const Snapshot	*getLatest(void) const;
+	private:
+		Snapshot	_ring[SNAPSHOT_RING_SIZE];
+		bool		_valid[SNAPSHOT_RING_SIZE];
+		uint16_t	_latest;
+		bool		_hasLatest;
+};
+
+}
+
+}
@@ -0,0 +1,81 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include "network/Snapshot.h"
+#include "network/IClient.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#ifndef SNAPSHOT_RING_SIZE
+# define SNAPSHOT_RING_SIZE	32
+#endif
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+/*
+ *	server side of the snapshot replication
+ *
+ *	each client keeps a ring of the last snapshots sent to it, a new
+ *	snapshot is encoded against the most recent one the client acknowledged
+ *	if it is still in the ring, and fully otherwise. Snapshots are shared
+ *	between clients, a per client (filtered) snapshot can also be given as
+ *	long as it uses the sequence returned by nextSequence.
+ */
+
+class	SnapshotReplicator
+{
+	public:
+		SnapshotReplicator(void);
+		~SnapshotReplicator(void);
+
+		std::shared_ptr<const Snapshot>	capture(World &world);
+		uint16_t						nextSequence(void);
+
+		void	encode(IClient::handle client, const std::shared_ptr<const Snapshot> &snapshot, Message &dst);
+		void	acknowledge(IClient::handle client, uint16_t sequence);
+		void	remove(IClient::handle client);
+	private:
+		typedef struct	s_client
+		{
+			std::shared_ptr<const Snapshot>	ring[SNAPSHOT_RING_SIZE];
+			uint16_t						acked;
+			bool							hasAck;
+		}				t_client;
+
+		std::mutex										_mutex;
+		uint16_t										_sequence;
+		std::unordered_map<IClient::handle, t_client>	_clients;
+};
+
+}
+
+}
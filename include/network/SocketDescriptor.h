@@ -0,0 +1,73 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_net.h>
+
+/*
+ *	SDL_net doesn't expose the descriptor of its sockets, its private
+ *	struct _TCPsocket (SDLnetTCP.c) and struct _UDPsocket (SDLnetUDP.c)
+ *	both start with the ready flag of the public _SDLNet_GenericSocket
+ *	then the descriptor. This is the only place reading that layout,
+ *	checked against SDL_net 2. A SDLNetSocketHead holding any descriptor
+ *	can also be added to a socket set, SDL_net only selects on the head.
+ */
+
+#if !defined(SDL_NET_MAJOR_VERSION) || SDL_NET_MAJOR_VERSION != 2
+# error "socket descriptors are read from the private structs of SDL_net 2, check their layout"
+#endif
+
+namespace	ExoEngine
+{
+
+namespace	network
+{
+
+struct	SDLNetSocketHead
+{
+	int	ready;
+	int	channel;
+};
+
+static_assert(offsetof(SDLNetSocketHead, ready) == offsetof(struct _SDLNet_GenericSocket, ready)
+	&& sizeof(struct _SDLNet_GenericSocket) == offsetof(SDLNetSocketHead, channel),
+	"SDL_net sockets don't start with the ready flag followed by the descriptor anymore");
+
+inline int	getDescriptor(TCPsocket socket)
+{
+	return (((SDLNetSocketHead *)socket)->channel);
+}
+
+inline int	getDescriptor(UDPsocket socket)
+{
+	return (((SDLNetSocketHead *)socket)->channel);
+}
+
+}
+
+}
@@ -25,6 +25,8 @@
 #pragma once
 
 #include "network/IClient.h"
+#include "network/OutboundQueue.h"
+#include "network/Compressor.h"
 
 namespace	ExoEngine
 {
@@ -35,7 +37,7 @@ namespace	network
 class TcpClient : public virtual IClient
 {
 	public:
-		TcpClient(const TCPsocket &socket);
+		TcpClient(const TCPsocket &socket, size_t highWaterMark = OUTBOUND_QUEUE_HIGH_WATER_MARK, OutboundQueue::policy slowConsumer = OutboundQueue::DISCONNECT);
 		virtual ~TcpClient(void);
 
 		virtual const IPaddress	&getAddress(void) const;
@@ -44,14 +46,25 @@ class TcpClient : public virtual IClient
 		virtual std::string		getHost(void) const;
 
 		virtual SDLNet_GenericSocket	&getSocket(void);
+		int								getFd(void) const;
+		OutboundQueue					&getOutboundQueue(void);
+		Compressor						*getCompressor(void);
 
-		virtual void	updateAddress(const IPaddress &address);
+		bool	queue(const Message &message);
+		bool	queue(Message &&message);
+		void	enableCompression(int level, size_t minSize, const std::shared_ptr<const std::string> &dictionary);
+
+		virtual void			updateAddress(const IPaddress &address);
+		virtual t_clientMetrics	getMetrics(void);
 
 		virtual bool	operator==(const IPaddress &address) const;
 		virtual bool	operator==(const IClient &client) const;
 	private:
-		TCPsocket	_socket;
-		IPaddress	*_address;
+		TCPsocket		_socket;
+		IPaddress		*_address;
+		OutboundQueue	_outbound;
+		Compressor		*_compressor;
+		std::mutex		_sendMutex;
 };
 
 }
@@ -25,6 +25,13 @@
 #pragma once
 
 #include "network/ISocket.h"
+#include "network/TcpClient.h"
+#include "network/SocketDescriptor.h"
+#include "Pool.h"
+
+#include <mutex>
+#include <vector>
+#include <poll.h>
 
 namespace	ExoEngine
 {
@@ -35,7 +42,7 @@ namespace	network
 class	TcpSocket : public ISocket
 {
 	public:
-		TcpSocket(size_t size);
+		TcpSocket(size_t size, bool wakeable = false);
 		~TcpSocket(void);
 
 		virtual void	bind(uint16_t port);
@@ -44,13 +51,48 @@ class	TcpSocket : public ISocket
 		virtual void	connect(const std::string &address, const std::string &port);
 		virtual void	connect(const std::string &address, uint16_t port);
 		virtual void	disconnect(IClient *client);
+		using			ISocket::disconnect;
+		using			ISocket::send;
 		virtual void	pollEvent(uint8_t mask);
 		virtual void	send(IClient *client, const Message &message);
+		virtual void	send(IClient *client, reflection::IReflectable &object);
+		void			flush(void);
+		IClient			*adopt(TCPsocket socket);
+		void			wake(void);
+
+		void	setHighWaterMark(size_t highWaterMark);
+		void	setSlowConsumerPolicy(OutboundQueue::policy slowConsumer);
+		void	setCompression(bool enable, int level = Z_DEFAULT_COMPRESSION, size_t minSize = COMPRESSOR_MIN_SIZE, const std::string &dictionary = "");
+
+		t_compressionStats	getCompressionStats(void);
 
 		virtual SDLNet_GenericSocket	getSocket(void);
 		virtual type	getType(void) const;
 	private:
-		TCPsocket	_socket;
+		virtual void	transmit(IClient *client, const Message &message);
+		void			transmit(IClient *client, Message &&message);
+		void			release(IClient *client);
+		virtual void	destroy(IClient *client);
+		void			flush(TcpClient *client);
+		void			add(TcpClient *client);
+		void			receive(TcpClient *client, const char *data, size_t size);
+		int				waitWritable(void);
+
+		TCPsocket				_socket;
+		Pool<TcpClient>			_pool;
+		size_t					_highWaterMark;
+		OutboundQueue::policy	_slowConsumer;
+		std::mutex				_clientsMutex;
+		bool					_backlog;
+		std::vector<pollfd>		_polled;
+		int						_wakeup[2];
+		SDLNetSocketHead		_wakeupHead;
+
+		bool								_compression;
+		int									_compressionLevel;
+		size_t								_compressionMinSize;
+		std::shared_ptr<const std::string>	_dictionary;
+		t_compressionStats					_compressionStats;
 };
 
 }
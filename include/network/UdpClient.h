@@ -25,6 +25,8 @@
 #pragma once
 
 #include "network/IClient.h"
+#include "network/Fragmenter.h"
+#include "network/Aggregator.h"
 
 namespace	ExoEngine
 {
@@ -44,6 +46,8 @@ class UdpClient : public virtual IClient
 		virtual std::string		getHost(void) const;
 
 		virtual SDLNet_GenericSocket	&getSocket(void);
+		Fragmenter						&getFragmenter(void);
+		Aggregator						&getAggregator(void);
 
 		virtual void	updateAddress(const IPaddress &address);
 
@@ -52,6 +56,8 @@ class UdpClient : public virtual IClient
 	private:
 		UDPsocket	_socket;
 		IPaddress	_address;
+		Fragmenter	_fragmenter;
+		Aggregator	_aggregator;
 };
 
 }
@@ -25,6 +25,13 @@
 #pragma once
 
 #include "network/ISocket.h"
+#include "network/UdpClient.h"
+#include "Pool.h"
+
+//	milliseconds between two runs of the mtu probes and reassembly timeouts
+#ifndef UDP_MAINTENANCE_INTERVAL
+# define UDP_MAINTENANCE_INTERVAL	100
+#endif
 
 namespace	ExoEngine
 {
@@ -32,6 +39,15 @@ namespace	ExoEngine
 namespace	network
 {
 
+/*
+ *	messages larger than the mtu of a client are fragmented, see Fragmenter,
+ *	so both ends must be UdpSockets
+ *
+ *	with aggregation, send only queues the message and the next flush packs
+ *	the queue of each client in datagrams of its mtu, see Aggregator. The
+ *	budget bounds the bytes of a client sent by one flush.
+ */
+
 class	UdpSocket : public ISocket
 {
 	public:
@@ -44,14 +60,38 @@ class	UdpSocket : public ISocket
 		virtual void	connect(const std::string &address, const std::string &port);
 		virtual void	connect(const std::string &address, uint16_t port);
 		virtual void	disconnect(IClient *client);
+		using			ISocket::disconnect;
+		using			ISocket::send;
 		virtual void	pollEvent(uint8_t mask);
 		virtual void	send(IClient *client, const Message &message);
+		void			send(IClient *client, const Message &message, uint8_t priority);
+		void			flush(void);
+
+		void	setAggregation(bool enable, size_t budget = 0);
 
 		virtual SDLNet_GenericSocket	getSocket(void);
 		virtual type	getType(void) const;
 	private:
-		UDPsocket	_socket;
-		UDPpacket	*_packet;
+		virtual void	transmit(IClient *client, const Message &message);
+		void			datagram(IClient *client, size_t size);
+		void			flush(UdpClient *client);
+		bool			seal(UdpClient *client, const std::vector<Aggregator::t_entry> &entries, size_t size, size_t first, size_t last);
+		void			receive(UdpClient *client, const uint8_t *data, size_t size);
+		void			bundle(UdpClient *client, const uint8_t *data, size_t size);
+		void			probe(UdpClient *client, const std::vector<uint16_t> &sizes);
+		void			maintain(void);
+		void			release(IClient *client);
+		virtual void	destroy(IClient *client);
+
+		UDPsocket								_socket;
+		UDPpacket								*_packet;
+		UDPpacket								*_output;
+		Pool<UdpClient>							_pool;
+		MessagePool								_buffers;
+		bool									_aggregation;
+		size_t									_budget;
+		std::vector<Aggregator::t_entry>		_entries;
+		std::chrono::steady_clock::time_point	_maintenance;
 };
 
 }
@@ -0,0 +1,273 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "BitStream.h"
+
+#include <string.h>
+#include <cmath>
+#include <stdexcept>
+
+using namespace	ExoEngine;
+
+uint64_t	ExoEngine::zigzag(int64_t value)
+{
+	return (((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+int64_t		ExoEngine::unzigzag(uint64_t value)
+{
+	return ((int64_t)(value >> 1) ^ -(int64_t)(value & 1));
+}
+
+BitWriter::BitWriter(Message &dst) : _dst(dst), _scratch(0), _scratchBits(0), _bits(0)
+{
+}
+
+BitWriter::~BitWriter(void)
+{
+	flush();
+}
+
+void	BitWriter::writeBits(uint64_t value, uint8_t bits)
+{
+	if (bits > 64)
+		throw (std::invalid_argument("cannot write more than 64 bits at once"));
+	if (bits < 64)
+		value &= ((uint64_t)1 << bits) - 1;
+	_bits += bits;
+	while (bits)
+	{
+		uint8_t	count = (uint8_t)std::min<unsigned>(bits, 64 - _scratchBits);
+
+		_scratch |= (count < 64 ? value & (((uint64_t)1 << count) - 1) : value) << _scratchBits;
+		_scratchBits += count;
+		value = count < 64 ? value >> count : 0;
+		bits -= count;
+		while (_scratchBits >= 8)
+		{
+			_dst.append((uint8_t)_scratch);
+			_scratch >>= 8;
+			_scratchBits -= 8;
+		}
+	}
+}
+
+void	BitWriter::writeBool(bool value)
+{
+	writeBits(value ? 1 : 0, 1);
+}
+
+void	BitWriter::writeVarint(uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		writeBits((value & 0x7f) | 0x80, 8);
+		value >>= 7;
+	}
+	writeBits(value, 8);
+}
+
+void	BitWriter::writeSigned(int64_t value)
+{
+	writeVarint(zigzag(value));
+}
+
+void	BitWriter::writeFloat(float value)
+{
+	uint32_t	raw;
+
+	memcpy(&raw, &value, sizeof(raw));
+	writeBits(raw, 32);
+}
+
+void	BitWriter::writeFloat(float value, float min, float max, uint8_t bits)
+{
+	uint64_t	steps = (bits < 64 ? ((uint64_t)1 << bits) : 0) - 1;
+	float		normalized;
+
+	if (!bits || bits > 32 || max <= min)
+		throw (std::invalid_argument("invalid float quantization"));
+	normalized = (std::min(max, std::max(min, value)) - min) / (max - min);
+	writeBits((uint64_t)std::llround((double)normalized * steps), bits);
+}
+
+void	BitWriter::writeDouble(double value)
+{
+	uint64_t	raw;
+
+	memcpy(&raw, &value, sizeof(raw));
+	writeBits(raw, 64);
+}
+
+void	BitWriter::writeBytes(const void *ptr, size_t size)
+{
+	if (!_scratchBits)
+	{
+		_dst.append(ptr, size);
+		_bits += size * 8;
+		return ;
+	}
+	for (size_t i = 0; i < size; i++)
+		writeBits(((const uint8_t *)ptr)[i], 8);
+}
+
+void	BitWriter::writeString(const std::string &str, size_t maxLength)
+{
+	if (str.length() > maxLength)
+		throw (std::length_error(std::string("cannot write string of ").append(std::to_string(str.length()))
+			.append(" bytes, limited to ").append(std::to_string(maxLength))));
+	writeVarint(str.length());
+	writeBytes(str.data(), str.length());
+}
+
+void	BitWriter::flush(void)
+{
+	if (!_scratchBits)
+		return ;
+	_dst.append((uint8_t)_scratch);
+	_bits += 8 - _scratchBits;
+	_scratch = 0;
+	_scratchBits = 0;
+}
+
+size_t	BitWriter::getBits(void) const
+{
+	return (_bits);
+}
+
+BitReader::BitReader(const Message &src, size_t index) : _data((const uint8_t *)src.getPtr()), _size(src.getSize()), _bit(index * 8)
+{
+}
+
+BitReader::~BitReader(void)
+{
+}
+
+uint64_t	BitReader::readBits(uint8_t bits)
+{
+	uint64_t	value = 0;
+	uint8_t		done = 0;
+
+	if (bits > 64)
+		throw (std::invalid_argument("cannot read more than 64 bits at once"));
+	if (_bit + bits > _size * 8)
+		throw (std::invalid_argument("cannot read " + std::to_string(bits) +
+			" bits, only " + std::to_string(_size * 8 - _bit) + " left"));
+	while (done < bits)
+	{
+		uint8_t	offset = _bit % 8;
+		uint8_t	count = (uint8_t)std::min<unsigned>(8 - offset, bits - done);
+
+		value |= (uint64_t)((_data[_bit / 8] >> offset) & ((1u << count) - 1)) << done;
+		done += count;
+		_bit += count;
+	}
+	return (value);
+}
+
+bool		BitReader::readBool(void)
+{
+	return (readBits(1));
+}
+
+uint64_t	BitReader::readVarint(void)
+{
+	uint64_t	value = 0;
+	uint64_t	byte;
+
+	for (uint8_t shift = 0; shift < 64; shift += 7)
+	{
+		byte = readBits(8);
+		value |= (byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return (value);
+	}
+	throw (std::invalid_argument("malformed varint"));
+}
+
+int64_t		BitReader::readSigned(void)
+{
+	return (unzigzag(readVarint()));
+}
+
+float		BitReader::readFloat(void)
+{
+	uint32_t	raw = (uint32_t)readBits(32);
+	float		value;
+
+	memcpy(&value, &raw, sizeof(value));
+	return (value);
+}
+
+float		BitReader::readFloat(float min, float max, uint8_t bits)
+{
+	uint64_t	steps = (bits < 64 ? ((uint64_t)1 << bits) : 0) - 1;
+
+	if (!bits || bits > 32 || max <= min)
+		throw (std::invalid_argument("invalid float quantization"));
+	return ((float)(min + (double)readBits(bits) / steps * (max - min)));
+}
+
+double		BitReader::readDouble(void)
+{
+	uint64_t	raw = readBits(64);
+	double		value;
+
+	memcpy(&value, &raw, sizeof(value));
+	return (value);
+}
+
+void		BitReader::readBytes(void *ptr, size_t size)
+{
+	if (!(_bit % 8))
+	{
+		if (_bit / 8 + size > _size)
+			throw (std::invalid_argument("cannot read " + std::to_string(size) +
+				" bytes, only " + std::to_string(_size - _bit / 8) + " left"));
+		memcpy(ptr, _data + _bit / 8, size);
+		_bit += size * 8;
+		return ;
+	}
+	for (size_t i = 0; i < size; i++)
+		((uint8_t *)ptr)[i] = (uint8_t)readBits(8);
+}
+
+std::string	BitReader::readString(size_t maxLength)
+{
+	std::string	str;
+	uint64_t	length = readVarint();
+
+	if (length > maxLength)
+		throw (std::length_error(std::string("cannot read string of ").append(std::to_string(length))
+			.append(" bytes, limited to ").append(std::to_string(maxLength))));
+	str.resize(length);
+	if (length)
+		readBytes(&str[0], length);
+	return (str);
+}
+
+size_t		BitReader::getIndex(void) const
+{
+	return ((_bit + 7) / 8);
+}
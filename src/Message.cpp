@@ -34,6 +34,10 @@ Message::Message(const Message &src) : Message(src.getPtr(), src.getSize())
 {
 }
 
+Message::Message(Message &&src) noexcept : _message(std::move(src._message))
+{
+}
+
 Message::Message(const std::string &src) : Message((void *)&src[0], src.length())
 {
 }
@@ -77,6 +81,12 @@ Message	&Message::operator=(const Message &src)
 	return (*this);
 }
 
+Message	&Message::operator=(Message &&src) noexcept
+{
+	_message = std::move(src._message);
+	return (*this);
+}
+
 Message	&Message::operator=(const std::string &src)
 {
 	_message.resize(src.length());
@@ -142,6 +152,11 @@ size_t		Message::getSize(void) const
 	return (_message.size());
 }
 
+size_t		Message::getCapacity(void) const
+{
+	return (_message.capacity());
+}
+
 std::string	Message::to_string(void) const
 {
 	std::string	str;
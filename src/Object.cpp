@@ -135,6 +135,16 @@ void		Object::removeField(uint32_t field)
 	_bitfield = (_bitfield & (~field));
 }
 
+uint32_t	Object::getBitfield(void) const
+{
+	return (_bitfield);
+}
+
+void		Object::setBitfield(uint32_t bitfield)
+{
+	_bitfield = bitfield;
+}
+
 const Object::objectType &Object::getType(void) const
 {
 	return (_type);
@@ -152,12 +162,18 @@ sprite *Object::getSprite(void)
 
 bool	Object::collide(const glm::vec2 &pos) const
 {
-	double		c = cos(-_angle);
-	double		s = sin(-_angle);
-	glm::vec2	tmp = glm::mat2(c, -s, s, c) * pos;
+	return (collide(_pos, _scale, _angle, pos));
+}
+
+//	same test with any pose, used to test against past poses
+bool	Object::collide(const glm::vec2 &pos, const glm::vec2 &scale, double angle, const glm::vec2 &point)
+{
+	double		c = cos(-angle);
+	double		s = sin(-angle);
+	glm::vec2	tmp = glm::mat2(c, -s, s, c) * point;
 
-	if (tmp.x >= _pos.x && tmp.x < _pos.x + _scale.x &&
-		tmp.y >= _pos.y && tmp.y < _pos.y + _scale.y)
+	if (tmp.x >= pos.x && tmp.x < pos.x + scale.x &&
+		tmp.y >= pos.y && tmp.y < pos.y + scale.y)
 		return (true);
 	return (false);
 }
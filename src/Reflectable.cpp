@@ -39,6 +39,22 @@ void	reflection::IReflectable::read(Message& src)
 	read(src, 0);
 }
 
+void	reflection::IReflectable::pack(Message& dst)
+{
+	BitWriter	writer(dst);
+
+	pack(writer);
+	writer.flush();
+}
+
+size_t	reflection::IReflectable::unpack(const Message& src, size_t index)
+{
+	BitReader	reader(src, index);
+
+	unpack(reader);
+	return (reader.getIndex());
+}
+
 reflection::ReflectableClass::ReflectableClass(void)
 {
 }
@@ -46,12 +62,39 @@ reflection::ReflectableClass::~ReflectableClass(void)
 {
 }
 
+//	grows the message once and writes the members in place
 void	reflection::ReflectableClass::write(Message& dst)
 {
+	size_t	offset = dst.getSize();
+	size_t	length = size();
+
+	if (!length)
+		return ;
+	dst.resize(offset + length);
+	write(&dst[offset]);
+}
+
+size_t	reflection::ReflectableClass::size(void)
+{
+	size_t	length = 0;
+
 	for (auto member = _members.begin(); member != _members.end(); member++)
-	{
-		(*member)->write(dst);
-	}
+		length += (*member)->size();
+	return (length);
+}
+
+uint8_t	*reflection::ReflectableClass::write(uint8_t* dst)
+{
+	for (auto member = _members.begin(); member != _members.end(); member++)
+		dst = (*member)->write(dst);
+	return (dst);
+}
+
+const uint8_t	*reflection::ReflectableClass::read(const uint8_t* src, const uint8_t* end)
+{
+	for (auto member = _members.begin(); member != _members.end(); member++)
+		src = (*member)->read(src, end);
+	return (src);
 }
 
 size_t	reflection::ReflectableClass::read(Message& src, size_t index)
@@ -69,3 +112,15 @@ size_t	reflection::ReflectableClass::read(Message& src, size_t index)
 	}
 	return (index);
 }
+
+void	reflection::ReflectableClass::pack(BitWriter& dst)
+{
+	for (auto member = _members.begin(); member != _members.end(); member++)
+		(*member)->pack(dst);
+}
+
+void	reflection::ReflectableClass::unpack(BitReader& src)
+{
+	for (auto member = _members.begin(); member != _members.end(); member++)
+		(*member)->unpack(src);
+}
@@ -0,0 +1,140 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "RsaKeyPool.h"
+#include "Log.h"
+
+#include <string.h>
+#include <chrono>
+
+using namespace	ExoEngine;
+
+RsaKeyPool::RsaKeyPool(size_t depth) : _joining(false)
+{
+	memset(&_stats, 0, sizeof(_stats));
+	_stats.target = depth;
+	_thread = std::thread(&RsaKeyPool::loop, this);
+}
+
+RsaKeyPool::~RsaKeyPool(void)
+{
+	_mutex.lock();
+	_joining = true;
+	_mutex.unlock();
+	_condition.notify_all();
+	_thread.join();
+}
+
+std::unique_ptr<RsaKey>	RsaKeyPool::acquire(void)
+{
+	std::unique_ptr<RsaKey>					key;
+	std::chrono::steady_clock::time_point	start;
+
+	_mutex.lock();
+
+	_stats.acquired++;
+	if (_keys.size())
+	{
+		key = std::move(_keys.front());
+		_keys.pop_front();
+		_stats.depth = _keys.size();
+		_mutex.unlock();
+		_condition.notify_one();
+		return (key);
+	}
+	_stats.misses++;
+
+	_mutex.unlock();
+	_condition.notify_one();
+	start = std::chrono::steady_clock::now();
+	key.reset(new RsaKey());
+	_mutex.lock();
+	record(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	_mutex.unlock();
+	return (key);
+}
+
+void	RsaKeyPool::setDepth(size_t depth)
+{
+	_mutex.lock();
+
+	_stats.target = depth;
+	while (_keys.size() > depth)
+		_keys.pop_back();
+	_stats.depth = _keys.size();
+
+	_mutex.unlock();
+	_condition.notify_one();
+}
+
+t_rsaKeyPoolStats	RsaKeyPool::getStats(void)
+{
+	t_rsaKeyPoolStats	stats;
+
+	_mutex.lock();
+	stats = _stats;
+	_mutex.unlock();
+	return (stats);
+}
+
+void	RsaKeyPool::loop(void)
+{
+	std::unique_lock<std::mutex>			lock(_mutex);
+	std::unique_ptr<RsaKey>					key;
+	std::chrono::steady_clock::time_point	start;
+
+	while (1)
+	{
+		_condition.wait(lock, [this]{ return (_joining || _keys.size() < _stats.target); });
+		if (_joining)
+			return ;
+		lock.unlock();
+		start = std::chrono::steady_clock::now();
+		try
+		{
+			key.reset(new RsaKey());
+		}
+		catch (const std::exception &e)
+		{
+			_log.error << "rsa key pool: " << e.what() << std::endl;
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			lock.lock();
+			continue ;
+		}
+		lock.lock();
+		record(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		if (_keys.size() < _stats.target)
+			_keys.push_back(std::move(key));
+		_stats.depth = _keys.size();
+	}
+}
+
+void	RsaKeyPool::record(double time)
+{
+	_stats.generated++;
+	_stats.lastGenerationTime = time;
+	_stats.averageGenerationTime += (time - _stats.averageGenerationTime) / _stats.generated;
+	if (time > _stats.maxGenerationTime)
+		_stats.maxGenerationTime = time;
+}
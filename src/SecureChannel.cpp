@@ -0,0 +1,354 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "SecureChannel.h"
+#include "network/network.h"
+#include <openssl/err.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+#include <openssl/hmac.h>
+#include <string.h>
+
+#define NONCE_SIZE		(SECURE_CHANNEL_SALT_SIZE + sizeof(uint64_t))
+#define DIRECTION_BIT	((uint64_t)1 << 63)
+#define LABEL_MAX_SIZE	32
+
+#define HANDSHAKE_LABEL	"exo session handshake"
+#define RESUME_LABEL	"exo session resume"
+
+using namespace	ExoEngine;
+
+static std::string	sslError(void)
+{
+	return (ERR_error_string(ERR_get_error(), NULL));
+}
+
+SecureChannel::SecureChannel(void) : _sealDirection(0), _sealCounter(0), _openDirection(0), _openCounter(0), _pending(false), _established(false)
+{
+	_sealCtx = EVP_CIPHER_CTX_new();
+	_openCtx = EVP_CIPHER_CTX_new();
+	if (!_sealCtx || !_openCtx)
+	{
+		EVP_CIPHER_CTX_free(_sealCtx);
+		EVP_CIPHER_CTX_free(_openCtx);
+		throw (std::runtime_error(std::string("failed to create cipher context: ").append(sslError())));
+	}
+	memset(_salt, 0, sizeof(_salt));
+	memset(_secret, 0, sizeof(_secret));
+}
+
+SecureChannel::~SecureChannel(void)
+{
+	EVP_CIPHER_CTX_free(_sealCtx);
+	EVP_CIPHER_CTX_free(_openCtx);
+	OPENSSL_cleanse(_salt, sizeof(_salt));
+	OPENSSL_cleanse(_secret, sizeof(_secret));
+}
+
+/*
+ *	client side, returns the message to send to the owner of peerKey. The
+ *	channel can't seal or open until accepted
+ */
+Message	SecureChannel::handshake(RsaKey &peerKey)
+{
+	uint8_t	secret[SECURE_CHANNEL_SECRET_SIZE + SECURE_CHANNEL_RANDOM_SIZE];
+	Message	message;
+
+	if (_established || _pending)
+		throw (std::runtime_error("secure channel already established"));
+	if (RAND_bytes(secret, sizeof(secret)) != 1)
+		throw (std::runtime_error(std::string("failed to generate session key: ").append(sslError())));
+	try
+	{
+		message = peerKey.encrypt(Message(secret, sizeof(secret)));
+	}
+	catch (const std::exception &)
+	{
+		OPENSSL_cleanse(secret, sizeof(secret));
+		throw ;
+	}
+	memcpy(_secret, secret, SECURE_CHANNEL_SECRET_SIZE);
+	memcpy(_random, secret + SECURE_CHANNEL_SECRET_SIZE, SECURE_CHANNEL_RANDOM_SIZE);
+	OPENSSL_cleanse(secret, sizeof(secret));
+	_pending = true;
+	return (message);
+}
+
+/*
+ *	server side, key must hold the private key matching the one used by the
+ *	client. The session key also depends on a random of the server, returned
+ *	to be sent to the client, so a recorded handshake replayed on a new
+ *	connection doesn't reopen the recorded session
+ */
+Message	SecureChannel::accept(RsaKey &key, const Message &handshake)
+{
+	uint8_t	derived[SECURE_CHANNEL_SECRET_SIZE];
+	uint8_t	random[SECURE_CHANNEL_RANDOM_SIZE];
+	Message	secret;
+
+	if (_established)
+		throw (std::runtime_error("secure channel already established"));
+	if (RAND_bytes(random, sizeof(random)) != 1)
+		throw (std::runtime_error(std::string("failed to generate handshake random: ").append(sslError())));
+	secret = key.decrypt(handshake);
+	if (secret.getSize() != SECURE_CHANNEL_SECRET_SIZE + SECURE_CHANNEL_RANDOM_SIZE)
+	{
+		OPENSSL_cleanse((void *)secret.getPtr(), secret.getSize());
+		throw (std::runtime_error("invalid secure channel handshake"));
+	}
+	try
+	{
+		derive(HANDSHAKE_LABEL, (const uint8_t *)secret.getPtr(), (const uint8_t *)secret.getPtr() + SECURE_CHANNEL_SECRET_SIZE, random, derived);
+		establish(derived, true);
+	}
+	catch (const std::exception &)
+	{
+		OPENSSL_cleanse((void *)secret.getPtr(), secret.getSize());
+		OPENSSL_cleanse(derived, sizeof(derived));
+		throw ;
+	}
+	OPENSSL_cleanse((void *)secret.getPtr(), secret.getSize());
+	OPENSSL_cleanse(derived, sizeof(derived));
+	return (Message(random, sizeof(random)));
+}
+
+//	client side, ends a handshake with the server's response
+void	SecureChannel::accepted(const Message &response)
+{
+	complete(HANDSHAKE_LABEL, response);
+}
+
+//	server side, the ticket should be sent to the client sealed by this channel
+Message	SecureChannel::issueTicket(SessionTickets &tickets)
+{
+	if (!_established)
+		throw (std::runtime_error("cannot issue ticket: secure channel not established"));
+	return (tickets.issue(_secret, sizeof(_secret)));
+}
+
+/*
+ *	client side, starts a new session from the secret of the last one and a
+ *	ticket received in it. The channel can't seal or open until resumed
+ */
+Message	SecureChannel::resume(const Message &ticket)
+{
+	Message	request(ticket);
+
+	if (!_established && !_pending)
+		throw (std::runtime_error("cannot resume: no previous session"));
+	if (RAND_bytes(_random, sizeof(_random)) != 1)
+		throw (std::runtime_error(std::string("failed to generate resume random: ").append(sslError())));
+	request.append(_random, sizeof(_random));
+	_established = false;
+	_pending = true;
+	return (request);
+}
+
+//	server side, opens the ticket in request and returns the response to send to the client
+Message	SecureChannel::accept(SessionTickets &tickets, const Message &request)
+{
+	uint8_t	secret[SECURE_CHANNEL_SECRET_SIZE];
+	uint8_t	derived[SECURE_CHANNEL_SECRET_SIZE];
+	uint8_t	random[SECURE_CHANNEL_RANDOM_SIZE];
+	Message	ticket;
+
+	if (_established)
+		throw (std::runtime_error("secure channel already established"));
+	if (request.getSize() <= SECURE_CHANNEL_RANDOM_SIZE)
+		throw (std::runtime_error("invalid resume request"));
+	if (RAND_bytes(random, sizeof(random)) != 1)
+		throw (std::runtime_error(std::string("failed to generate resume random: ").append(sslError())));
+	ticket = Message(request.getPtr(), request.getSize() - SECURE_CHANNEL_RANDOM_SIZE);
+	tickets.open(ticket, secret, sizeof(secret));
+	try
+	{
+		derive(RESUME_LABEL, secret, (const uint8_t *)request.getPtr() + ticket.getSize(), random, derived);
+		establish(derived, true);
+	}
+	catch (const std::exception &)
+	{
+		OPENSSL_cleanse(secret, sizeof(secret));
+		OPENSSL_cleanse(derived, sizeof(derived));
+		throw ;
+	}
+	OPENSSL_cleanse(secret, sizeof(secret));
+	OPENSSL_cleanse(derived, sizeof(derived));
+	return (Message(random, sizeof(random)));
+}
+
+//	client side, ends a resume with the server's response
+void	SecureChannel::resumed(const Message &response)
+{
+	complete(RESUME_LABEL, response);
+}
+
+//	derives the session secret from the pending one, the client random and the server random
+void	SecureChannel::complete(const char *label, const Message &response)
+{
+	uint8_t	derived[SECURE_CHANNEL_SECRET_SIZE];
+
+	if (!_pending)
+		throw (std::runtime_error("cannot end handshake: no handshake started"));
+	if (response.getSize() != SECURE_CHANNEL_RANDOM_SIZE)
+		throw (std::runtime_error("invalid handshake response"));
+	try
+	{
+		derive(label, _secret, _random, (const uint8_t *)response.getPtr(), derived);
+		establish(derived, false);
+	}
+	catch (const std::exception &)
+	{
+		OPENSSL_cleanse(derived, sizeof(derived));
+		throw ;
+	}
+	OPENSSL_cleanse(derived, sizeof(derived));
+}
+
+/*
+ *	encrypts message in its own buffer and appends its counter and tag, it
+ *	grows by SECURE_CHANNEL_OVERHEAD bytes. A message that fails to be
+ *	sealed is cleared, its content may be partly encrypted
+ */
+void	SecureChannel::seal(Message &message)
+{
+	uint8_t		nonce[NONCE_SIZE];
+	uint64_t	counter;
+	size_t		size = message.getSize();
+	uint8_t		*data;
+	int			length;
+
+	if (!_established)
+		throw (std::runtime_error("cannot seal message: secure channel not established"));
+	if (size > INT32_MAX)
+		throw (std::runtime_error("cannot seal message: message too big"));
+	message.resize(size + SECURE_CHANNEL_OVERHEAD);
+	data = (uint8_t *)message.getPtr();
+	_sealMutex.lock();
+
+	if (_sealCounter == DIRECTION_BIT - 1)
+	{
+		_sealMutex.unlock();
+		message.resize(size);
+		throw (std::runtime_error("cannot seal message: nonces exhausted"));
+	}
+	counter = network::endian(_sealDirection | ++_sealCounter);
+	memcpy(nonce, _salt, SECURE_CHANNEL_SALT_SIZE);
+	memcpy(nonce + SECURE_CHANNEL_SALT_SIZE, &counter, sizeof(counter));
+	if (EVP_EncryptInit_ex(_sealCtx, NULL, NULL, NULL, nonce) != 1 ||
+		EVP_EncryptUpdate(_sealCtx, data, &length, data, size) != 1 ||
+		EVP_EncryptFinal_ex(_sealCtx, data + length, &length) != 1 ||
+		EVP_CIPHER_CTX_ctrl(_sealCtx, EVP_CTRL_GCM_GET_TAG, SECURE_CHANNEL_TAG_SIZE, data + size + sizeof(counter)) != 1)
+	{
+		_sealMutex.unlock();
+		message.clear();
+		throw (std::runtime_error(std::string("failed to seal message: ").append(sslError())));
+	}
+	memcpy(data + size, &counter, sizeof(counter));
+
+	_sealMutex.unlock();
+}
+
+//	checks and decrypts a sealed message in its own buffer, throws if it was tampered with or replayed
+void	SecureChannel::open(Message &message)
+{
+	uint8_t		nonce[NONCE_SIZE];
+	uint64_t	counter;
+	size_t		size = message.getSize();
+	uint8_t		*data = (uint8_t *)message.getPtr();
+	int			length;
+
+	if (!_established)
+		throw (std::runtime_error("cannot open message: secure channel not established"));
+	if (size < SECURE_CHANNEL_OVERHEAD || size - SECURE_CHANNEL_OVERHEAD > INT32_MAX)
+		throw (std::runtime_error("cannot open message: invalid size"));
+	size -= SECURE_CHANNEL_OVERHEAD;
+	memcpy(&counter, data + size, sizeof(counter));
+	memcpy(nonce, _salt, SECURE_CHANNEL_SALT_SIZE);
+	memcpy(nonce + SECURE_CHANNEL_SALT_SIZE, &counter, sizeof(counter));
+	counter = network::endian(counter);
+	_openMutex.lock();
+
+	if ((counter & DIRECTION_BIT) != _openDirection || (counter & ~DIRECTION_BIT) <= _openCounter)
+	{
+		_openMutex.unlock();
+		throw (std::runtime_error("cannot open message: replayed or out of order"));
+	}
+	if (EVP_DecryptInit_ex(_openCtx, NULL, NULL, NULL, nonce) != 1 ||
+		EVP_CIPHER_CTX_ctrl(_openCtx, EVP_CTRL_GCM_SET_TAG, SECURE_CHANNEL_TAG_SIZE, data + size + sizeof(counter)) != 1 ||
+		EVP_DecryptUpdate(_openCtx, data, &length, data, size) != 1 ||
+		EVP_DecryptFinal_ex(_openCtx, data + length, &length) != 1)
+	{
+		_openMutex.unlock();
+		OPENSSL_cleanse(data, size);
+		throw (std::runtime_error("cannot open message: authentication failed"));
+	}
+	_openCounter = counter & ~DIRECTION_BIT;
+
+	_openMutex.unlock();
+	message.resize(size);
+}
+
+bool	SecureChannel::isEstablished(void) const
+{
+	return (_established);
+}
+
+void	SecureChannel::establish(const uint8_t *secret, bool server)
+{
+	if (EVP_EncryptInit_ex(_sealCtx, EVP_aes_256_gcm(), NULL, NULL, NULL) != 1 ||
+		EVP_CIPHER_CTX_ctrl(_sealCtx, EVP_CTRL_GCM_SET_IVLEN, NONCE_SIZE, NULL) != 1 ||
+		EVP_EncryptInit_ex(_sealCtx, NULL, NULL, secret, NULL) != 1 ||
+		EVP_DecryptInit_ex(_openCtx, EVP_aes_256_gcm(), NULL, NULL, NULL) != 1 ||
+		EVP_CIPHER_CTX_ctrl(_openCtx, EVP_CTRL_GCM_SET_IVLEN, NONCE_SIZE, NULL) != 1 ||
+		EVP_DecryptInit_ex(_openCtx, NULL, NULL, secret, NULL) != 1)
+		throw (std::runtime_error(std::string("failed to initialize session cipher: ").append(sslError())));
+	memcpy(_salt, secret + SECURE_CHANNEL_KEY_SIZE, SECURE_CHANNEL_SALT_SIZE);
+	memcpy(_secret, secret, SECURE_CHANNEL_SECRET_SIZE);
+	_pending = false;
+	_sealDirection = server ? DIRECTION_BIT : 0;
+	_openDirection = server ? 0 : DIRECTION_BIT;
+	_sealCounter = 0;
+	_openCounter = 0;
+	_established = true;
+}
+
+//	label separates the secrets derived by a handshake from those derived by a resume
+void	SecureChannel::derive(const char *label, const uint8_t *secret, const uint8_t *clientRandom, const uint8_t *serverRandom, uint8_t *dst)
+{
+	uint8_t			input[LABEL_MAX_SIZE + SECURE_CHANNEL_RANDOM_SIZE * 2];
+	uint8_t			output[EVP_MAX_MD_SIZE];
+	size_t			size = strlen(label) + 1;
+	unsigned int	length;
+
+	if (size > LABEL_MAX_SIZE)
+		throw (std::invalid_argument("secure channel label too long"));
+	memcpy(input, label, size);
+	memcpy(input + size, clientRandom, SECURE_CHANNEL_RANDOM_SIZE);
+	memcpy(input + size + SECURE_CHANNEL_RANDOM_SIZE, serverRandom, SECURE_CHANNEL_RANDOM_SIZE);
+	size += SECURE_CHANNEL_RANDOM_SIZE * 2;
+	if (!HMAC(EVP_sha512(), secret, SECURE_CHANNEL_SECRET_SIZE, input, size, output, &length) || length < SECURE_CHANNEL_SECRET_SIZE)
+		throw (std::runtime_error(std::string("failed to derive session secret: ").append(sslError())));
+	memcpy(dst, output, SECURE_CHANNEL_SECRET_SIZE);
+	OPENSSL_cleanse(output, sizeof(output));
+}
@@ -0,0 +1,234 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "SessionTickets.h"
+#include "network/network.h"
+#include "Log.h"
+#include <openssl/evp.h>
+#include <openssl/err.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+#include <string.h>
+#include <stdexcept>
+
+#define TICKET_HEADER_SIZE	(sizeof(uint8_t) + SESSION_TICKET_NONCE_SIZE)
+
+using namespace	ExoEngine;
+
+static uint64_t	now(void)
+{
+	return (std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+SessionTickets::SessionTickets(size_t lifetime, size_t rotation) : _lifetime(lifetime), _rotation(rotation), _issued(0), _resumed(0), _rejected(0)
+{
+	if (!rotation)
+		throw (std::invalid_argument("session ticket rotation period cannot be null"));
+	generate(_current, 0);
+}
+
+SessionTickets::~SessionTickets(void)
+{
+	OPENSSL_cleanse(_current.key, sizeof(_current.key));
+	for (t_key &key : _retired)
+		OPENSSL_cleanse(key.key, sizeof(key.key));
+}
+
+//	seals a session secret, the ticket is meant to be sent to the client over its secure channel
+Message	SessionTickets::issue(const void *secret, size_t size)
+{
+	Message			ticket(TICKET_HEADER_SIZE + size + sizeof(uint64_t) + SESSION_TICKET_TAG_SIZE);
+	uint8_t			*data = (uint8_t *)ticket.getPtr();
+	uint64_t		issued = network::endian(now());
+	EVP_CIPHER_CTX	*ctx;
+	int				length;
+	bool			ret;
+
+	ctx = EVP_CIPHER_CTX_new();
+	if (!ctx)
+		throw (std::runtime_error(std::string("failed to create cipher context: ").append(ERR_error_string(ERR_get_error(), NULL))));
+	if (RAND_bytes(data + 1, SESSION_TICKET_NONCE_SIZE) != 1)
+	{
+		EVP_CIPHER_CTX_free(ctx);
+		throw (std::runtime_error(std::string("failed to generate ticket nonce: ").append(ERR_error_string(ERR_get_error(), NULL))));
+	}
+	memcpy(data + TICKET_HEADER_SIZE, secret, size);
+	memcpy(data + TICKET_HEADER_SIZE + size, &issued, sizeof(issued));
+	_mutex.lock();
+
+	update();
+	data[0] = _current.id;
+	ret = EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, _current.key, data + 1) == 1 &&
+		EVP_EncryptUpdate(ctx, NULL, &length, data, 1) == 1 &&
+		EVP_EncryptUpdate(ctx, data + TICKET_HEADER_SIZE, &length, data + TICKET_HEADER_SIZE, size + sizeof(issued)) == 1 &&
+		EVP_EncryptFinal_ex(ctx, data + TICKET_HEADER_SIZE + length, &length) == 1 &&
+		EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, SESSION_TICKET_TAG_SIZE, data + TICKET_HEADER_SIZE + size + sizeof(issued)) == 1;
+
+	_mutex.unlock();
+	EVP_CIPHER_CTX_free(ctx);
+	if (!ret)
+	{
+		OPENSSL_cleanse(data, ticket.getSize());
+		throw (std::runtime_error(std::string("failed to seal session ticket: ").append(ERR_error_string(ERR_get_error(), NULL))));
+	}
+	_issued++;
+	return (ticket);
+}
+
+//	writes the secret sealed in ticket, throws if the ticket is forged, expired or its key was rotated out
+void	SessionTickets::open(const Message &ticket, void *secret, size_t size)
+{
+	Message			plain;
+	const uint8_t	*data = (const uint8_t *)ticket.getPtr();
+	const t_key		*key = nullptr;
+	uint64_t		issued;
+	uint64_t		current = now();
+	EVP_CIPHER_CTX	*ctx;
+	int				length;
+	bool			ret;
+
+	if (ticket.getSize() != TICKET_HEADER_SIZE + size + sizeof(uint64_t) + SESSION_TICKET_TAG_SIZE)
+		return (reject("invalid session ticket size"));
+	ctx = EVP_CIPHER_CTX_new();
+	if (!ctx)
+		throw (std::runtime_error(std::string("failed to create cipher context: ").append(ERR_error_string(ERR_get_error(), NULL))));
+	plain.resize(size + sizeof(issued));
+	_mutex.lock();
+
+	update();
+	if (_current.id == data[0])
+		key = &_current;
+	for (size_t i = 0; !key && i < _retired.size(); i++)
+		if (_retired[i].id == data[0])
+			key = &_retired[i];
+	ret = key &&
+		EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key->key, data + 1) == 1 &&
+		EVP_DecryptUpdate(ctx, NULL, &length, data, 1) == 1 &&
+		EVP_DecryptUpdate(ctx, (uint8_t *)plain.getPtr(), &length, data + TICKET_HEADER_SIZE, plain.getSize()) == 1 &&
+		EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, SESSION_TICKET_TAG_SIZE, (void *)(data + TICKET_HEADER_SIZE + plain.getSize())) == 1 &&
+		EVP_DecryptFinal_ex(ctx, (uint8_t *)plain.getPtr() + length, &length) == 1;
+
+	_mutex.unlock();
+	EVP_CIPHER_CTX_free(ctx);
+	if (!ret)
+	{
+		OPENSSL_cleanse((void *)plain.getPtr(), plain.getSize());
+		return (reject(key ? "session ticket authentication failed" : "session ticket key expired"));
+	}
+	memcpy(&issued, (const uint8_t *)plain.getPtr() + size, sizeof(issued));
+	issued = network::endian(issued);
+	if (issued > current || current - issued >= (uint64_t)_lifetime.count())
+	{
+		OPENSSL_cleanse((void *)plain.getPtr(), plain.getSize());
+		return (reject("session ticket expired"));
+	}
+	memcpy(secret, plain.getPtr(), size);
+	OPENSSL_cleanse((void *)plain.getPtr(), plain.getSize());
+	_resumed++;
+}
+
+//	retires the current key now, tickets sealed with it stay valid until they expire
+void	SessionTickets::rotate(void)
+{
+	t_key	next;
+
+	generate(next, 0);
+	_mutex.lock();
+
+	retire(next, std::chrono::steady_clock::now());
+
+	_mutex.unlock();
+}
+
+uint64_t	SessionTickets::getIssued(void) const
+{
+	return (_issued);
+}
+
+uint64_t	SessionTickets::getResumed(void) const
+{
+	return (_resumed);
+}
+
+uint64_t	SessionTickets::getRejected(void) const
+{
+	return (_rejected);
+}
+
+void	SessionTickets::generate(t_key &key, uint8_t id)
+{
+	if (RAND_bytes(key.key, sizeof(key.key)) != 1)
+		throw (std::runtime_error(std::string("failed to generate session ticket key: ").append(ERR_error_string(ERR_get_error(), NULL))));
+	key.id = id;
+	key.created = std::chrono::steady_clock::now();
+}
+
+/*
+ *	called with the mutex locked, rotates the keys once per period and drops
+ *	the retired keys once every ticket they sealed has expired
+ */
+void	SessionTickets::update(void)
+{
+	std::chrono::steady_clock::time_point	current = std::chrono::steady_clock::now();
+	t_key									next;
+
+	while (!_retired.empty() && current - _retired.front().retired >= _lifetime)
+	{
+		OPENSSL_cleanse(_retired.front().key, sizeof(_retired.front().key));
+		_retired.pop_front();
+	}
+	if (current - _current.created < _rotation)
+		return ;
+	try
+	{
+		generate(next, 0);
+	}
+	catch (const std::exception &e)
+	{
+		_log.error << e.what() << std::endl;
+		return ;
+	}
+	retire(next, current);
+}
+
+//	called with the mutex locked, makes next the current key, the id of the oldest retired key is reused past 255
+void	SessionTickets::retire(t_key &next, std::chrono::steady_clock::time_point current)
+{
+	if (_retired.size() == UINT8_MAX)
+	{
+		OPENSSL_cleanse(_retired.front().key, sizeof(_retired.front().key));
+		_retired.pop_front();
+	}
+	next.id = _current.id + 1;
+	_current.retired = current;
+	_retired.push_back(_current);
+	_current = next;
+	OPENSSL_cleanse(next.key, sizeof(next.key));
+}
+
+void	SessionTickets::reject(const std::string &reason)
+{
+	_rejected++;
+	throw (std::runtime_error(reason));
+}
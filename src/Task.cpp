@@ -27,7 +27,8 @@
 
 using namespace	ExoEngine;
 
-Task::Task(void) : _function(nullptr), _finishCallback(nullptr), _cancelCallback(nullptr)
+Task::Task(void) : _function(nullptr), _finishCallback(nullptr), _cancelCallback(nullptr),
+	_dataFunction(nullptr), _dataFinishCallback(nullptr), _dataCancelCallback(nullptr), _data(nullptr)
 {
 }
 
@@ -36,7 +37,14 @@ Task::Task(const Task &src)
 	memcpy(this, &src, sizeof(Task));
 }
 
-Task::Task(void (*function)(void), void (*finishCallback)(void), void (*cancelCallback)(void)) : _function(function), _finishCallback(finishCallback), _cancelCallback(cancelCallback)
+Task::Task(void (*function)(void), void (*finishCallback)(void), void (*cancelCallback)(void)) : _function(function), _finishCallback(finishCallback), _cancelCallback(cancelCallback),
+	_dataFunction(nullptr), _dataFinishCallback(nullptr), _dataCancelCallback(nullptr), _data(nullptr)
+{
+}
+
+//	data is given to every function of the task, it isn't owned by the task
+Task::Task(void (*function)(void *), void *data, void (*finishCallback)(void *), void (*cancelCallback)(void *)) : _function(nullptr), _finishCallback(nullptr), _cancelCallback(nullptr),
+	_dataFunction(function), _dataFinishCallback(finishCallback), _dataCancelCallback(cancelCallback), _data(data)
 {
 }
 
@@ -48,16 +56,22 @@ void	Task::launch(void) const
 {
 	if (_function)
 		_function();
+	else if (_dataFunction)
+		_dataFunction(_data);
 }
 
 void	Task::finish(void) const
 {
 	if (_finishCallback)
 		_finishCallback();
+	else if (_dataFinishCallback)
+		_dataFinishCallback(_data);
 }
 
 void	Task::cancel(void) const
 {
 	if (_cancelCallback)
 		_cancelCallback();
+	else if (_dataCancelCallback)
+		_dataCancelCallback(_data);
 }
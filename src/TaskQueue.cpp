@@ -69,6 +69,22 @@ void	TaskQueue::add(const Task &task)
 	_mutex.unlock();
 }
 
+//	unlike add, never overwrites the oldest task when the queue is full
+bool	TaskQueue::tryAdd(const Task &task)
+{
+	_mutex.lock();
+
+	if (_tasks.size() >= TASK_QUEUE_SIZE)
+	{
+		_mutex.unlock();
+		return (false);
+	}
+	_tasks.push(task);
+
+	_mutex.unlock();
+	return (true);
+}
+
 Task	TaskQueue::getTask(void)
 {
 	Task	task;
@@ -0,0 +1,123 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/Aggregator.h"
+
+#include <algorithm>
+
+using namespace	ExoEngine;
+using namespace	network;
+
+Aggregator::Aggregator(void) : _pending(0), _order(0)
+{
+}
+
+Aggregator::~Aggregator(void)
+{
+}
+
+/*
+ *	queues a message, returns how many messages were dropped to respect
+ *	UDP_AGGREGATION_QUEUE_MAX: the newest of the lowest priority go first,
+ *	the message itself if nothing queued has a lower priority
+ */
+size_t	Aggregator::push(const Message &message, uint8_t priority)
+{
+	size_t	dropped = 0;
+
+	while (_pending + message.getSize() > UDP_AGGREGATION_QUEUE_MAX && _entries.size())
+	{
+		auto	lowest = _entries.end() - 1;
+
+		for (auto entry = _entries.end() - 1; entry != _entries.begin(); )
+			if ((--entry)->priority < lowest->priority)
+				lowest = entry;
+		if (lowest->priority >= priority)
+			return (dropped + 1);
+		_pending -= lowest->message.getSize();
+		_entries.erase(lowest);
+		dropped++;
+	}
+	_entries.push_back({message, priority, _order++});
+	_pending += message.getSize();
+	return (dropped);
+}
+
+//	moves the messages fitting in budget bytes to entries, a null budget takes everything
+void	Aggregator::take(size_t budget, std::vector<t_entry> &entries)
+{
+	std::vector<size_t>	selected;
+	size_t				spent = 0;
+	size_t				kept = 0;
+
+	entries.clear();
+	if (!budget || _pending <= budget)
+	{
+		entries.swap(_entries);
+		_pending = 0;
+		return ;
+	}
+	for (size_t i = 0; i < _entries.size(); i++)
+		selected.push_back(i);
+	std::stable_sort(selected.begin(), selected.end(), [this](size_t a, size_t b) { return (_entries[a].priority > _entries[b].priority); });
+	//	at least one message goes so one larger than the budget can't block the queue
+	for (size_t i = 0; i < selected.size(); i++)
+	{
+		if (i && spent + _entries[selected[i]].message.getSize() > budget)
+		{
+			selected.resize(i);
+			break ;
+		}
+		spent += _entries[selected[i]].message.getSize();
+	}
+	std::sort(selected.begin(), selected.end());
+	for (size_t i = 0, j = 0; i < _entries.size(); i++)
+	{
+		if (j < selected.size() && selected[j] == i)
+		{
+			entries.push_back(std::move(_entries[i]));
+			j++;
+		}
+		else
+			_entries[kept++] = std::move(_entries[i]);
+	}
+	_entries.resize(kept);
+	_pending -= spent;
+}
+
+void	Aggregator::clear(void)
+{
+	_entries.clear();
+	_pending = 0;
+}
+
+bool	Aggregator::isEmpty(void) const
+{
+	return (_entries.empty());
+}
+
+size_t	Aggregator::getPending(void) const
+{
+	return (_pending);
+}
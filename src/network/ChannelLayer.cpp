@@ -0,0 +1,466 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/ChannelLayer.h"
+#include "network/network.h"
+#include "Log.h"
+
+#include <string.h>
+#include <cmath>
+
+#define PACKET_HEADER_SIZE	(sizeof(uint16_t) * 2 + sizeof(uint32_t) + sizeof(uint8_t))
+#define FLAGS_OFFSET		(sizeof(uint16_t) * 2 + sizeof(uint32_t))
+
+#define CHANNEL_ACK_VALID	(1 << 0)
+#define ENTRY_HEADER_SIZE	(sizeof(uint8_t) + sizeof(uint16_t) * 2)
+
+#define RTO_INITIAL	0.2
+#define RTO_MIN		0.02
+#define RTO_MAX		2.0
+
+using namespace	ExoEngine;
+using namespace	network;
+
+//	true if sequence a is more recent than b, with wrap around
+static bool	newer(uint16_t a, uint16_t b)
+{
+	return ((int16_t)(a - b) > 0);
+}
+
+template	<typename T>
+static T	readField(const uint8_t *data)
+{
+	T	value;
+
+	memcpy((void *)&value, data, sizeof(T));
+	return (endian(value));
+}
+
+ChannelLayer::ChannelLayer(ISocket &socket) : _socket(socket), _data(nullptr), _messageReceiveCb(nullptr)
+{
+}
+
+ChannelLayer::~ChannelLayer(void)
+{
+	_mutex.lock();
+
+	for (auto connection = _connections.begin(); connection != _connections.end(); connection++)
+		delete connection->second;
+	_connections.clear();
+
+	_mutex.unlock();
+}
+
+uint8_t	ChannelLayer::addChannel(channelType type)
+{
+	uint8_t	id;
+
+	_mutex.lock();
+
+	if (_channels.size() > 0xff || _connections.size())
+	{
+		_mutex.unlock();
+		throw (std::runtime_error("cannot add channel: too many channels or connections already opened"));
+	}
+	id = (uint8_t)_channels.size();
+	_channels.push_back(type);
+
+	_mutex.unlock();
+	return (id);
+}
+
+void	ChannelLayer::send(IClient *client, uint8_t channel, const Message &message)
+{
+	t_connection	*connection;
+	t_channel		*target;
+
+	if (message.getSize() > CHANNEL_PACKET_MAX_SIZE - PACKET_HEADER_SIZE - ENTRY_HEADER_SIZE)
+		throw (std::invalid_argument(std::string("cannot send ").append(std::to_string(message.getSize())).append(" bytes on a channel: message too big")));
+
+	_mutex.lock();
+
+	if (channel >= _channels.size())
+	{
+		_mutex.unlock();
+		throw (std::invalid_argument(std::string("unknown channel ").append(std::to_string(channel))));
+	}
+	connection = getConnection(client);
+	target = &connection->channels[channel];
+	target->outgoing.push_back({target->nextId++, message, timePoint(), false, false});
+
+	_mutex.unlock();
+}
+
+void	ChannelLayer::receive(IClient *client, const Message &packet)
+{
+	const uint8_t	*data = (const uint8_t *)packet.getPtr();
+	size_t			size = packet.getSize();
+	size_t			index = PACKET_HEADER_SIZE;
+	t_connection	*connection;
+	timePoint		now = std::chrono::steady_clock::now();
+	uint16_t		sequence, ack, distance;
+	uint32_t		ackBits;
+	uint8_t			flags;
+
+	if (size < PACKET_HEADER_SIZE)
+	{
+		_log.warning << "channel packet too small (" << size << " bytes), dropped" << std::endl;
+		return ;
+	}
+	sequence = readField<uint16_t>(data);
+	ack = readField<uint16_t>(data + sizeof(uint16_t));
+	ackBits = readField<uint32_t>(data + sizeof(uint16_t) * 2);
+	flags = data[FLAGS_OFFSET];
+
+	_mutex.lock();
+
+	connection = getConnection(client);
+	if (!connection->received || newer(sequence, connection->remoteSequence))
+	{
+		distance = connection->received ? (uint16_t)(sequence - connection->remoteSequence) : 0;
+		if (distance >= 33)
+			connection->ackBits = 0;
+		else if (distance)
+			connection->ackBits = (distance < 32 ? connection->ackBits << distance : 0) | (1u << (distance - 1));
+		connection->remoteSequence = sequence;
+		connection->received = true;
+	}
+	else
+	{
+		distance = (uint16_t)(connection->remoteSequence - sequence);
+		if (!distance || distance > 32 || connection->ackBits & (1u << (distance - 1)))
+		{
+			//	duplicated or too old to be acked
+			_mutex.unlock();
+			return ;
+		}
+		connection->ackBits |= 1u << (distance - 1);
+	}
+	connection->ackPending = true;
+
+	//	only the most recent ack gives a meaningful round trip time sample
+	if (flags & CHANNEL_ACK_VALID)
+	{
+		acknowledge(*connection, ack, now, true);
+		for (uint16_t i = 0; i < 32; i++)
+			if (ackBits & (1u << i))
+				acknowledge(*connection, (uint16_t)(ack - 1 - i), now, false);
+	}
+
+	while (index + ENTRY_HEADER_SIZE <= size)
+	{
+		uint8_t		channel = data[index];
+		uint16_t	id = readField<uint16_t>(data + index + sizeof(uint8_t));
+		uint16_t	length = readField<uint16_t>(data + index + sizeof(uint8_t) + sizeof(uint16_t));
+
+		index += ENTRY_HEADER_SIZE;
+		if (index + length > size || channel >= _channels.size())
+		{
+			_log.warning << "malformed channel packet from " << client->getStrAddress() << ", dropped" << std::endl;
+			break ;
+		}
+		try
+		{
+			deliver(*connection, channel, id, data + index, length);
+		}
+		catch (const std::exception &)
+		{
+			_mutex.unlock();
+			throw ;
+		}
+		//	a callback may have removed the client
+		if (_connections.find(client->getHandle()) == _connections.end())
+			break ;
+		index += length;
+	}
+
+	_mutex.unlock();
+}
+
+void	ChannelLayer::update(void)
+{
+	std::vector<std::pair<uint8_t, uint16_t>>	messages;
+	timePoint									now = std::chrono::steady_clock::now();
+	Message										packet;
+
+	_mutex.lock();
+
+	try
+	{
+		for (auto it = _connections.begin(); it != _connections.end(); it++)
+		{
+			t_connection	&connection = *it->second;
+			bool			flushed = false;
+
+			packet.resize(PACKET_HEADER_SIZE);
+			messages.clear();
+			for (size_t c = 0; c < connection.channels.size(); c++)
+			{
+				t_channel	&channel = connection.channels[c];
+
+				if (channel.type == UNRELIABLE)
+				{
+					for (; !channel.outgoing.empty(); channel.outgoing.pop_front())
+					{
+						t_outgoing	&message = channel.outgoing.front();
+
+						if (packet.getSize() + ENTRY_HEADER_SIZE + message.message.getSize() > CHANNEL_PACKET_MAX_SIZE)
+						{
+							flushPacket(connection, packet, messages, now);
+							flushed = true;
+						}
+						packet.append((uint8_t)c);
+						packet.append(endian(message.id));
+						packet.append(endian((uint16_t)message.message.getSize()));
+						packet.append(message.message);
+					}
+					continue ;
+				}
+				for (size_t i = 0; i < channel.outgoing.size() && i < CHANNEL_WINDOW_SIZE; i++)
+				{
+					t_outgoing	&message = channel.outgoing[i];
+
+					if (message.acked || (message.sent &&
+						std::chrono::duration<double>(now - message.lastSent).count() < connection.rto))
+						continue ;
+					if (packet.getSize() + ENTRY_HEADER_SIZE + message.message.getSize() > CHANNEL_PACKET_MAX_SIZE)
+					{
+						flushPacket(connection, packet, messages, now);
+						flushed = true;
+					}
+					packet.append((uint8_t)c);
+					packet.append(endian(message.id));
+					packet.append(endian((uint16_t)message.message.getSize()));
+					packet.append(message.message);
+					messages.push_back(std::make_pair((uint8_t)c, message.id));
+					message.sent = true;
+					message.lastSent = now;
+				}
+			}
+			if (packet.getSize() > PACKET_HEADER_SIZE || (connection.ackPending && !flushed))
+				flushPacket(connection, packet, messages, now);
+		}
+	}
+	catch (const std::exception &)
+	{
+		_mutex.unlock();
+		throw ;
+	}
+
+	_mutex.unlock();
+}
+
+void	ChannelLayer::remove(IClient *client)
+{
+	_mutex.lock();
+
+	auto	connection = _connections.find(client->getHandle());
+
+	if (connection != _connections.end())
+	{
+		delete connection->second;
+		_connections.erase(connection);
+	}
+
+	_mutex.unlock();
+}
+
+double	ChannelLayer::getRtt(IClient *client)
+{
+	double	rtt;
+
+	_mutex.lock();
+
+	rtt = getConnection(client)->srtt;
+
+	_mutex.unlock();
+	return (rtt);
+}
+
+ISocket	&ChannelLayer::getSocket(void)
+{
+	return (_socket);
+}
+
+void	ChannelLayer::attachData(void *data)
+{
+	_mutex.lock();
+
+	_data = data;
+
+	_mutex.unlock();
+}
+
+void	*ChannelLayer::getData(void)
+{
+	void	*tmp;
+
+	_mutex.lock();
+
+	tmp = _data;
+
+	_mutex.unlock();
+	return (tmp);
+}
+
+void	ChannelLayer::setMessageReceiveCb(void(*callback)(ChannelLayer &, IClient *, uint8_t, const Message &))
+{
+	_mutex.lock();
+
+	_messageReceiveCb = callback;
+
+	_mutex.unlock();
+}
+
+ChannelLayer::t_connection	*ChannelLayer::getConnection(IClient *client)
+{
+	t_connection	*connection;
+
+	auto	it = _connections.find(client->getHandle());
+
+	if (it != _connections.end())
+		return (it->second);
+	connection = new t_connection();
+	connection->client = client;
+	connection->localSequence = 0;
+	connection->remoteSequence = 0;
+	connection->ackBits = 0;
+	connection->received = false;
+	connection->ackPending = false;
+	connection->srtt = 0;
+	connection->rttvar = 0;
+	connection->rto = RTO_INITIAL;
+	connection->channels.resize(_channels.size());
+	for (size_t i = 0; i < _channels.size(); i++)
+	{
+		connection->channels[i].type = _channels[i];
+		connection->channels[i].nextId = 0;
+		connection->channels[i].lowest = 0;
+		for (size_t j = 0; j < CHANNEL_WINDOW_SIZE; j++)
+			connection->channels[i].incoming[j].received = false;
+	}
+	_connections[client->getHandle()] = connection;
+	return (connection);
+}
+
+void	ChannelLayer::acknowledge(t_connection &connection, uint16_t sequence, const timePoint &now, bool sample)
+{
+	t_sentPacket	&packet = connection.sent[sequence % CHANNEL_SENT_HISTORY];
+	double			rtt;
+
+	if (!packet.used || packet.acked || packet.sequence != sequence)
+		return ;
+	packet.acked = true;
+
+	if (sample)
+	{
+		rtt = std::chrono::duration<double>(now - packet.time).count();
+		if (!connection.srtt)
+		{
+			connection.srtt = rtt;
+			connection.rttvar = rtt / 2;
+		}
+		else
+		{
+			connection.rttvar = 0.75 * connection.rttvar + 0.25 * std::fabs(connection.srtt - rtt);
+			connection.srtt = 0.875 * connection.srtt + 0.125 * rtt;
+		}
+		connection.rto = std::min(RTO_MAX, std::max(RTO_MIN, connection.srtt + 4 * connection.rttvar));
+	}
+
+	for (auto message = packet.messages.begin(); message != packet.messages.end(); message++)
+	{
+		t_channel	&channel = connection.channels[message->first];
+		uint16_t	index;
+
+		if (channel.outgoing.empty())
+			continue ;
+		index = (uint16_t)(message->second - channel.outgoing.front().id);
+		if (index < channel.outgoing.size())
+			channel.outgoing[index].acked = true;
+		while (!channel.outgoing.empty() && channel.outgoing.front().acked)
+			channel.outgoing.pop_front();
+	}
+}
+
+void	ChannelLayer::deliver(t_connection &connection, uint8_t channel, uint16_t id, const uint8_t *data, uint16_t size)
+{
+	t_channel	&target = connection.channels[channel];
+	IClient		*client = connection.client;
+	uint16_t	offset;
+
+	if (target.type == UNRELIABLE)
+	{
+		if (_messageReceiveCb)
+			_messageReceiveCb(*this, client, channel, Message(data, size));
+		return ;
+	}
+	offset = (uint16_t)(id - target.lowest);
+	if (offset >= CHANNEL_WINDOW_SIZE || target.incoming[id % CHANNEL_WINDOW_SIZE].received)
+		return ;
+	target.incoming[id % CHANNEL_WINDOW_SIZE].received = true;
+	if (target.type == RELIABLE_UNORDERED)
+	{
+		while (target.incoming[target.lowest % CHANNEL_WINDOW_SIZE].received)
+			target.incoming[target.lowest++ % CHANNEL_WINDOW_SIZE].received = false;
+		if (_messageReceiveCb)
+			_messageReceiveCb(*this, client, channel, Message(data, size));
+		return ;
+	}
+	target.incoming[id % CHANNEL_WINDOW_SIZE].message = Message(data, size);
+	while (target.incoming[target.lowest % CHANNEL_WINDOW_SIZE].received)
+	{
+		t_incoming	&incoming = target.incoming[target.lowest++ % CHANNEL_WINDOW_SIZE];
+		Message		message(std::move(incoming.message));
+
+		incoming.received = false;
+		if (_messageReceiveCb)
+			_messageReceiveCb(*this, client, channel, message);
+		if (_connections.find(client->getHandle()) == _connections.end())
+			return ;
+	}
+}
+
+void	ChannelLayer::flushPacket(t_connection &connection, Message &packet, std::vector<std::pair<uint8_t, uint16_t>> &messages, const timePoint &now)
+{
+	t_sentPacket	&sent = connection.sent[connection.localSequence % CHANNEL_SENT_HISTORY];
+	uint16_t		sequence = endian(connection.localSequence);
+	uint16_t		ack = endian(connection.remoteSequence);
+	uint32_t		ackBits = endian(connection.ackBits);
+
+	memcpy(&packet[0], &sequence, sizeof(sequence));
+	memcpy(&packet[sizeof(uint16_t)], &ack, sizeof(ack));
+	memcpy(&packet[sizeof(uint16_t) * 2], &ackBits, sizeof(ackBits));
+	packet[FLAGS_OFFSET] = connection.received ? CHANNEL_ACK_VALID : 0;
+	sent.sequence = connection.localSequence;
+	sent.used = true;
+	sent.acked = false;
+	sent.time = now;
+	sent.messages.swap(messages);
+	messages.clear();
+	connection.localSequence++;
+	connection.ackPending = false;
+	_socket.send(connection.client, packet);
+	packet.resize(PACKET_HEADER_SIZE);
+}
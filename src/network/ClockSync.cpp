@@ -0,0 +1,290 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/ClockSync.h"
+#include "network/network.h"
+#include "network/PacketDispatcher.h"
+
+#include <string.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#define PING_SIZE	(sizeof(t_header) + sizeof(uint64_t))
+#define PONG_SIZE	(sizeof(t_header) + sizeof(uint64_t) * 3)
+
+using namespace	ExoEngine;
+using namespace	network;
+
+static void	writeTime(uint8_t *dst, int64_t time)
+{
+	uint64_t	value = endian((uint64_t)time);
+
+	memcpy(dst, &value, sizeof(value));
+}
+
+static int64_t	readTime(const uint8_t *src)
+{
+	uint64_t	value;
+
+	memcpy(&value, src, sizeof(value));
+	return ((int64_t)endian(value));
+}
+
+ClockSync::ClockSync(ISocket &socket) : _socket(socket)
+{
+}
+
+ClockSync::~ClockSync(void)
+{
+}
+
+//	microseconds of the local clock
+int64_t	ClockSync::getTime(void)
+{
+	return (std::chrono::duration_cast<std::chrono::microseconds>(clock::now().time_since_epoch()).count());
+}
+
+//	time of the peer clock, the server time for a client
+int64_t	ClockSync::getRemoteTime(IClient *peer)
+{
+	return (getTime() + peer->getClockOffset());
+}
+
+//	local time point of a time of the peer clock
+ClockSync::clock::time_point	ClockSync::toLocal(IClient *peer, int64_t time)
+{
+	return (clock::time_point(std::chrono::duration_cast<clock::duration>(std::chrono::microseconds(time - peer->getClockOffset()))));
+}
+
+//	an alarm ringing at a time of the peer clock
+Alarm	ClockSync::alarm(IClient *peer, const Task &task, int64_t time)
+{
+	return (Alarm(task, toLocal(peer, time)));
+}
+
+//	the first ping is sent by the next update
+void	ClockSync::add(IClient *client)
+{
+	t_peer	peer;
+
+	peer.client = client;
+	peer.next = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < CLOCK_SYNC_PENDING; i++)
+		peer.pings[i].waiting = false;
+	peer.sent = 0;
+	peer.srtt = 0;
+	peer.rttvar = 0;
+	peer.count = 0;
+	_mutex.lock();
+	try
+	{
+		_peers[client->getHandle()] = peer;
+	}
+	catch (const std::exception &)
+	{
+		_mutex.unlock();
+		throw ;
+	}
+	_mutex.unlock();
+}
+
+void	ClockSync::remove(IClient *client)
+{
+	_mutex.lock();
+	_peers.erase(client->getHandle());
+	_mutex.unlock();
+}
+
+//	the ping is remembered in place of the oldest one, its pong is expected back with the same t0
+Message	ClockSync::ping(t_peer &peer)
+{
+	Message	packet(PING_SIZE);
+	t_ping	&pending = peer.pings[peer.sent % CLOCK_SYNC_PENDING];
+
+	pending.time = getTime();
+	pending.sent = std::chrono::steady_clock::now();
+	pending.waiting = true;
+	PacketDispatcher::writeHeader(&packet[0], TYPE_CLOCK_PING, PING_SIZE);
+	writeTime(&packet[sizeof(t_header)], pending.time);
+	peer.sent++;
+	peer.next = pending.sent + std::chrono::milliseconds(peer.sent < CLOCK_SYNC_BURST ? CLOCK_SYNC_BURST_INTERVAL : CLOCK_SYNC_INTERVAL);
+	return (packet);
+}
+
+/*
+ *	sends the pings due, they are built under the mutex and sent after it:
+ *	a receive run with the socket locked takes the mutex in the other order
+ */
+void	ClockSync::update(void)
+{
+	std::chrono::steady_clock::time_point				now = std::chrono::steady_clock::now();
+	std::vector<std::pair<IClient::handle, Message>>	pings;
+	IClient												*client;
+
+	_mutex.lock();
+	try
+	{
+		for (auto peer = _peers.begin(); peer != _peers.end(); peer++)
+			if (now >= peer->second.next)
+				pings.emplace_back(peer->first, ping(peer->second));
+	}
+	catch (const std::exception &)
+	{
+		_mutex.unlock();
+		throw ;
+	}
+	_mutex.unlock();
+	for (auto packet = pings.begin(); packet != pings.end(); packet++)
+		if ((client = _socket.getClient(packet->first)))
+			_socket.send(client, packet->second);
+}
+
+/*
+ *	answers pings and measures pongs of a buffer holding only clock
+ *	packets, split by their header.size, and returns true. A buffer holding
+ *	another packet is left untouched and false is returned: on a tcp socket
+ *	the clock packets should rather be bound to a PacketDispatcher, which
+ *	also rebuilds the packets cut between two reads
+ */
+bool	ClockSync::receive(IClient *client, const Message &packet)
+{
+	std::chrono::steady_clock::time_point	received = std::chrono::steady_clock::now();
+	int64_t									now = getTime();
+	const uint8_t							*data = (const uint8_t *)packet.getPtr();
+	size_t									size = packet.getSize();
+	size_t									index;
+	t_header								header;
+
+	for (index = 0; index < size; index += header.size)
+	{
+		if (size - index < sizeof(t_header))
+			return (false);
+		memcpy(&header, data + index, sizeof(header));
+		ENDIAN(header.type);
+		ENDIAN(header.size);
+		if ((header.type != TYPE_CLOCK_PING && header.type != TYPE_CLOCK_PONG)
+			|| header.size < sizeof(t_header) || header.size > size - index)
+			return (false);
+	}
+	for (index = 0; index < size; index += header.size)
+	{
+		memcpy(&header, data + index, sizeof(header));
+		ENDIAN(header.type);
+		ENDIAN(header.size);
+		handle(client, header.type, data + index + sizeof(t_header), header.size - sizeof(t_header), received, now);
+	}
+	return (size > 0);
+}
+
+//	binds the clock packets to dispatcher, which then replaces the calls to receive
+void	ClockSync::bind(PacketDispatcher &dispatcher)
+{
+	dispatcher.bind(TYPE_CLOCK_PING, &ClockSync::dispatched, this);
+	dispatcher.bind(TYPE_CLOCK_PONG, &ClockSync::dispatched, this);
+}
+
+void	ClockSync::dispatched(PacketDispatcher &dispatcher, IClient *client, const t_header &header, const uint8_t *data, size_t size)
+{
+	std::chrono::steady_clock::time_point	received = std::chrono::steady_clock::now();
+
+	((ClockSync *)dispatcher.getContext(header.type))->handle(client, header.type, data, size, received, getTime());
+}
+
+//	clock packets whose payload has the wrong size are dropped
+void	ClockSync::handle(IClient *client, int32_t type, const uint8_t *data, size_t size, std::chrono::steady_clock::time_point received, int64_t now)
+{
+	uint8_t	pong[PONG_SIZE];
+
+	if (type == TYPE_CLOCK_PING && size == PING_SIZE - sizeof(t_header))
+	{
+		PacketDispatcher::writeHeader(pong, TYPE_CLOCK_PONG, PONG_SIZE);
+		memcpy(pong + sizeof(t_header), data, sizeof(uint64_t));
+		writeTime(pong + sizeof(t_header) + sizeof(uint64_t), now);
+		writeTime(pong + sizeof(t_header) + sizeof(uint64_t) * 2, getTime());
+		_socket.send(client, Message(pong, sizeof(pong)));
+	}
+	else if (type == TYPE_CLOCK_PONG && size == PONG_SIZE - sizeof(t_header))
+		sample(client, readTime(data), readTime(data + sizeof(uint64_t)), readTime(data + sizeof(uint64_t) * 2), now, received);
+}
+
+//	t3 is only used for the offset, the time elapsed since the ping is read on the steady clock
+void	ClockSync::sample(IClient *client, int64_t t0, int64_t t1, int64_t t2, int64_t t3, std::chrono::steady_clock::time_point received)
+{
+	t_ping	*pending = nullptr;
+	int64_t	rtt;
+	t_peer	*peer;
+	size_t	best = 0;
+
+	if (t2 < t1)
+		return ;
+	_mutex.lock();
+
+	auto	found = _peers.find(client->getHandle());
+
+	if (found == _peers.end())
+	{
+		_mutex.unlock();
+		return ;
+	}
+	peer = &found->second;
+	for (size_t i = 0; i < CLOCK_SYNC_PENDING && !pending; i++)
+		if (peer->pings[i].waiting && peer->pings[i].time == t0)
+			pending = &peer->pings[i];
+	if (!pending)
+	{
+		_mutex.unlock();
+		return ;
+	}
+	pending->waiting = false;
+	rtt = std::chrono::duration_cast<std::chrono::microseconds>(received - pending->sent).count() - (t2 - t1);
+	if (rtt < 0)
+	{
+		_mutex.unlock();
+		return ;
+	}
+	if (!peer->srtt)
+	{
+		peer->srtt = rtt;
+		peer->rttvar = rtt / 2.0;
+	}
+	else
+	{
+		peer->rttvar = 0.75 * peer->rttvar + 0.25 * std::fabs(peer->srtt - rtt);
+		peer->srtt = 0.875 * peer->srtt + 0.125 * rtt;
+	}
+	peer->samples[peer->count++ % CLOCK_SYNC_FILTER] = {rtt, ((t1 - t0) + (t2 - t3)) / 2};
+	for (size_t i = 1; i < std::min(peer->count, (size_t)CLOCK_SYNC_FILTER); i++)
+		if (peer->samples[i].rtt < peer->samples[best].rtt)
+			best = i;
+	//	a null rtt would read as unknown
+	client->setClock(std::max((int64_t)peer->srtt, (int64_t)1), (int64_t)peer->rttvar, peer->samples[best].offset);
+
+	_mutex.unlock();
+}
+
+ISocket	&ClockSync::getSocket(void)
+{
+	return (_socket);
+}
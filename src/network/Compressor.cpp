@@ -0,0 +1,271 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/Compressor.h"
+#include "network/network.h"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#define FRAME_HEADER_SIZE	(sizeof(uint8_t) + sizeof(uint32_t))
+#define HELLO_SIZE			(sizeof(uint8_t) + sizeof(uint32_t))
+#define DEFLATE_CHUNK_SIZE	4096
+
+using namespace	ExoEngine;
+using namespace	network;
+
+//	a sync flush always ends with an empty stored block, it isn't sent
+static const uint8_t	syncTail[] = {0x00, 0x00, 0xff, 0xff};
+
+template	<typename T>
+static T	readField(const uint8_t *data)
+{
+	T	value;
+
+	memcpy((void *)&value, data, sizeof(T));
+	return (endian(value));
+}
+
+static uint64_t	elapsed(const std::chrono::steady_clock::time_point &start)
+{
+	return (std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+Compressor::Compressor(int level, size_t minSize, const std::shared_ptr<const std::string> &dictionary) : _dictionary(dictionary), _minSize(minSize), _negotiated(false),
+	_messagesSent(0), _messagesCompressed(0), _messagesReceived(0), _rawBytesSent(0), _compressedBytesSent(0),
+	_rawBytesReceived(0), _compressedBytesReceived(0), _deflateTime(0), _inflateTime(0)
+{
+	memset(&_deflate, 0, sizeof(_deflate));
+	memset(&_inflate, 0, sizeof(_inflate));
+	if (deflateInit2(&_deflate, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		throw (std::runtime_error(std::string("cannot create deflate stream: ").append(_deflate.msg ? _deflate.msg : "invalid level")));
+	if (inflateInit2(&_inflate, -MAX_WBITS) != Z_OK)
+	{
+		deflateEnd(&_deflate);
+		throw (std::runtime_error(std::string("cannot create inflate stream: ").append(_inflate.msg ? _inflate.msg : "out of memory")));
+	}
+	_dictionaryId = dictionaryId(_dictionary ? *_dictionary : std::string());
+	if (_dictionary && _dictionary->size() &&
+		(deflateSetDictionary(&_deflate, (const Bytef *)_dictionary->data(), _dictionary->size()) != Z_OK ||
+		inflateSetDictionary(&_inflate, (const Bytef *)_dictionary->data(), _dictionary->size()) != Z_OK))
+	{
+		deflateEnd(&_deflate);
+		inflateEnd(&_inflate);
+		throw (std::runtime_error("cannot set compression dictionary"));
+	}
+}
+
+Compressor::~Compressor(void)
+{
+	deflateEnd(&_deflate);
+	inflateEnd(&_inflate);
+}
+
+void	Compressor::hello(Message &dst)
+{
+	uint8_t	data[HELLO_SIZE];
+	uint32_t	id = endian(_dictionaryId);
+
+	data[0] = COMPRESSOR_VERSION;
+	memcpy(data + 1, &id, sizeof(id));
+	frame(HELLO, data, sizeof(data), dst);
+}
+
+/*
+ *	appends the frame of src to dst, returns true if it was compressed.
+ *	Once a message went through deflate its frame must reach the peer,
+ *	dropping it would desynchronize the peer's inflate stream.
+ */
+bool	Compressor::encode(const Message &src, Message &dst)
+{
+	std::chrono::steady_clock::time_point	start;
+	size_t									size = src.getSize();
+	size_t									produced = 0;
+	int										ret;
+
+	_messagesSent++;
+	if (!_negotiated || size < _minSize)
+	{
+		frame(RAW, src.getPtr(), size, dst);
+		return (false);
+	}
+	start = std::chrono::steady_clock::now();
+	_deflate.next_in = (Bytef *)src.getPtr();
+	_deflate.avail_in = size;
+	do
+	{
+		if (_deflateBuffer.size() < produced + DEFLATE_CHUNK_SIZE)
+			_deflateBuffer.resize(produced + std::max((size_t)DEFLATE_CHUNK_SIZE, size / 2));
+		_deflate.next_out = _deflateBuffer.data() + produced;
+		_deflate.avail_out = _deflateBuffer.size() - produced;
+		ret = deflate(&_deflate, Z_SYNC_FLUSH);
+		produced = _deflateBuffer.size() - _deflate.avail_out;
+		if (ret == Z_BUF_ERROR)
+			break ;
+		if (ret != Z_OK)
+			throw (std::runtime_error(std::string("cannot deflate message: ").append(_deflate.msg ? _deflate.msg : std::to_string(ret))));
+	}
+	while (_deflate.avail_in || !_deflate.avail_out);
+	if (produced >= sizeof(syncTail) && !memcmp(_deflateBuffer.data() + produced - sizeof(syncTail), syncTail, sizeof(syncTail)))
+		produced -= sizeof(syncTail);
+	_deflateTime += elapsed(start);
+	_messagesCompressed++;
+	_rawBytesSent += size;
+	_compressedBytesSent += produced;
+	frame(DEFLATE, _deflateBuffer.data(), produced, dst);
+	return (true);
+}
+
+/*
+ *	data is what was read from the socket, it can hold any number of frames
+ *	and end in the middle of one. Complete messages are appended to messages,
+ *	a malformed frame throws and leaves the connection unusable.
+ */
+void	Compressor::decode(const void *data, size_t size, std::vector<Message> &messages)
+{
+	const uint8_t	*ptr;
+	size_t			total;
+	size_t			index = 0;
+	uint8_t			type;
+	uint32_t		length;
+
+	_pending.append(data, size);
+	ptr = (const uint8_t *)_pending.getPtr();
+	total = _pending.getSize();
+	while (total - index >= FRAME_HEADER_SIZE)
+	{
+		type = ptr[index];
+		length = readField<uint32_t>(ptr + index + 1);
+		if (type > HELLO || length > COMPRESSOR_MAX_FRAME_SIZE)
+		{
+			_pending.clear();
+			throw (std::runtime_error(std::string("invalid compression frame of type ").append(std::to_string(type)).append(" and size ").append(std::to_string(length))));
+		}
+		if (total - index - FRAME_HEADER_SIZE < length)
+			break ;
+		receive((frameType)type, ptr + index + FRAME_HEADER_SIZE, length, messages);
+		index += FRAME_HEADER_SIZE + length;
+	}
+	if (index == total)
+		_pending.clear();
+	else if (index)
+		_pending = Message(ptr + index, total - index);
+}
+
+bool	Compressor::isNegotiated(void) const
+{
+	return (_negotiated);
+}
+
+t_compressionStats	Compressor::getStats(void) const
+{
+	t_compressionStats	stats;
+
+	memset(&stats, 0, sizeof(stats));
+	addStats(stats);
+	return (stats);
+}
+
+void	Compressor::addStats(t_compressionStats &total) const
+{
+	total.messagesSent += _messagesSent;
+	total.messagesCompressed += _messagesCompressed;
+	total.messagesReceived += _messagesReceived;
+	total.rawBytesSent += _rawBytesSent;
+	total.compressedBytesSent += _compressedBytesSent;
+	total.rawBytesReceived += _rawBytesReceived;
+	total.compressedBytesReceived += _compressedBytesReceived;
+	total.deflateTime += _deflateTime;
+	total.inflateTime += _inflateTime;
+}
+
+uint32_t	Compressor::dictionaryId(const std::string &dictionary)
+{
+	return (adler32(adler32(0, Z_NULL, 0), (const Bytef *)dictionary.data(), dictionary.size()));
+}
+
+//	compressed size over raw size of sent messages, 1 when nothing was compressed
+double	Compressor::getRatio(const t_compressionStats &stats)
+{
+	if (!stats.rawBytesSent)
+		return (1);
+	return ((double)stats.compressedBytesSent / stats.rawBytesSent);
+}
+
+void	Compressor::frame(frameType type, const void *data, size_t size, Message &dst)
+{
+	dst.append((uint8_t)type);
+	dst.append(endian((uint32_t)size));
+	dst.append(data, size);
+}
+
+void	Compressor::receive(frameType type, const uint8_t *data, size_t size, std::vector<Message> &messages)
+{
+	std::chrono::steady_clock::time_point	start;
+	size_t									produced = 0;
+	int										ret;
+
+	switch (type)
+	{
+		case HELLO:
+			if (size >= HELLO_SIZE && data[0] == COMPRESSOR_VERSION && readField<uint32_t>(data + 1) == _dictionaryId)
+				_negotiated = true;
+			return ;
+		case RAW:
+			_messagesReceived++;
+			messages.push_back(Message(data, size));
+			return ;
+		case DEFLATE:
+			break ;
+	}
+	start = std::chrono::steady_clock::now();
+	for (int pass = 0; pass < 2; pass++)
+	{
+		_inflate.next_in = pass ? (Bytef *)syncTail : (Bytef *)data;
+		_inflate.avail_in = pass ? sizeof(syncTail) : size;
+		do
+		{
+			if (_inflateBuffer.size() < produced + DEFLATE_CHUNK_SIZE)
+				_inflateBuffer.resize(produced + std::max((size_t)DEFLATE_CHUNK_SIZE, size * 2));
+			_inflate.next_out = _inflateBuffer.data() + produced;
+			_inflate.avail_out = _inflateBuffer.size() - produced;
+			ret = inflate(&_inflate, Z_SYNC_FLUSH);
+			produced = _inflateBuffer.size() - _inflate.avail_out;
+			if (ret == Z_BUF_ERROR)
+				break ;
+			if (ret != Z_OK)
+				throw (std::runtime_error(std::string("cannot inflate message: ").append(_inflate.msg ? _inflate.msg : std::to_string(ret))));
+			if (produced > COMPRESSOR_MAX_FRAME_SIZE)
+				throw (std::runtime_error("cannot inflate message: message too big"));
+		}
+		while (_inflate.avail_in || !_inflate.avail_out);
+	}
+	_inflateTime += elapsed(start);
+	_messagesReceived++;
+	_rawBytesReceived += produced;
+	_compressedBytesReceived += size;
+	messages.push_back(Message(_inflateBuffer.data(), produced));
+}
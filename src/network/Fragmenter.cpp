@@ -0,0 +1,241 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/Fragmenter.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_net.h>
+
+using namespace	ExoEngine;
+using namespace	network;
+
+//	payload sizes probed, largest first
+static const uint16_t	probeSizes[] = {UDP_MTU_MAX, 1400, 1280};
+
+MessagePool::MessagePool(size_t max, size_t budget) : _max(max), _budget(budget), _reserved(0)
+{
+}
+
+MessagePool::~MessagePool(void)
+{
+}
+
+Message	MessagePool::acquire(size_t size)
+{
+	Message	message;
+
+	if (_free.empty())
+		return (Message(size));
+	message = std::move(_free.back());
+	_free.pop_back();
+	message.resize(size);
+	return (message);
+}
+
+void	MessagePool::release(Message &&message)
+{
+	if (_free.size() >= _max)
+		return ;
+	message.clear();
+	_free.push_back(std::move(message));
+}
+
+//	counts size bytes against the budget, false if they don't fit
+bool	MessagePool::reserve(size_t size)
+{
+	if (size > _budget - _reserved)
+		return (false);
+	_reserved += size;
+	return (true);
+}
+
+void	MessagePool::unreserve(size_t size)
+{
+	_reserved -= std::min(size, _reserved);
+}
+
+Fragmenter::Fragmenter(void) : _reserved(0), _mtu(UDP_MTU_DEFAULT), _id(0), _probes(0)
+{
+}
+
+Fragmenter::~Fragmenter(void)
+{
+}
+
+size_t	Fragmenter::getMtu(void) const
+{
+	return (_mtu);
+}
+
+uint16_t	Fragmenter::nextId(void)
+{
+	return (_id++);
+}
+
+//	fills sizes and returns true when probes are due, up to UDP_MTU_PROBE_RETRIES rounds
+bool	Fragmenter::probe(std::chrono::steady_clock::time_point now, std::vector<uint16_t> &sizes)
+{
+	sizes.clear();
+	if (_probes >= UDP_MTU_PROBE_RETRIES || now < _probeTime)
+		return (false);
+	for (size_t i = 0; i < sizeof(probeSizes) / sizeof(*probeSizes); i++)
+		if (probeSizes[i] > _mtu && probeSizes[i] <= UDP_MTU_MAX)
+			sizes.push_back(probeSizes[i]);
+	if (sizes.empty())
+	{
+		_probes = UDP_MTU_PROBE_RETRIES;
+		return (false);
+	}
+	_probes++;
+	_probeTime = now + std::chrono::milliseconds(UDP_MTU_PROBE_INTERVAL);
+	return (true);
+}
+
+void	Fragmenter::acknowledge(uint16_t size)
+{
+	if (size > _mtu && size <= UDP_MTU_MAX)
+		_mtu = size;
+}
+
+/*
+ *	copies a fragment into its message, returns true and moves the message
+ *	out when it was the last missing one. Invalid fragments, duplicates and
+ *	new messages beyond the budget of the socket are ignored.
+ */
+bool	Fragmenter::add(const t_fragment &fragment, const uint8_t *data, size_t size, MessagePool &buffers, std::chrono::steady_clock::time_point now, Message &message)
+{
+	t_reassembly	*entry;
+	bool			last = fragment.index == fragment.count - 1;
+	size_t			required = (size_t)fragment.count * fragment.size;
+	auto			found = _reassembly.find(fragment.id);
+
+	if (!fragment.count || fragment.index >= fragment.count || !fragment.size || (size_t)(fragment.count - 1) * fragment.size >= UDP_MESSAGE_MAX_SIZE)
+		return (false);
+	if ((!last && size != fragment.size) || (last && (!size || size > fragment.size)))
+		return (false);
+	if (found == _reassembly.end())
+	{
+		while (!_reassembly.empty() && (_reassembly.size() >= UDP_REASSEMBLY_MAX || _reserved + required > UDP_REASSEMBLY_CLIENT_SIZE))
+		{
+			auto	oldest = _reassembly.begin();
+
+			for (auto it = _reassembly.begin(); it != _reassembly.end(); it++)
+				if (it->second.start < oldest->second.start)
+					oldest = it;
+			buffers.release(std::move(oldest->second.buffer));
+			drop(oldest->first, buffers);
+		}
+		if (!buffers.reserve(required))
+			return (false);
+		_reserved += required;
+		entry = &_reassembly[fragment.id];
+		entry->buffer = buffers.acquire(required);
+		entry->bitmap.assign((fragment.count + 63) / 64, 0);
+		entry->count = fragment.count;
+		entry->received = 0;
+		entry->size = fragment.size;
+		entry->last = 0;
+		entry->start = now;
+	}
+	else
+		entry = &found->second;
+	if (entry->count != fragment.count || entry->size != fragment.size)
+		return (false);
+	if (entry->bitmap[fragment.index / 64] & ((uint64_t)1 << (fragment.index % 64)))
+		return (false);
+	entry->bitmap[fragment.index / 64] |= (uint64_t)1 << (fragment.index % 64);
+	memcpy(&entry->buffer[(size_t)fragment.index * fragment.size], data, size);
+	if (last)
+		entry->last = size;
+	if (++entry->received < entry->count)
+		return (false);
+	entry->buffer.resize((size_t)(entry->count - 1) * entry->size + entry->last);
+	message = std::move(entry->buffer);
+	drop(fragment.id, buffers);
+	return (true);
+}
+
+//	drops the messages still incomplete after UDP_REASSEMBLY_TIMEOUT, returns how many
+size_t	Fragmenter::expire(std::chrono::steady_clock::time_point now, MessagePool &buffers)
+{
+	size_t	expired = 0;
+
+	for (auto it = _reassembly.begin(); it != _reassembly.end(); )
+	{
+		if (now - it->second.start < std::chrono::milliseconds(UDP_REASSEMBLY_TIMEOUT))
+		{
+			it++;
+			continue ;
+		}
+		buffers.release(std::move(it->second.buffer));
+		buffers.unreserve((size_t)it->second.count * it->second.size);
+		_reserved -= (size_t)it->second.count * it->second.size;
+		it = _reassembly.erase(it);
+		expired++;
+	}
+	return (expired);
+}
+
+void	Fragmenter::clear(MessagePool &buffers)
+{
+	for (auto it = _reassembly.begin(); it != _reassembly.end(); it++)
+		buffers.release(std::move(it->second.buffer));
+	buffers.unreserve(_reserved);
+	_reserved = 0;
+	_reassembly.clear();
+}
+
+//	forgets a message and gives its bytes back to the budget, its buffer must have been released or moved out
+void	Fragmenter::drop(uint16_t id, MessagePool &buffers)
+{
+	auto	entry = _reassembly.find(id);
+
+	buffers.unreserve((size_t)entry->second.count * entry->second.size);
+	_reserved -= (size_t)entry->second.count * entry->second.size;
+	_reassembly.erase(entry);
+}
+
+//	writes the header of a fragment, UDP_FRAGMENT_HEADER_SIZE bytes
+void	Fragmenter::write(uint8_t *data, const t_fragment &fragment)
+{
+	data[0] = FRAGMENT;
+	SDLNet_Write16(fragment.id, data + 1);
+	SDLNet_Write16(fragment.index, data + 3);
+	SDLNet_Write16(fragment.count, data + 5);
+	SDLNet_Write16(fragment.size, data + 7);
+}
+
+bool	Fragmenter::read(const uint8_t *data, size_t size, t_fragment &fragment)
+{
+	if (size < UDP_FRAGMENT_HEADER_SIZE || data[0] != FRAGMENT)
+		return (false);
+	fragment.id = SDLNet_Read16(data + 1);
+	fragment.index = SDLNet_Read16(data + 3);
+	fragment.count = SDLNet_Read16(data + 5);
+	fragment.size = SDLNet_Read16(data + 7);
+	return (true);
+}
@@ -30,6 +30,10 @@
 using namespace	ExoEngine;
 using namespace	network;
 
+IClient::IClient(void) : _data(nullptr), _handle(0), _messagesSent(0), _messagesReceived(0), _bytesSent(0), _bytesReceived(0), _sendDrops(0), _rtt(0), _rttVar(0), _clockOffset(0)
+{
+}
+
 IClient::~IClient()
 {
 }
@@ -43,3 +47,75 @@ void	*IClient::getData(void)
 {
 	return (_data);
 }
+
+IClient::handle	IClient::getHandle(void) const
+{
+	return (_handle);
+}
+
+void	IClient::setHandle(handle id)
+{
+	_handle = id;
+}
+
+//	counters are bumped by the socket of the client, from any thread
+void	IClient::addSent(uint64_t messages, uint64_t bytes)
+{
+	_messagesSent.fetch_add(messages, std::memory_order_relaxed);
+	_bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void	IClient::addReceived(uint64_t messages, uint64_t bytes)
+{
+	_messagesReceived.fetch_add(messages, std::memory_order_relaxed);
+	_bytesReceived.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void	IClient::addDrop(void)
+{
+	_sendDrops.fetch_add(1, std::memory_order_relaxed);
+}
+
+//	the rtt comes from a ClockSync if any, clients measuring it themselves override this
+t_clientMetrics	IClient::getMetrics(void)
+{
+	t_clientMetrics	metrics;
+
+	metrics.messagesSent = _messagesSent.load(std::memory_order_relaxed);
+	metrics.messagesReceived = _messagesReceived.load(std::memory_order_relaxed);
+	metrics.bytesSent = _bytesSent.load(std::memory_order_relaxed);
+	metrics.bytesReceived = _bytesReceived.load(std::memory_order_relaxed);
+	metrics.sendDrops = _sendDrops.load(std::memory_order_relaxed);
+	metrics.sendQueue = 0;
+	metrics.rtt = _rtt.load(std::memory_order_relaxed);
+	metrics.rttVar = _rttVar.load(std::memory_order_relaxed);
+	return (metrics);
+}
+
+//	estimates of a ClockSync, in microseconds
+void	IClient::setClock(int64_t rtt, int64_t rttVar, int64_t offset)
+{
+	_rttVar.store(rttVar, std::memory_order_relaxed);
+	_clockOffset.store(offset, std::memory_order_relaxed);
+	_rtt.store(rtt, std::memory_order_release);
+}
+
+bool	IClient::hasClock(void) const
+{
+	return (_rtt.load(std::memory_order_acquire) > 0);
+}
+
+int64_t	IClient::getRtt(void) const
+{
+	return (_rtt.load(std::memory_order_relaxed));
+}
+
+int64_t	IClient::getRttVar(void) const
+{
+	return (_rttVar.load(std::memory_order_relaxed));
+}
+
+int64_t	IClient::getClockOffset(void) const
+{
+	return (_clockOffset.load(std::memory_order_relaxed));
+}
@@ -23,8 +23,15 @@
  */
 
 #include "network/ISocket.h"
+#include "network/Recorder.h"
+#include "network/LinkConditioner.h"
+#include "Reflectable.h"
 #include "Log.h"
 
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
 using namespace	ExoEngine;
 using namespace	network;
 
@@ -60,6 +67,7 @@ ISocket::ISocket(size_t size)
 	_binded = false;
 	_set = SDLNet_AllocSocketSet((int)size);
 	_clients_max = size;
+	_timeout = 0;
 	if (!_set)
 	{
 		_mutex.unlock();
@@ -73,6 +81,9 @@ ISocket::ISocket(size_t size)
 	_socketBindCb = NULL;
 	_socketUnbindCb = NULL;
 	_socketExceptionCb = NULL;
+	_tasks = nullptr;
+	_recorder = nullptr;
+	_conditioner = nullptr;
 
 	_mutex.unlock();
 }
@@ -98,6 +109,97 @@ size_t	ISocket::getClientsNumber(void)
 	return (size);
 }
 
+IClient	*ISocket::getClient(IClient::handle handle)
+{
+	IClient	**client;
+	IClient	*tmp;
+
+	_mutex.lock();
+
+	client = _clients.get(handle);
+	tmp = client ? *client : nullptr;
+
+	_mutex.unlock();
+	return (tmp);
+}
+
+/*
+ *	the counters are read without the mutex, only the fields depending on
+ *	the connected clients need it
+ */
+t_socketMetrics	ISocket::getMetrics(void)
+{
+	t_socketMetrics	metrics = _counters.snapshot();
+	t_clientMetrics	client;
+
+	_mutex.lock();
+
+	metrics.clients = _clients.size();
+	for (auto it = _clients.begin(); it != _clients.end(); it++)
+	{
+		client = (*it)->getMetrics();
+		metrics.sendQueue += client.sendQueue;
+		if (client.rtt)
+			Histogram::add(metrics.rtt, client.rtt);
+	}
+
+	_mutex.unlock();
+	return (metrics);
+}
+
+void	ISocket::disconnect(IClient::handle handle)
+{
+	IClient	*client;
+
+	_mutex.lock();
+
+	client = getClient(handle);
+	if (!client)
+	{
+		_mutex.unlock();
+		throw (std::runtime_error("cannot disconnect client: invalid handle"));
+	}
+	try
+	{
+		disconnect(client);
+	}
+	catch (const std::exception &)
+	{
+		_mutex.unlock();
+		throw ;
+	}
+
+	_mutex.unlock();
+}
+
+void	ISocket::broadcast(const Message &message)
+{
+	_mutex.lock();
+
+	try
+	{
+		for (auto client = _clients.begin(); client != _clients.end(); client++)
+			send(*client, message);
+	}
+	catch (const std::exception &)
+	{
+		_mutex.unlock();
+		throw ;
+	}
+
+	_mutex.unlock();
+}
+
+//	serializes the object once into a message of its exact size
+void	ISocket::send(IClient *client, reflection::IReflectable &object)
+{
+	Message	message(object.size());
+
+	if (message.getSize())
+		object.write(&message[0]);
+	send(client, message);
+}
+
 bool	ISocket::isBind(void)
 {
 	bool	tmp;
@@ -140,6 +242,42 @@ void	*ISocket::getData(void)
 	return (tmp);
 }
 
+/*
+ *	with a task queue, client events are queued and their callbacks run on
+ *	the queue's workers instead of the polling thread. Events of a client run
+ *	in order, one at a time, and the client is only freed after its last
+ *	event ran. Must be set before the socket is used, the task queue must
+ *	outlive the socket.
+ */
+void	ISocket::setTaskQueue(TaskQueue *tasks)
+{
+	_mutex.lock();
+
+	_tasks = tasks;
+
+	_mutex.unlock();
+}
+
+//	the recorder sees every event of the socket until it's unset, it must outlive that
+void	ISocket::setRecorder(Recorder *recorder)
+{
+	_mutex.lock();
+
+	_recorder = recorder;
+
+	_mutex.unlock();
+}
+
+//	a conditioner is meant for a single socket, it must outlive its use
+void	ISocket::setLinkConditioner(LinkConditioner *conditioner)
+{
+	_mutex.lock();
+
+	_conditioner = conditioner;
+
+	_mutex.unlock();
+}
+
 void	ISocket::setClientAddCb(void(*callback)(ISocket &, IClient *))
 {
 	_mutex.lock();
@@ -211,3 +349,333 @@ void	ISocket::setSocketExceptionCb(void(*callback)(ISocket &))
 
 	_mutex.unlock();
 }
+
+void	ISocket::onClientAdd(IClient *client)
+{
+	_counters.clientsAdded.fetch_add(1, std::memory_order_relaxed);
+	if (_recorder)
+		_recorder->record(Recorder::CLIENT_ADD, client, Message());
+	dispatch(CLIENT_ADD, client, Message());
+}
+
+void	ISocket::onClientDel(IClient *client)
+{
+	_counters.clientsRemoved.fetch_add(1, std::memory_order_relaxed);
+	if (_recorder)
+		_recorder->record(Recorder::CLIENT_DEL, client, Message());
+	dispatch(CLIENT_DEL, client, Message());
+}
+
+void	ISocket::onClientException(IClient *client)
+{
+	_counters.clientExceptions.fetch_add(1, std::memory_order_relaxed);
+	dispatch(CLIENT_EXCEPTION, client, Message());
+}
+
+void	ISocket::onMessageSend(IClient *client, const Message &message)
+{
+	if (_recorder)
+		_recorder->record(Recorder::MESSAGE_SEND, client, message);
+	dispatch(MESSAGE_SEND, client, message);
+}
+
+void	ISocket::onMessageReceive(IClient *client, const Message &message)
+{
+	_counters.messagesReceived.fetch_add(1, std::memory_order_relaxed);
+	_counters.messageSize.record(message.getSize());
+	client->addReceived(1, 0);
+	if (_conditioner && _conditioner->condition(LinkConditioner::INBOUND, client->getHandle(), message))
+		return ;
+	deliver(client, message);
+}
+
+//	callback given to OutboundQueue::flush
+void	ISocket::messageSent(ISocket &socket, IClient *client, const Message &message)
+{
+	socket.onMessageSend(client, message);
+}
+
+/*
+ *	called with the client erased from _clients, returns true if the client
+ *	still has events queued, in which case it is destroyed after them
+ */
+bool	ISocket::deferRelease(IClient *client)
+{
+	t_clientEvents	*record;
+	auto			found = _events.find(client->getHandle());
+
+	if (found == _events.end())
+		return (false);
+	record = found->second;
+	record->mutex.lock();
+	record->released = true;
+	if (!record->scheduled)
+	{
+		record->scheduled = true;
+		record->mutex.unlock();
+		schedule(record);
+		return (true);
+	}
+	record->mutex.unlock();
+	return (true);
+}
+
+//	retries clients whose events couldn't be queued because the task queue was full
+void	ISocket::schedulePending(void)
+{
+	std::vector<t_clientEvents *>	pending;
+
+	_mutex.lock();
+
+	pending.swap(_pending);
+	for (auto record = pending.begin(); record != pending.end(); record++)
+		schedule(*record);
+
+	_mutex.unlock();
+}
+
+/*
+ *	waits for every queued event to run, called by the destructor of sockets.
+ *	Clients whose events never reached the task queue run them in this
+ *	thread, the wait gives up once the workers made no progress for
+ *	SOCKET_DRAIN_TIMEOUT ms
+ */
+void	ISocket::drainEvents(void)
+{
+	std::vector<t_clientEvents *>	pending;
+
+	_mutex.lock();
+
+	while (!_events.empty())
+	{
+		pending.swap(_pending);
+		if (_tasks || pending.empty())
+		{
+			for (auto record = pending.begin(); record != pending.end(); record++)
+				schedule(*record);
+			pending.clear();
+			if (_drained.wait_for(_mutex, std::chrono::milliseconds(SOCKET_DRAIN_TIMEOUT)) == std::cv_status::no_timeout)
+				continue ;
+			if (_pending.empty())
+			{
+				_log.error << "socket destroyed with events of " << _events.size() << " clients still queued" << std::endl;
+				break ;
+			}
+			pending.swap(_pending);
+		}
+		_mutex.unlock();
+		for (auto record = pending.begin(); record != pending.end(); record++)
+			run(*record);
+		pending.clear();
+		_mutex.lock();
+	}
+
+	_mutex.unlock();
+}
+
+//	outbound side of the conditioner, true if the message was taken and must not be sent now
+bool	ISocket::condition(IClient *client, const Message &message)
+{
+	return (_conditioner && _conditioner->condition(LinkConditioner::OUTBOUND, client->getHandle(), message));
+}
+
+/*
+ *	true if client is a live client of this socket, called with the client
+ *	table locked. A client of another socket or a released one can carry a
+ *	handle now owned by another client, so the pointer is compared too.
+ */
+bool	ISocket::owns(IClient *client)
+{
+	IClient	**found = client ? _clients.get(client->getHandle()) : nullptr;
+
+	return (found && *found == client);
+}
+
+/*
+ *	messages are counted when the socket takes them, bytes when they reach
+ *	or leave the wire, both are the same for transports without a send queue
+ */
+void	ISocket::countSent(IClient *client, uint64_t messages, uint64_t bytes)
+{
+	_counters.messagesSent.fetch_add(messages, std::memory_order_relaxed);
+	_counters.bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+	client->addSent(messages, bytes);
+}
+
+void	ISocket::countReceived(IClient *client, uint64_t bytes)
+{
+	_counters.bytesReceived.fetch_add(bytes, std::memory_order_relaxed);
+	client->addReceived(0, bytes);
+}
+
+void	ISocket::countDrop(IClient *client)
+{
+	_counters.sendDrops.fetch_add(1, std::memory_order_relaxed);
+	client->addDrop();
+}
+
+//	called at the end of pollEvent with the received counter read at its start
+void	ISocket::countBatch(uint64_t received)
+{
+	received = _counters.messagesReceived.load(std::memory_order_relaxed) - received;
+	if (received)
+		_counters.receiveBatch.record(received);
+}
+
+//	called by pollEvent, delivers and sends the messages the conditioner held until now
+void	ISocket::releaseConditioned(void)
+{
+	LinkConditioner::t_event	event;
+	IClient						*client;
+
+	_mutex.lock();
+
+	while (_conditioner && _conditioner->next(event))
+	{
+		client = getClient(event.handle);
+		if (!client)
+			continue ;
+		try
+		{
+			if (event.way == LinkConditioner::INBOUND)
+				deliver(client, event.message);
+			else
+				transmit(client, event.message);
+		}
+		catch (const std::exception &e)
+		{
+			_log.error << "cannot release conditioned message: " << e.what() << std::endl;
+		}
+	}
+
+	_mutex.unlock();
+}
+
+//	_timeout shortened so the poll returns when the next conditioned message is due
+Uint32	ISocket::pollTimeout(void)
+{
+	std::chrono::steady_clock::time_point	due;
+	std::chrono::steady_clock::duration		left;
+
+	if (!_conditioner || !_conditioner->nextDue(due))
+		return (_timeout);
+	left = due - std::chrono::steady_clock::now();
+	if (left <= std::chrono::steady_clock::duration::zero())
+		return (0);
+	//	rounded up, waking before the message is due would only poll again
+	return ((Uint32)std::min<int64_t>(_timeout, std::chrono::ceil<std::chrono::milliseconds>(left).count()));
+}
+
+void	ISocket::deliver(IClient *client, const Message &message)
+{
+	if (_recorder)
+		_recorder->record(Recorder::MESSAGE_RECEIVE, client, message);
+	dispatch(MESSAGE_RECEIVE, client, message);
+}
+
+void	ISocket::dispatch(eventType type, IClient *client, const Message &message)
+{
+	t_clientEvents	*record;
+	auto			found = _events.find(client->getHandle());
+
+	if (!_tasks && found == _events.end())
+		return (invoke(type, client, message));
+	if (found != _events.end())
+		record = found->second;
+	else
+	{
+		record = new t_clientEvents;
+		record->socket = this;
+		record->client = client;
+		record->scheduled = false;
+		record->released = false;
+		_events[client->getHandle()] = record;
+	}
+	record->mutex.lock();
+	record->events.push_back({type, message});
+	if (!record->scheduled)
+	{
+		record->scheduled = true;
+		record->mutex.unlock();
+		schedule(record);
+		return ;
+	}
+	record->mutex.unlock();
+}
+
+void	ISocket::invoke(eventType type, IClient *client, const Message &message)
+{
+	switch (type)
+	{
+		case CLIENT_ADD:
+			if (_clientAddCb)
+				_clientAddCb(*this, client);
+			break ;
+		case CLIENT_DEL:
+			if (_clientDelCb)
+				_clientDelCb(*this, client);
+			break ;
+		case CLIENT_EXCEPTION:
+			if (_clientExceptionCb)
+				_clientExceptionCb(*this, client);
+			break ;
+		case MESSAGE_SEND:
+			if (_messageSendCb)
+				_messageSendCb(*this, client, message);
+			break ;
+		case MESSAGE_RECEIVE:
+			if (_messageReceiveCb)
+				_messageReceiveCb(*this, client, message);
+			break ;
+	}
+}
+
+//	called with the mutex locked and the record marked as scheduled
+void	ISocket::schedule(t_clientEvents *record)
+{
+	if (!_tasks || !_tasks->tryAdd(Task(&ISocket::run, (void *)record)))
+		_pending.push_back(record);
+}
+
+//	worker side, runs the events of a client until none are left
+void	ISocket::run(void *data)
+{
+	t_clientEvents	*record = (t_clientEvents *)data;
+	ISocket			*socket = record->socket;
+	t_event			event;
+
+	while (1)
+	{
+		record->mutex.lock();
+		if (record->events.empty())
+		{
+			record->scheduled = false;
+			if (!record->released)
+			{
+				record->mutex.unlock();
+				return (socket->_drained.notify_all());
+			}
+			record->mutex.unlock();
+			break ;
+		}
+		event = std::move(record->events.front());
+		record->events.pop_front();
+		record->mutex.unlock();
+		try
+		{
+			socket->invoke(event.type, record->client, event.message);
+		}
+		catch (const std::exception &e)
+		{
+			_log.error << "socket event callback: " << e.what() << std::endl;
+		}
+	}
+	socket->_mutex.lock();
+
+	socket->_events.erase(record->client->getHandle());
+	socket->destroy(record->client);
+	socket->_drained.notify_all();
+
+	socket->_mutex.unlock();
+	delete record;
+}
@@ -0,0 +1,380 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/InterestManager.h"
+#include "World.h"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace	ExoEngine;
+using namespace	network;
+
+static bool	inRange(int32_t centerX, int32_t centerY, int32_t x, int32_t y, int32_t range)
+{
+	return (std::abs(x - centerX) <= range && std::abs(y - centerY) <= range);
+}
+
+template	<typename T>
+static void	unorderedRemove(std::vector<T> &vector, const T &value)
+{
+	auto	it = std::find(vector.begin(), vector.end(), value);
+
+	if (it == vector.end())
+		return ;
+	*it = vector.back();
+	vector.pop_back();
+}
+
+InterestManager::InterestManager(float cellSize, float viewRange) : _cellSize(cellSize), _stamp(0), _data(nullptr), _objectEnterCb(nullptr), _objectLeaveCb(nullptr)
+{
+	if (cellSize <= 0 || viewRange < 0)
+		throw (std::invalid_argument("interest grid needs a positive cell size and view range"));
+	_range = (int32_t)std::ceil(viewRange / cellSize);
+}
+
+InterestManager::~InterestManager(void)
+{
+}
+
+void	InterestManager::update(World &world)
+{
+	_mutex.lock();
+	world.lock();
+
+	_stamp++;
+	for (auto it = world.getObjects().begin(); it != world.getObjects().end(); it++)
+	{
+		const glm::vec2	&pos = it->second->getPos();
+		int32_t			x = cell(pos.x);
+		int32_t			y = cell(pos.y);
+		auto			object = _objects.find(it->first);
+
+		if (object == _objects.end())
+		{
+			t_cell	&target = _cells[key(x, y)];
+
+			_objects[it->first] = {x, y, pos, _stamp};
+			target.objects.push_back(it->first);
+			for (size_t i = 0; i < target.watchers.size(); i++)
+				enter(target.watchers[i], _clients[target.watchers[i]], it->first);
+			continue ;
+		}
+		object->second.pos = pos;
+		object->second.stamp = _stamp;
+		if (object->second.x != x || object->second.y != y)
+			moveObject(it->first, object->second, x, y);
+	}
+
+	world.unlock();
+
+	for (auto object = _objects.begin(); object != _objects.end(); )
+		if (object->second.stamp != _stamp)
+		{
+			removeObject(object->first, object->second);
+			object = _objects.erase(object);
+		}
+		else
+			object++;
+
+	for (auto client = _clients.begin(); client != _clients.end(); client++)
+		for (auto relevant = client->second.relevant.begin(); relevant != client->second.relevant.end(); relevant++)
+		{
+			const glm::vec2	&pos = _objects[relevant->first].pos;
+			float			distance = std::hypot(pos.x - client->second.center.x, pos.y - client->second.center.y);
+
+			relevant->second += 1 / (1 + distance / _cellSize);
+		}
+
+	_mutex.unlock();
+}
+
+void	InterestManager::setView(IClient::handle handle, const glm::vec2 &center)
+{
+	_mutex.lock();
+
+	t_client	&client = _clients[handle];
+	int32_t		x = cell(center.x);
+	int32_t		y = cell(center.y);
+
+	client.center = center;
+	if (client.hasView && client.x == x && client.y == y)
+		return (_mutex.unlock());
+	for (int32_t i = x - _range; i <= x + _range; i++)
+		for (int32_t j = y - _range; j <= y + _range; j++)
+		{
+			if (client.hasView && inRange(client.x, client.y, i, j, _range))
+				continue ;
+
+			t_cell	&target = _cells[key(i, j)];
+
+			target.watchers.push_back(handle);
+			for (size_t k = 0; k < target.objects.size(); k++)
+				enter(handle, client, target.objects[k]);
+		}
+	if (client.hasView)
+		for (int32_t i = client.x - _range; i <= client.x + _range; i++)
+			for (int32_t j = client.y - _range; j <= client.y + _range; j++)
+			{
+				if (inRange(x, y, i, j, _range))
+					continue ;
+
+				auto	target = _cells.find(key(i, j));
+
+				if (target == _cells.end())
+					continue ;
+				unorderedRemove(target->second.watchers, handle);
+				for (size_t k = 0; k < target->second.objects.size(); k++)
+					leave(handle, client, target->second.objects[k]);
+				if (target->second.objects.empty() && target->second.watchers.empty())
+					_cells.erase(target);
+			}
+	client.x = x;
+	client.y = y;
+	client.hasView = true;
+
+	_mutex.unlock();
+}
+
+void	InterestManager::remove(IClient::handle handle)
+{
+	_mutex.lock();
+
+	auto	client = _clients.find(handle);
+
+	if (client == _clients.end())
+		return (_mutex.unlock());
+	if (client->second.hasView)
+		for (int32_t i = client->second.x - _range; i <= client->second.x + _range; i++)
+			for (int32_t j = client->second.y - _range; j <= client->second.y + _range; j++)
+			{
+				auto	target = _cells.find(key(i, j));
+
+				if (target == _cells.end())
+					continue ;
+				unorderedRemove(target->second.watchers, handle);
+				if (target->second.objects.empty() && target->second.watchers.empty())
+					_cells.erase(target);
+			}
+	_clients.erase(client);
+
+	_mutex.unlock();
+}
+
+bool	InterestManager::isRelevant(IClient::handle handle, size_t object)
+{
+	bool	relevant = false;
+
+	_mutex.lock();
+
+	auto	client = _clients.find(handle);
+
+	if (client != _clients.end())
+		relevant = client->second.relevant.count(object);
+
+	_mutex.unlock();
+	return (relevant);
+}
+
+//	fills dst with at most max relevant objects, by decreasing priority
+size_t	InterestManager::getPriorities(IClient::handle handle, size_t max, std::vector<size_t> &dst)
+{
+	std::vector<std::pair<float, size_t>>	priorities;
+
+	dst.clear();
+
+	_mutex.lock();
+
+	auto	client = _clients.find(handle);
+
+	if (client == _clients.end())
+	{
+		_mutex.unlock();
+		return (0);
+	}
+	priorities.reserve(client->second.relevant.size());
+	for (auto relevant = client->second.relevant.begin(); relevant != client->second.relevant.end(); relevant++)
+		priorities.push_back(std::make_pair(relevant->second, relevant->first));
+
+	_mutex.unlock();
+
+	max = std::min(max, priorities.size());
+	std::partial_sort(priorities.begin(), priorities.begin() + max, priorities.end(),
+		[](const std::pair<float, size_t> &a, const std::pair<float, size_t> &b) { return (a.first > b.first); });
+	for (size_t i = 0; i < max; i++)
+		dst.push_back(priorities[i].second);
+	return (max);
+}
+
+void	InterestManager::resetPriority(IClient::handle handle, size_t object)
+{
+	_mutex.lock();
+
+	auto	client = _clients.find(handle);
+
+	if (client != _clients.end())
+	{
+		auto	relevant = client->second.relevant.find(object);
+
+		if (relevant != client->second.relevant.end())
+			relevant->second = 0;
+	}
+
+	_mutex.unlock();
+}
+
+//	keeps in dst only the objects of src relevant to the client
+void	InterestManager::filter(IClient::handle handle, const Snapshot &src, Snapshot &dst)
+{
+	std::vector<size_t>	ids;
+
+	dst.clear();
+	dst.setSequence(src.getSequence());
+
+	_mutex.lock();
+
+	auto	client = _clients.find(handle);
+
+	if (client != _clients.end())
+	{
+		ids.reserve(client->second.relevant.size());
+		for (auto relevant = client->second.relevant.begin(); relevant != client->second.relevant.end(); relevant++)
+			ids.push_back(relevant->first);
+	}
+
+	_mutex.unlock();
+
+	std::sort(ids.begin(), ids.end());
+	for (auto id = ids.begin(); id != ids.end(); id++)
+	{
+		const Snapshot::t_objectState	*state = src.find(*id);
+
+		if (state)
+			dst.add(*state);
+	}
+}
+
+void	InterestManager::attachData(void *data)
+{
+	_mutex.lock();
+
+	_data = data;
+
+	_mutex.unlock();
+}
+
+void	*InterestManager::getData(void)
+{
+	void	*tmp;
+
+	_mutex.lock();
+
+	tmp = _data;
+
+	_mutex.unlock();
+	return (tmp);
+}
+
+void	InterestManager::setObjectEnterCb(void(*callback)(InterestManager &, IClient::handle, size_t))
+{
+	_mutex.lock();
+
+	_objectEnterCb = callback;
+
+	_mutex.unlock();
+}
+
+void	InterestManager::setObjectLeaveCb(void(*callback)(InterestManager &, IClient::handle, size_t))
+{
+	_mutex.lock();
+
+	_objectLeaveCb = callback;
+
+	_mutex.unlock();
+}
+
+uint64_t	InterestManager::key(int32_t x, int32_t y)
+{
+	return (((uint64_t)(uint32_t)x << 32) | (uint32_t)y);
+}
+
+int32_t		InterestManager::cell(float position) const
+{
+	return ((int32_t)std::floor(position / _cellSize));
+}
+
+void	InterestManager::moveObject(size_t id, t_object &object, int32_t x, int32_t y)
+{
+	t_cell	&to = _cells[key(x, y)];
+	auto	from = _cells.find(key(object.x, object.y));
+
+	to.objects.push_back(id);
+	for (size_t i = 0; i < to.watchers.size(); i++)
+	{
+		t_client	&client = _clients[to.watchers[i]];
+
+		if (!inRange(client.x, client.y, object.x, object.y, _range))
+			enter(to.watchers[i], client, id);
+	}
+	if (from != _cells.end())
+	{
+		unorderedRemove(from->second.objects, id);
+		for (size_t i = 0; i < from->second.watchers.size(); i++)
+		{
+			t_client	&client = _clients[from->second.watchers[i]];
+
+			if (!inRange(client.x, client.y, x, y, _range))
+				leave(from->second.watchers[i], client, id);
+		}
+		if (from->second.objects.empty() && from->second.watchers.empty())
+			_cells.erase(from);
+	}
+	object.x = x;
+	object.y = y;
+}
+
+void	InterestManager::removeObject(size_t id, const t_object &object)
+{
+	auto	target = _cells.find(key(object.x, object.y));
+
+	if (target == _cells.end())
+		return ;
+	unorderedRemove(target->second.objects, id);
+	for (size_t i = 0; i < target->second.watchers.size(); i++)
+		leave(target->second.watchers[i], _clients[target->second.watchers[i]], id);
+	if (target->second.objects.empty() && target->second.watchers.empty())
+		_cells.erase(target);
+}
+
+void	InterestManager::enter(IClient::handle handle, t_client &client, size_t object)
+{
+	if (client.relevant.emplace(object, 0.0f).second && _objectEnterCb)
+		_objectEnterCb(*this, handle, object);
+}
+
+void	InterestManager::leave(IClient::handle handle, t_client &client, size_t object)
+{
+	if (client.relevant.erase(object) && _objectLeaveCb)
+		_objectLeaveCb(*this, handle, object);
+}
@@ -0,0 +1,220 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/Interpolator.h"
+#include "World.h"
+
+#include <math.h>
+#include <algorithm>
+
+using namespace	ExoEngine;
+using namespace	network;
+
+Interpolator::Interpolator(void) : _started(false), _lastTime(0), _lastLocal(0), _transit(0), _jitter(0),
+	_interval(0), _delay(INTERPOLATION_MIN_DELAY), _renderTime(0)
+{
+}
+
+Interpolator::~Interpolator(void)
+{
+}
+
+//	adds every object of a snapshot taken at time, in server seconds
+void	Interpolator::add(double time, const Snapshot &snapshot, timePoint now)
+{
+	for (auto state = snapshot.getObjects().begin(); state != snapshot.getObjects().end(); state++)
+		add(state->id, time, *state);
+	arrival(time, now);
+}
+
+//	states older than the newest one of the object are ignored
+void	Interpolator::add(size_t id, double time, const Snapshot::t_objectState &state)
+{
+	t_track	&track = _tracks[id];
+
+	if (track.count && track.ring[(track.next + INTERPOLATION_SAMPLES - 1) % INTERPOLATION_SAMPLES].time >= time)
+		return ;
+	track.ring[track.next] = {time, state.pos, state.speed, state.angle};
+	track.next = (track.next + 1) % INTERPOLATION_SAMPLES;
+	if (track.count < INTERPOLATION_SAMPLES)
+		track.count++;
+}
+
+//	measures the transit time, the jitter and the interval of a state taken at time arriving now
+void	Interpolator::arrival(double time, timePoint now)
+{
+	double	local;
+	double	transit;
+
+	if (!_started)
+	{
+		_epoch = now;
+		_started = true;
+		_transit = -time;
+		_lastTime = time;
+		_renderTime = time - _delay;
+		return ;
+	}
+	local = std::chrono::duration<double>(now - _epoch).count();
+	if (time <= _lastTime)
+		return ;
+	transit = local - time;
+	_jitter += (fabs(transit - (_lastLocal - _lastTime)) - _jitter) / 16;
+	_interval = _interval ? _interval + (time - _lastTime - _interval) / 16 : time - _lastTime;
+	//	the transit follows its lows quickly and its highs slowly, late states are the jitter's part
+	_transit = transit < _transit ? transit : _transit + (transit - _transit) / 64;
+	_lastTime = time;
+	_lastLocal = local;
+}
+
+void	Interpolator::remove(size_t id)
+{
+	_tracks.erase(id);
+}
+
+void	Interpolator::clear(void)
+{
+	_tracks.clear();
+	_started = false;
+	_jitter = 0;
+	_interval = 0;
+	_delay = INTERPOLATION_MIN_DELAY;
+}
+
+//	moves the playout delay towards its target and returns the server time to render
+double	Interpolator::update(timePoint now)
+{
+	double	local;
+	double	target;
+	double	elapsed;
+	double	render;
+
+	if (!_started)
+		return (0);
+	local = std::chrono::duration<double>(now - _epoch).count();
+	target = std::min(std::max(_interval + INTERPOLATION_JITTER_FACTOR * _jitter, (double)INTERPOLATION_MIN_DELAY), (double)INTERPOLATION_MAX_DELAY);
+	render = local - _transit - _delay;
+	elapsed = std::max(render - _renderTime, 0.0);
+	if (target > _delay)
+		_delay = std::min(target, _delay + elapsed * INTERPOLATION_DELAY_SLEW);
+	else
+		_delay = std::max(target, _delay - elapsed * INTERPOLATION_DELAY_SLEW);
+	//	the playout never goes back in time
+	_renderTime = std::max(local - _transit - _delay, _renderTime);
+	return (_renderTime);
+}
+
+bool	Interpolator::sample(size_t id, t_sample &dst) const
+{
+	return (sample(id, _renderTime, dst));
+}
+
+/*
+ *	state of an object at time, between the two states around it, the
+ *	oldest one before the first and extrapolated after the last
+ */
+bool	Interpolator::sample(size_t id, double time, t_sample &dst) const
+{
+	auto			found = _tracks.find(id);
+	const t_sample	*before;
+	const t_sample	*after;
+	double			ratio;
+
+	if (found == _tracks.end() || !found->second.count)
+		return (false);
+
+	const t_track	&track = found->second;
+	size_t			first = (track.next + INTERPOLATION_SAMPLES - track.count) % INTERPOLATION_SAMPLES;
+
+	after = &track.ring[(track.next + INTERPOLATION_SAMPLES - 1) % INTERPOLATION_SAMPLES];
+	if (time >= after->time)
+	{
+		double	ahead = std::min(time - after->time, (double)INTERPOLATION_MAX_EXTRAPOLATION);
+
+		dst = *after;
+		dst.pos += after->speed * (float)ahead;
+		dst.time = time;
+		return (true);
+	}
+	before = &track.ring[first];
+	if (time <= before->time)
+	{
+		dst = *before;
+		return (true);
+	}
+	//	newest first, the render time is usually a couple of states behind
+	for (size_t i = track.count - 1; i > 0; i--)
+	{
+		before = &track.ring[(first + i - 1) % INTERPOLATION_SAMPLES];
+		after = &track.ring[(first + i) % INTERPOLATION_SAMPLES];
+		if (before->time <= time)
+			break ;
+	}
+	ratio = (time - before->time) / (after->time - before->time);
+	dst.time = time;
+	dst.pos = before->pos + (after->pos - before->pos) * (float)ratio;
+	dst.speed = before->speed + (after->speed - before->speed) * (float)ratio;
+	dst.angle = before->angle + (after->angle - before->angle) * (float)ratio;
+	return (true);
+}
+
+//	moves the objects of the world to their state at the render time
+void	Interpolator::apply(World &world) const
+{
+	t_sample	state;
+
+	world.lock();
+
+	for (auto track = _tracks.begin(); track != _tracks.end(); track++)
+	{
+		auto	object = world.getObjects().find(track->first);
+
+		if (object == world.getObjects().end() || !sample(track->first, _renderTime, state))
+			continue ;
+		object->second->setPos(state.pos);
+		object->second->setAngle(state.angle);
+	}
+
+	world.unlock();
+}
+
+double	Interpolator::getRenderTime(void) const
+{
+	return (_renderTime);
+}
+
+double	Interpolator::getDelay(void) const
+{
+	return (_delay);
+}
+
+double	Interpolator::getJitter(void) const
+{
+	return (_jitter);
+}
+
+double	Interpolator::getInterval(void) const
+{
+	return (_interval);
+}
@@ -0,0 +1,259 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/LagCompensation.h"
+#include "World.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/ext.hpp>
+
+using namespace	ExoEngine;
+using namespace	network;
+
+LagCompensation::LagCompensation(void) : _next(0), _count(0)
+{
+}
+
+LagCompensation::~LagCompensation(void)
+{
+}
+
+//	stores the poses of the world objects at time, once per tick after the physics
+void	LagCompensation::record(World &world, double time)
+{
+	_mutex.lock();
+
+	t_frame	&frame = _frames[_next];
+
+	frame.time = time;
+	frame.ids.clear();
+	frame.x.clear();
+	frame.y.clear();
+	frame.angle.clear();
+	frame.width.clear();
+	frame.height.clear();
+	try
+	{
+		world.lock();
+		for (auto object = world.getObjects().begin(); object != world.getObjects().end() && frame.ids.size() < LAG_COMPENSATION_MAX_OBJECTS; object++)
+		{
+			frame.ids.push_back(object->first);
+			frame.x.push_back(object->second->getPos().x);
+			frame.y.push_back(object->second->getPos().y);
+			frame.angle.push_back(object->second->getAngle());
+			frame.width.push_back(object->second->getScale().x);
+			frame.height.push_back(object->second->getScale().y);
+		}
+		world.unlock();
+	}
+	catch (const std::exception &)
+	{
+		world.unlock();
+		_mutex.unlock();
+		throw ;
+	}
+	_next = (_next + 1) % LAG_COMPENSATION_TICKS;
+	if (_count < LAG_COMPENSATION_TICKS)
+		_count++;
+
+	_mutex.unlock();
+}
+
+void	LagCompensation::clear(void)
+{
+	_mutex.lock();
+	_next = 0;
+	_count = 0;
+	_mutex.unlock();
+}
+
+//	index of id in a frame, or its size when missing
+size_t	LagCompensation::find(const t_frame &frame, size_t id)
+{
+	auto	found = std::lower_bound(frame.ids.begin(), frame.ids.end(), id);
+
+	if (found == frame.ids.end() || *found != id)
+		return (frame.ids.size());
+	return (found - frame.ids.begin());
+}
+
+void	LagCompensation::get(const t_frame &frame, size_t index, t_pose &dst)
+{
+	dst.pos = glm::vec2(frame.x[index], frame.y[index]);
+	dst.scale = glm::vec2(frame.width[index], frame.height[index]);
+	dst.angle = frame.angle[index];
+}
+
+void	LagCompensation::blend(t_pose &dst, const t_pose &next, double ratio)
+{
+	dst.pos += (next.pos - dst.pos) * (float)ratio;
+	dst.scale += (next.scale - dst.scale) * (float)ratio;
+	dst.angle += std::remainder(next.angle - dst.angle, glm::pi<double>()) * ratio;
+}
+
+//	the two frames around time and the ratio between them, called with the mutex held and a frame recorded
+double	LagCompensation::locate(double time, const t_frame *&before, const t_frame *&after)
+{
+	size_t	newest = (_next + LAG_COMPENSATION_TICKS - 1) % LAG_COMPENSATION_TICKS;
+	size_t	oldest = (_next + LAG_COMPENSATION_TICKS - _count) % LAG_COMPENSATION_TICKS;
+
+	before = &_frames[newest];
+	after = before;
+	if (time >= before->time)
+		return (0);
+	if (time <= _frames[oldest].time)
+	{
+		before = &_frames[oldest];
+		after = before;
+		return (0);
+	}
+	//	binary search of the last frame at or before time, from the oldest one
+	size_t	low = 0;
+	size_t	high = _count - 1;
+
+	while (high - low > 1)
+	{
+		size_t	middle = (low + high) / 2;
+
+		if (_frames[(oldest + middle) % LAG_COMPENSATION_TICKS].time <= time)
+			low = middle;
+		else
+			high = middle;
+	}
+	before = &_frames[(oldest + low) % LAG_COMPENSATION_TICKS];
+	after = &_frames[(oldest + high) % LAG_COMPENSATION_TICKS];
+	return ((time - before->time) / (after->time - before->time));
+}
+
+//	an object missing from one of the frames takes its pose in the other one
+bool	LagCompensation::pose(const t_frame *before, const t_frame *after, double ratio, size_t id, t_pose &dst)
+{
+	size_t	a = find(*before, id);
+	size_t	b = find(*after, id);
+	t_pose	next;
+
+	if (a == before->ids.size() && b == after->ids.size())
+		return (false);
+	if (a == before->ids.size() || b == after->ids.size())
+	{
+		get(a == before->ids.size() ? *after : *before, a == before->ids.size() ? b : a, dst);
+		return (true);
+	}
+	get(*before, a, dst);
+	get(*after, b, next);
+	blend(dst, next, ratio);
+	return (true);
+}
+
+bool	LagCompensation::pose(size_t id, double time, t_pose &dst)
+{
+	const t_frame	*before;
+	const t_frame	*after;
+	bool			found = false;
+
+	_mutex.lock();
+	if (_count)
+		found = pose(before, after, locate(time, before, after), id, dst);
+	_mutex.unlock();
+	return (found);
+}
+
+//	Object::collide against the pose of an object at time
+bool	LagCompensation::collide(size_t id, double time, const glm::vec2 &point)
+{
+	t_pose	rewound;
+
+	if (!pose(id, time, rewound))
+		return (false);
+	return (Object::collide(rewound.pos, rewound.scale, rewound.angle, point));
+}
+
+//	fills hits with the ids of every object containing point at time, returns how many
+size_t	LagCompensation::collide(double time, const glm::vec2 &point, std::vector<size_t> &hits)
+{
+	const t_frame	*before;
+	const t_frame	*after;
+	double			ratio;
+	t_pose			rewound;
+	t_pose			next;
+
+	hits.clear();
+	_mutex.lock();
+	if (!_count)
+	{
+		_mutex.unlock();
+		return (0);
+	}
+	ratio = locate(time, before, after);
+	//	both frames are sorted by id, they are merged so an object in only one of them takes its pose there
+	for (size_t i = 0, j = 0; i < before->ids.size() || j < after->ids.size(); )
+	{
+		size_t	id;
+
+		if (j == after->ids.size() || (i < before->ids.size() && before->ids[i] < after->ids[j]))
+		{
+			id = before->ids[i];
+			get(*before, i++, rewound);
+		}
+		else if (i == before->ids.size() || after->ids[j] < before->ids[i])
+		{
+			id = after->ids[j];
+			get(*after, j++, rewound);
+		}
+		else
+		{
+			id = before->ids[i];
+			get(*before, i++, rewound);
+			get(*after, j++, next);
+			blend(rewound, next, ratio);
+		}
+		if (Object::collide(rewound.pos, rewound.scale, rewound.angle, point))
+			hits.push_back(id);
+	}
+	_mutex.unlock();
+	return (hits.size());
+}
+
+double	LagCompensation::getOldest(void)
+{
+	double	time = 0;
+
+	_mutex.lock();
+	if (_count)
+		time = _frames[(_next + LAG_COMPENSATION_TICKS - _count) % LAG_COMPENSATION_TICKS].time;
+	_mutex.unlock();
+	return (time);
+}
+
+double	LagCompensation::getNewest(void)
+{
+	double	time = 0;
+
+	_mutex.lock();
+	if (_count)
+		time = _frames[(_next + LAG_COMPENSATION_TICKS - 1) % LAG_COMPENSATION_TICKS].time;
+	_mutex.unlock();
+	return (time);
+}
@@ -0,0 +1,198 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/LinkConditioner.h"
+
+#include <string.h>
+
+using namespace	ExoEngine;
+using namespace	network;
+
+static bool	neutral(const t_linkProfile &profile)
+{
+	return (!profile.latency && !profile.jitter && profile.loss <= 0 && profile.duplicate <= 0 && profile.reorder <= 0 && !profile.bandwidth);
+}
+
+LinkConditioner::LinkConditioner(uint32_t seed) : _random(seed), _order(0)
+{
+	for (size_t i = 0; i < 2; i++)
+	{
+		memset(&_links[i].profile, 0, sizeof(_links[i].profile));
+		memset(&_links[i].stats, 0, sizeof(_links[i].stats));
+	}
+}
+
+LinkConditioner::~LinkConditioner(void)
+{
+}
+
+void	LinkConditioner::setProfile(const t_linkProfile &profile)
+{
+	setProfile(INBOUND, profile);
+	setProfile(OUTBOUND, profile);
+}
+
+void	LinkConditioner::setProfile(direction way, const t_linkProfile &profile)
+{
+	if (profile.loss > 1 || profile.duplicate > 1 || profile.reorder > 1)
+		throw (std::invalid_argument("link probabilities cannot be greater than 1"));
+	_mutex.lock();
+
+	_links[way].profile = profile;
+
+	_mutex.unlock();
+}
+
+t_linkProfile	LinkConditioner::getProfile(direction way)
+{
+	t_linkProfile	profile;
+
+	_mutex.lock();
+
+	profile = _links[way].profile;
+
+	_mutex.unlock();
+	return (profile);
+}
+
+t_linkStats	LinkConditioner::getStats(direction way)
+{
+	t_linkStats	stats;
+
+	_mutex.lock();
+
+	stats = _links[way].stats;
+
+	_mutex.unlock();
+	return (stats);
+}
+
+/*
+ *	returns false if the link is perfect and the message should go through
+ *	now, true if the conditioner took the message, dropped or queued
+ */
+bool	LinkConditioner::condition(direction way, IClient::handle handle, const Message &message)
+{
+	std::chrono::steady_clock::time_point	now = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point	departure = now;
+	t_link									&link = _links[way];
+
+	_mutex.lock();
+
+	if (neutral(link.profile))
+	{
+		_mutex.unlock();
+		return (false);
+	}
+	if (link.profile.loss > 0 && random() < link.profile.loss)
+	{
+		link.stats.dropped++;
+		_mutex.unlock();
+		return (true);
+	}
+	//	token bucket: the link is busy until free, an idle link saves up to burst bytes
+	if (link.profile.bandwidth)
+	{
+		link.free = std::max(link.free, now - std::chrono::microseconds(link.profile.burst * 1000000 / link.profile.bandwidth));
+		link.free += std::chrono::microseconds(message.getSize() * 1000000 / link.profile.bandwidth);
+		departure = std::max(now, link.free);
+	}
+	try
+	{
+		push(link, way, handle, message, departure);
+		if (link.profile.duplicate > 0 && random() < link.profile.duplicate)
+		{
+			push(link, way, handle, message, departure);
+			link.stats.duplicated++;
+		}
+	}
+	catch (const std::exception &)
+	{
+		_mutex.unlock();
+		throw ;
+	}
+	link.stats.passed++;
+	link.stats.bytes += message.getSize();
+
+	_mutex.unlock();
+	return (true);
+}
+
+//	pops the next event whose time has come, false if there is none
+bool	LinkConditioner::next(t_event &event)
+{
+	_mutex.lock();
+
+	if (_events.empty() || _events.top().time > std::chrono::steady_clock::now())
+	{
+		_mutex.unlock();
+		return (false);
+	}
+	//	the top is moved out right before being popped
+	event = std::move(const_cast<t_event &>(_events.top()));
+	_events.pop();
+
+	_mutex.unlock();
+	return (true);
+}
+
+//	time the next held message is due, false if none is held
+bool	LinkConditioner::nextDue(std::chrono::steady_clock::time_point &time)
+{
+	_mutex.lock();
+
+	if (_events.empty())
+	{
+		_mutex.unlock();
+		return (false);
+	}
+	time = _events.top().time;
+
+	_mutex.unlock();
+	return (true);
+}
+
+double	LinkConditioner::random(void)
+{
+	return (_random() / 4294967296.0);
+}
+
+//	called with the mutex locked
+void	LinkConditioner::push(t_link &link, direction way, IClient::handle handle, const Message &message, std::chrono::steady_clock::time_point time)
+{
+	time += std::chrono::milliseconds(link.profile.latency);
+	if (link.profile.jitter)
+		time += std::chrono::microseconds((int64_t)(link.profile.jitter * 1000 * random()));
+	if (link.profile.reorder > 0 && random() < link.profile.reorder)
+	{
+		time += std::chrono::milliseconds(link.profile.reorderDelay);
+		link.stats.reordered++;
+	}
+	else
+	{
+		time = std::max(time, link.last);
+		link.last = time;
+	}
+	_events.push({time, _order++, way, handle, message});
+}
@@ -0,0 +1,141 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/LoopbackClient.h"
+
+using namespace	ExoEngine;
+using namespace	network;
+
+LoopbackClient::LoopbackClient(const std::shared_ptr<t_loopbackPipe> &pipe, uint8_t end) : _pipe(pipe), _end(end & 1), _socket(nullptr)
+{
+}
+
+LoopbackClient::~LoopbackClient(void)
+{
+	close();
+}
+
+const IPaddress	&LoopbackClient::getAddress(void) const
+{
+	return (_pipe->addresses[_end]);
+}
+
+std::string		LoopbackClient::getStrAddress(void) const
+{
+	std::string	str;
+	Uint32		address = _pipe->addresses[_end].host;
+
+	for (size_t i = 0; i < sizeof(address); i++)
+		if (!i)
+			str.append(std::to_string((Uint32)((Uint8 *)&address)[i] & 0xff));
+		else
+			str.append(".").append(std::to_string((Uint32)((Uint8 *)&address)[i] & 0xff));
+	return (str);
+}
+
+std::string		LoopbackClient::getStrPort(void) const
+{
+	return (std::to_string(SDLNet_Read16(&_pipe->addresses[_end].port)));
+}
+
+std::string		LoopbackClient::getHost(void) const
+{
+	return ("localhost");
+}
+
+//	loopback clients have no SDL socket, the returned socket is always null
+SDLNet_GenericSocket	&LoopbackClient::getSocket(void)
+{
+	return (_socket);
+}
+
+void	LoopbackClient::updateAddress(const IPaddress &address)
+{
+	_pipe->addresses[_end] = address;
+}
+
+//	false if the peer ring is full or the peer left, message is moved only on success
+bool	LoopbackClient::write(Message &&message)
+{
+	uint8_t	peer = !_end;
+	bool	ret;
+
+	if (_pipe->closed[peer] || _pipe->closed[_end])
+		return (false);
+	_pipe->writers[peer].lock();
+	ret = _pipe->rings[peer].push(std::move(message));
+	_pipe->writers[peer].unlock();
+	if (ret)
+		ring();
+	return (ret);
+}
+
+bool	LoopbackClient::write(const Message &message)
+{
+	uint8_t	peer = !_end;
+	bool	ret;
+
+	if (_pipe->closed[peer] || _pipe->closed[_end])
+		return (false);
+	_pipe->writers[peer].lock();
+	ret = _pipe->rings[peer].push(message);
+	_pipe->writers[peer].unlock();
+	if (ret)
+		ring();
+	return (ret);
+}
+
+//	must only be called by the thread polling the socket owning this end
+bool	LoopbackClient::read(Message &message)
+{
+	return (_pipe->rings[_end].pop(message));
+}
+
+void	LoopbackClient::close(void)
+{
+	if (!_pipe->closed[_end].exchange(true))
+		ring();
+}
+
+bool	LoopbackClient::isClosed(void) const
+{
+	return (_pipe->closed[!_end]);
+}
+
+void	LoopbackClient::ring(void)
+{
+	if (_pipe->doorbells[!_end])
+		_pipe->doorbells[!_end]->ring();
+}
+
+bool	LoopbackClient::operator==(const IPaddress &address) const
+{
+	return ((SDLNet_Read32(&address.host) == SDLNet_Read32(&_pipe->addresses[_end].host) &&
+			SDLNet_Read16(&address.port) == SDLNet_Read16(&_pipe->addresses[_end].port)));
+}
+
+bool	LoopbackClient::operator==(const IClient &client) const
+{
+	return (this == &client);
+}
@@ -0,0 +1,425 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/LoopbackSocket.h"
+#include "Reflectable.h"
+#include "Log.h"
+
+#include <chrono>
+
+//	first port given to the accepted end of a loopback connection
+#define LOOPBACK_EPHEMERAL_PORT		49152
+#define LOOPBACK_EPHEMERAL_RANGE	16384
+
+using namespace	ExoEngine;
+using namespace	network;
+
+std::mutex										LoopbackSocket::_registryMutex;
+std::unordered_map<uint16_t, LoopbackSocket *>	LoopbackSocket::_registry;
+std::atomic<uint32_t>							LoopbackSocket::_ephemeral(0);
+
+static void	setAddress(IPaddress &address, uint16_t port)
+{
+	SDLNet_Write32(0x7f000001, &address.host);
+	SDLNet_Write16(port, &address.port);
+}
+
+LoopbackSocket::LoopbackSocket(size_t size, size_t capacity) : ISocket(size), _capacity(capacity), _doorbell(std::make_shared<t_loopbackDoorbell>())
+{
+	if (!capacity)
+		throw (std::invalid_argument("loopback socket cannot have a null ring capacity"));
+	_doorbell->rung = false;
+}
+
+LoopbackSocket::~LoopbackSocket(void)
+{
+	_mutex.lock();
+
+	if (_binded)
+		unbind();
+	for (size_t i = _clients.size(); i-- > 0; )
+		disconnect(_clients[i]);
+
+	_mutex.unlock();
+	drainEvents();
+}
+
+void	LoopbackSocket::bind(uint16_t port)
+{
+	_mutex.lock();
+
+	if (isBind())
+	{
+		_mutex.unlock();
+		throw (std::runtime_error(std::string("cannot bind socket to ").append(std::to_string(port)).append(": socket already bind")));
+	}
+	_registryMutex.lock();
+	if (!_registry.emplace(port, this).second)
+	{
+		_registryMutex.unlock();
+		_mutex.unlock();
+		throw (std::runtime_error(std::string("cannot bind socket to ").append(std::to_string(port)).append(": port already in use")));
+	}
+	_registryMutex.unlock();
+	_binded = true;
+	_port = port;
+	if (_socketBindCb)
+		_socketBindCb(*this, port);
+
+	_mutex.unlock();
+}
+
+void	LoopbackSocket::bind(const std::string &port)
+{
+	size_t	tmp;
+
+	tmp = std::stoul(port);
+	if (tmp > 0xffff)
+		throw (std::runtime_error(std::string("cannot bind socket to ").append(port).append(": port greater than 65535")));
+	bind((uint16_t)tmp);
+}
+
+void	LoopbackSocket::unbind(void)
+{
+	std::shared_ptr<t_loopbackPipe>	pipe;
+
+	_mutex.lock();
+
+	if (!_binded)
+	{
+		_mutex.unlock();
+		throw (std::runtime_error("cannot unbind when server isn't bind"));
+	}
+	_registryMutex.lock();
+	_registry.erase(_port);
+	_registryMutex.unlock();
+	//	connections not adopted yet are refused
+	while (_incoming.pop(pipe))
+		LoopbackClient(pipe, 1).close();
+	_binded = false;
+	if (_socketUnbindCb)
+		_socketUnbindCb(*this, _port);
+
+	_mutex.unlock();
+}
+
+void	LoopbackSocket::connect(const std::string &address, const std::string &port)
+{
+	size_t		tmp;
+
+	tmp = std::stoul(port);
+	if (tmp > 0xffff)
+		throw (std::runtime_error(std::string("cannot connect socket to ").append(address).append(":").append(std::to_string(tmp)).append(": port greater than 65535")));
+	connect(address, (uint16_t)tmp);
+}
+
+void	LoopbackSocket::connect(const std::string &address, uint16_t port)
+{
+	std::shared_ptr<t_loopbackPipe>	pipe;
+	LoopbackSocket					*listener;
+	LoopbackClient					*newClient;
+
+	_mutex.lock();
+	_registryMutex.lock();
+
+	auto	found = _registry.find(port);
+
+	if (found == _registry.end())
+	{
+		_registryMutex.unlock();
+		_mutex.unlock();
+		throw (std::runtime_error(std::string("cannot connect socket to ").append(address).append(":").append(std::to_string(port)).append(": connection refused")));
+	}
+	listener = found->second;
+	try
+	{
+		pipe = std::make_shared<t_loopbackPipe>(_capacity);
+		pipe->doorbells[0] = _doorbell;
+		pipe->doorbells[1] = listener->_doorbell;
+		setAddress(pipe->addresses[0], port);
+		setAddress(pipe->addresses[1], LOOPBACK_EPHEMERAL_PORT + _ephemeral++ % LOOPBACK_EPHEMERAL_RANGE);
+		newClient = _pool.create(pipe, 0);
+		newClient->setHandle(_clients.insert(newClient));
+	}
+	catch (const std::exception &)
+	{
+		_registryMutex.unlock();
+		_mutex.unlock();
+		throw ;
+	}
+	listener->_incoming.push(pipe);
+	listener->_doorbell->ring();
+	_registryMutex.unlock();
+	onClientAdd(newClient);
+
+	_mutex.unlock();
+}
+
+void	LoopbackSocket::disconnect(IClient *client)
+{
+	_mutex.lock();
+
+	if (owns(client))
+	{
+		dynamic_cast<LoopbackClient *>(client)->close();
+		onClientDel(client);
+		release(client);
+	}
+
+	_mutex.unlock();
+}
+
+/*
+ *	the mutex is released while waiting so other threads can still connect
+ *	and send, a peer writing to one of our rings wakes the wait up
+ */
+void	LoopbackSocket::pollEvent(uint8_t mask)
+{
+	std::unique_lock<std::mutex>	lock(_doorbell->mutex, std::defer_lock);
+	Uint32							timeout;
+	bool							ret;
+
+	_mutex.lock();
+
+	(void)mask;
+	schedulePending();
+	releaseConditioned();
+	if (!_binded && !_clients.size())
+		return (_mutex.unlock());
+	try
+	{
+		ret = process();
+	}
+	catch (const std::exception &)
+	{
+		_mutex.unlock();
+		throw ;
+	}
+	timeout = pollTimeout();
+	_mutex.unlock();
+	if (ret || !timeout)
+		return ;
+	lock.lock();
+	if (!_doorbell->cond.wait_for(lock, std::chrono::milliseconds(timeout), [this] { return (_doorbell->rung); }))
+		return ;
+	lock.unlock();
+	_mutex.lock();
+
+	try
+	{
+		process();
+	}
+	catch (const std::exception &)
+	{
+		_mutex.unlock();
+		throw ;
+	}
+
+	_mutex.unlock();
+}
+
+/*
+ *	the message is copied once into the peer ring, the mutex only keeps
+ *	pollEvent from releasing the client meanwhile: it isn't held while
+ *	pollEvent waits
+ */
+void	LoopbackSocket::send(IClient *client, const Message &message)
+{
+	if (!client)
+	{
+		_log.error << __FUNCTION__ << " client NULL" << std::endl;
+		return ;
+	}
+	_mutex.lock();
+	try
+	{
+		if (!owns(client))
+			_log.debug << __FUNCTION__ << " client already disconnected, message dropped" << std::endl;
+		else if (!condition(client, message))
+			transmit(client, message);
+	}
+	catch (const std::exception &)
+	{
+		_mutex.unlock();
+		throw ;
+	}
+	_mutex.unlock();
+}
+
+//	moves the message into the peer ring, its payload is never copied
+void	LoopbackSocket::send(IClient *client, Message &&message)
+{
+	LoopbackClient	*loopback = dynamic_cast<LoopbackClient *>(client);
+	size_t			size = message.getSize();
+
+	if (!loopback || _messageSendCb || _recorder || _conditioner)
+		return (send(client, (const Message &)message));
+	_mutex.lock();
+	try
+	{
+		if (!owns(client))
+			_log.debug << __FUNCTION__ << " client already disconnected, message dropped" << std::endl;
+		else if (!loopback->write(std::move(message)))
+			failed(loopback);
+		else
+			countSent(client, 1, size);
+	}
+	catch (const std::exception &)
+	{
+		_mutex.unlock();
+		throw ;
+	}
+	_mutex.unlock();
+}
+
+//	the object is serialized once, its message is moved into the peer ring
+void	LoopbackSocket::send(IClient *client, reflection::IReflectable &object)
+{
+	Message	message(object.size());
+
+	if (message.getSize())
+		object.write(&message[0]);
+	send(client, std::move(message));
+}
+
+void	LoopbackSocket::transmit(IClient *client, const Message &message)
+{
+	LoopbackClient	*loopback = dynamic_cast<LoopbackClient *>(client);
+
+	if (!loopback->write(message))
+		return (failed(loopback));
+	countSent(client, 1, message.getSize());
+	if (_messageSendCb || _recorder)
+		onMessageSend(client, message);
+}
+
+SDLNet_GenericSocket	LoopbackSocket::getSocket(void)
+{
+	return (nullptr);
+}
+
+//	a message the peer ring refused, dropped if the peer left
+void	LoopbackSocket::failed(LoopbackClient *client)
+{
+	if (client->isClosed())
+	{
+		countDrop(client);
+		_log.debug << "peer of " << client->getStrAddress() << ":" << client->getStrPort() << " left, message dropped" << std::endl;
+		return ;
+	}
+	_counters.sendErrors.fetch_add(1, std::memory_order_relaxed);
+	throw (std::runtime_error(std::string("cannot send to ").append(client->getStrAddress()).append(":").append(client->getStrPort()).append(": loopback ring full")));
+}
+
+ISocket::type	LoopbackSocket::getType(void) const
+{
+	return (LOOPBACK);
+}
+
+/*
+ *	called with the mutex locked, adopts the pending connections and reads
+ *	every client ring, returns true if anything happened
+ */
+bool	LoopbackSocket::process(void)
+{
+	std::shared_ptr<t_loopbackPipe>	pipe;
+	Message							message;
+	bool							ret = false;
+	uint64_t						received = _counters.messagesReceived.load(std::memory_order_relaxed);
+
+	_doorbell->mutex.lock();
+	_doorbell->rung = false;
+	_doorbell->mutex.unlock();
+	while (_incoming.pop(pipe))
+	{
+		adopt(pipe);
+		ret = true;
+	}
+	//	a client removed by a callback is replaced by the last one, see TcpSocket::pollEvent
+	for (size_t i = 0; i < _clients.size(); )
+	{
+		LoopbackClient	*client = dynamic_cast<LoopbackClient *>(_clients[i]);
+		IClient::handle	handle = client->getHandle();
+		bool			closed = client->isClosed();
+		bool			drained = false;
+
+		//	at most one ring worth of messages per poll so a chatty peer can't starve the others
+		for (size_t n = 0; n < _capacity; n++)
+		{
+			if (!client->read(message))
+			{
+				drained = true;
+				break ;
+			}
+			ret = true;
+			countReceived(client, message.getSize());
+			onMessageReceive(client, message);
+			if (!_clients.contains(handle))
+				break ;
+		}
+		if (!_clients.contains(handle))
+			continue ;
+		if (closed && drained)
+		{
+			client->close();
+			onClientDel(client);
+			release(client);
+			ret = true;
+			continue ;
+		}
+		i++;
+	}
+	countBatch(received);
+	return (ret);
+}
+
+void	LoopbackSocket::adopt(const std::shared_ptr<t_loopbackPipe> &pipe)
+{
+	LoopbackClient	*newClient;
+
+	try
+	{
+		newClient = _pool.create(pipe, 1);
+		newClient->setHandle(_clients.insert(newClient));
+	}
+	catch (const std::exception &e)
+	{
+		LoopbackClient(pipe, 1).close();
+		_log.error << "cannot adopt loopback client: " << e.what() << std::endl;
+		return ;
+	}
+	onClientAdd(newClient);
+}
+
+void	LoopbackSocket::release(IClient *client)
+{
+	_clients.erase(client->getHandle());
+	if (!deferRelease(client))
+		destroy(client);
+}
+
+void	LoopbackSocket::destroy(IClient *client)
+{
+	_pool.destroy(dynamic_cast<LoopbackClient *>(client));
+}
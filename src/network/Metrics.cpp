@@ -0,0 +1,160 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/Metrics.h"
+
+#include <string.h>
+#include <algorithm>
+
+using namespace	ExoEngine;
+using namespace	network;
+
+static size_t	bucket(uint64_t value)
+{
+	size_t	index = 0;
+
+	while (value && index < METRICS_HISTOGRAM_BUCKETS - 1)
+	{
+		value >>= 1;
+		index++;
+	}
+	return (index);
+}
+
+Histogram::Histogram(void) : _count(0), _sum(0), _max(0)
+{
+	for (size_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++)
+		_buckets[i] = 0;
+}
+
+Histogram::~Histogram(void)
+{
+}
+
+void	Histogram::record(uint64_t value)
+{
+	uint64_t	max = _max.load(std::memory_order_relaxed);
+
+	_buckets[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+	_count.fetch_add(1, std::memory_order_relaxed);
+	_sum.fetch_add(value, std::memory_order_relaxed);
+	while (value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+}
+
+t_histogram	Histogram::snapshot(void) const
+{
+	t_histogram	histogram;
+
+	for (size_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++)
+		histogram.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+	histogram.count = _count.load(std::memory_order_relaxed);
+	histogram.sum = _sum.load(std::memory_order_relaxed);
+	histogram.max = _max.load(std::memory_order_relaxed);
+	return (histogram);
+}
+
+void	Histogram::clear(t_histogram &histogram)
+{
+	memset(&histogram, 0, sizeof(histogram));
+}
+
+//	adds a sample to a snapshot, used to build histograms at snapshot time
+void	Histogram::add(t_histogram &histogram, uint64_t value)
+{
+	histogram.buckets[bucket(value)]++;
+	histogram.count++;
+	histogram.sum += value;
+	if (value > histogram.max)
+		histogram.max = value;
+}
+
+/*
+ *	samples recorded between two snapshots of the same histogram, the max
+ *	can't be told apart and stays the one of current. The count is rebuilt
+ *	from the buckets since a snapshot isn't atomic
+ */
+t_histogram	Histogram::difference(const t_histogram &current, const t_histogram &previous)
+{
+	t_histogram	histogram;
+
+	clear(histogram);
+	for (size_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++)
+	{
+		histogram.buckets[i] = current.buckets[i] > previous.buckets[i] ? current.buckets[i] - previous.buckets[i] : 0;
+		histogram.count += histogram.buckets[i];
+	}
+	histogram.sum = current.sum > previous.sum ? current.sum - previous.sum : 0;
+	histogram.max = histogram.count ? current.max : 0;
+	return (histogram);
+}
+
+//	upper bound of the bucket holding the p quantile, p in [0, 1]
+uint64_t	Histogram::percentile(const t_histogram &histogram, double p)
+{
+	uint64_t	total = 0;
+	uint64_t	rank;
+
+	if (!histogram.count)
+		return (0);
+	rank = (uint64_t)(p * histogram.count);
+	if (rank >= histogram.count)
+		rank = histogram.count - 1;
+	for (size_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++)
+	{
+		total += histogram.buckets[i];
+		if (total > rank)
+			return (i ? std::min(((uint64_t)1 << i) - 1, histogram.max) : 0);
+	}
+	return (histogram.max);
+}
+
+SocketCounters::SocketCounters(void) : clientsAdded(0), clientsRemoved(0), clientExceptions(0), messagesSent(0), messagesReceived(0), bytesSent(0), bytesReceived(0), sendDrops(0), sendErrors(0)
+{
+}
+
+SocketCounters::~SocketCounters(void)
+{
+}
+
+//	counters only, the socket fills the client dependent fields
+t_socketMetrics	SocketCounters::snapshot(void) const
+{
+	t_socketMetrics	metrics;
+
+	metrics.clients = 0;
+	metrics.clientsAdded = clientsAdded;
+	metrics.clientsRemoved = clientsRemoved;
+	metrics.clientExceptions = clientExceptions;
+	metrics.messagesSent = messagesSent;
+	metrics.messagesReceived = messagesReceived;
+	metrics.bytesSent = bytesSent;
+	metrics.bytesReceived = bytesReceived;
+	metrics.sendDrops = sendDrops;
+	metrics.sendErrors = sendErrors;
+	metrics.sendQueue = 0;
+	metrics.receiveBatch = receiveBatch.snapshot();
+	metrics.messageSize = messageSize.snapshot();
+	Histogram::clear(metrics.rtt);
+	return (metrics);
+}
@@ -0,0 +1,123 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/MetricsReporter.h"
+#include "Log.h"
+
+#include <sstream>
+#include <iomanip>
+
+using namespace	ExoEngine;
+using namespace	network;
+
+MetricsReporter::MetricsReporter(ISocket &socket, const std::string &name, uint32_t period, const std::string &path) : _socket(socket), _name(name), _period(period), _stop(false)
+{
+	if (!period)
+		throw (std::invalid_argument("metrics reporter cannot have a null period"));
+	if (path.size())
+	{
+		_file.open(path, std::ios::out | std::ios::app);
+		if (!_file.is_open())
+			throw (std::runtime_error(std::string("cannot open metrics file ").append(path)));
+	}
+	_last = _socket.getMetrics();
+	_time = std::chrono::steady_clock::now();
+	_thread = std::thread(&MetricsReporter::loop, this);
+}
+
+MetricsReporter::~MetricsReporter(void)
+{
+	_mutex.lock();
+	_stop = true;
+	_mutex.unlock();
+	_cond.notify_one();
+	_thread.join();
+}
+
+void	MetricsReporter::report(void)
+{
+	std::chrono::steady_clock::time_point	now = std::chrono::steady_clock::now();
+	t_socketMetrics							metrics = _socket.getMetrics();
+	std::string								line;
+
+	_mutex.lock();
+
+	line = _name + ": " + format(metrics, _last, std::chrono::duration<double>(now - _time).count());
+	_last = metrics;
+	_time = now;
+	if (_file.is_open())
+		_file << line << std::endl;
+	else
+		_log.info << line << std::endl;
+
+	_mutex.unlock();
+}
+
+//	one line, rates are per second over the given seconds
+std::string	MetricsReporter::format(const t_socketMetrics &metrics, const t_socketMetrics &last, double seconds)
+{
+	std::ostringstream	stream;
+	t_histogram			batch = Histogram::difference(metrics.receiveBatch, last.receiveBatch);
+	t_histogram			size = Histogram::difference(metrics.messageSize, last.messageSize);
+
+	if (seconds <= 0)
+		seconds = 1;
+	stream << std::fixed << std::setprecision(1)
+		<< "clients " << metrics.clients
+		<< " (+" << metrics.clientsAdded - last.clientsAdded << " -" << metrics.clientsRemoved - last.clientsRemoved << ")"
+		<< " | sent " << (metrics.messagesSent - last.messagesSent) / seconds << " msg/s "
+		<< (metrics.bytesSent - last.bytesSent) / seconds / 1024 << " KiB/s"
+		<< " | received " << (metrics.messagesReceived - last.messagesReceived) / seconds << " msg/s "
+		<< (metrics.bytesReceived - last.bytesReceived) / seconds / 1024 << " KiB/s"
+		<< " | drops " << metrics.sendDrops - last.sendDrops
+		<< " errors " << metrics.sendErrors - last.sendErrors
+		<< " exceptions " << metrics.clientExceptions - last.clientExceptions
+		<< " | queued " << metrics.sendQueue << " B"
+		<< " | batch p50 " << Histogram::percentile(batch, 0.5)
+		<< " p99 " << Histogram::percentile(batch, 0.99)
+		<< " | size p50 " << Histogram::percentile(size, 0.5)
+		<< " p99 " << Histogram::percentile(size, 0.99)
+		<< " | rtt p50 " << Histogram::percentile(metrics.rtt, 0.5)
+		<< " p99 " << Histogram::percentile(metrics.rtt, 0.99) << " us";
+	return (stream.str());
+}
+
+void	MetricsReporter::loop(void)
+{
+	std::unique_lock<std::mutex>	lock(_mutex);
+
+	while (!_cond.wait_for(lock, std::chrono::milliseconds(_period), [this] { return (_stop); }))
+	{
+		lock.unlock();
+		try
+		{
+			report();
+		}
+		catch (const std::exception &e)
+		{
+			_log.error << "cannot report metrics of " << _name << ": " << e.what() << std::endl;
+		}
+		lock.lock();
+	}
+}
@@ -0,0 +1,223 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/OutboundQueue.h"
+#include "network/network.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <errno.h>
+
+using namespace	ExoEngine;
+using namespace	network;
+
+OutboundQueue::OutboundQueue(size_t highWaterMark, policy slowConsumer) : _offset(0), _pending(0), _overflow(false), _highWaterMark(highWaterMark), _policy(slowConsumer)
+{
+}
+
+OutboundQueue::~OutboundQueue(void)
+{
+}
+
+bool	OutboundQueue::push(const Message &message)
+{
+	return (push({message, Message(), false}));
+}
+
+//	moves the message in, its buffer ends up in the pool once written
+bool	OutboundQueue::push(Message &&message)
+{
+	return (push({std::move(message), Message(), false}));
+}
+
+//	writes frame, the send callback gets original
+bool	OutboundQueue::push(Message &&frame, Message &&original)
+{
+	return (push({std::move(frame), std::move(original), true}));
+}
+
+bool	OutboundQueue::push(t_entry &&entry)
+{
+	_mutex.lock();
+
+	if (_overflow || _pending + entry.data.getSize() > _highWaterMark)
+	{
+		if (_policy == DISCONNECT)
+			_overflow = true;
+		_mutex.unlock();
+		return (false);
+	}
+	if (entry.data.getSize())
+	{
+		_pending += entry.data.getSize();
+		_messages.push_back(std::move(entry));
+	}
+
+	_mutex.unlock();
+	return (true);
+}
+
+//	a message of size bytes, reusing the buffer of a sent one when there is
+Message	OutboundQueue::acquire(size_t size)
+{
+	Message	message;
+
+	_mutex.lock();
+
+	if (_free.empty())
+	{
+		_mutex.unlock();
+		return (Message(size));
+	}
+	message = std::move(_free.back());
+	_free.pop_back();
+
+	_mutex.unlock();
+	message.resize(size);
+	return (message);
+}
+
+/*
+ *	messages are only popped here, and a deque keeps references to its
+ *	elements valid on push_back, so the write itself is done without holding
+ *	the mutex. Returns the number of bytes written, or -1 on socket error.
+ */
+int		OutboundQueue::flush(int fd, ISocket &socket, IClient *client, void (*sentCb)(ISocket &, IClient *, const Message &))
+{
+	struct iovec	iov[OUTBOUND_QUEUE_IOV_MAX];
+	struct msghdr	header;
+	size_t			count = 0;
+	size_t			offset;
+	ssize_t			ret;
+
+	_mutex.lock();
+
+	offset = _offset;
+	for (auto message = _messages.begin(); message != _messages.end() && count < OUTBOUND_QUEUE_IOV_MAX; message++)
+	{
+		iov[count].iov_base = (uint8_t *)message->data.getPtr() + (count ? 0 : offset);
+		iov[count].iov_len = message->data.getSize() - (count ? 0 : offset);
+		count++;
+	}
+
+	_mutex.unlock();
+
+	if (!count)
+		return (0);
+	header = msghdr();
+	header.msg_iov = iov;
+	header.msg_iovlen = count;
+	ret = sendmsg(fd, &header, MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (ret < 0)
+		return ((errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1);
+
+	_mutex.lock();
+
+	_pending -= (size_t)ret;
+	offset += (size_t)ret;
+	while (!_messages.empty() && offset >= _messages.front().data.getSize())
+	{
+		offset -= _messages.front().data.getSize();
+		_sent.push_back(std::move(_messages.front()));
+		_messages.pop_front();
+	}
+	_offset = offset;
+
+	_mutex.unlock();
+
+	if (sentCb)
+		for (auto message = _sent.begin(); message != _sent.end(); message++)
+		{
+			if (!message->framed)
+				sentCb(socket, client, message->data);
+			else if (message->original.getSize())
+				sentCb(socket, client, message->original);
+		}
+	_mutex.lock();
+
+	//	a few large messages would otherwise pin their buffers for the life of the client
+	for (auto message = _sent.begin(); message != _sent.end() && _free.size() < OUTBOUND_QUEUE_POOL_SIZE; message++)
+	{
+		if (message->data.getCapacity() > OUTBOUND_QUEUE_POOL_MAX_CAPACITY)
+			continue ;
+		message->data.clear();
+		_free.push_back(std::move(message->data));
+	}
+
+	_mutex.unlock();
+	_sent.clear();
+	return ((int)ret);
+}
+
+void	OutboundQueue::clear(void)
+{
+	_mutex.lock();
+
+	_messages.clear();
+	_offset = 0;
+	_pending = 0;
+	_overflow = false;
+
+	_mutex.unlock();
+}
+
+//	marks the queue as overflowed whatever its policy, the client is disconnected on the next flush
+void	OutboundQueue::abort(void)
+{
+	_overflow = true;
+}
+
+size_t	OutboundQueue::getPending(void) const
+{
+	return (_pending);
+}
+
+bool	OutboundQueue::isEmpty(void) const
+{
+	return (!_pending);
+}
+
+bool	OutboundQueue::overflowed(void) const
+{
+	return (_overflow);
+}
+
+void	OutboundQueue::setHighWaterMark(size_t highWaterMark)
+{
+	_mutex.lock();
+
+	_highWaterMark = highWaterMark;
+
+	_mutex.unlock();
+}
+
+void	OutboundQueue::setPolicy(policy slowConsumer)
+{
+	_mutex.lock();
+
+	_policy = slowConsumer;
+
+	_mutex.unlock();
+}
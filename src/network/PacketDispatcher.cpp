@@ -0,0 +1,250 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/PacketDispatcher.h"
+
+#include <string.h>
+
+using namespace	ExoEngine;
+using namespace	network;
+
+PacketDispatcher::PacketDispatcher(ISocket &socket) : _socket(socket), _stream(socket.getType() == ISocket::TCP), _unknown(0), _data(nullptr)
+{
+	for (size_t i = 0; i < PACKET_DISPATCHER_TYPES; i++)
+	{
+		_table[i].call = nullptr;
+		_table[i].handler = nullptr;
+		_table[i].context = nullptr;
+		_table[i].received = 0;
+		_table[i].bytes = 0;
+		_table[i].rejected = 0;
+	}
+}
+
+PacketDispatcher::~PacketDispatcher(void)
+{
+}
+
+void	PacketDispatcher::set(int32_t type, trampoline call, callback handler)
+{
+	if (type < 0 || type >= PACKET_DISPATCHER_TYPES)
+		throw (std::out_of_range("packet type " + std::to_string(type) + " out of the dispatcher table"));
+	_table[type].call = handler ? call : nullptr;
+	_table[type].handler = handler;
+	_table[type].context = nullptr;
+}
+
+void	PacketDispatcher::bind(int32_t type, rawHandler handler, void *context)
+{
+	set(type, &PacketDispatcher::raw, (callback)handler);
+	_table[type].context = context;
+}
+
+void	PacketDispatcher::unbind(int32_t type)
+{
+	set(type, nullptr, nullptr);
+}
+
+bool	PacketDispatcher::raw(PacketDispatcher &dispatcher, IClient *client, const t_header &header, const uint8_t *data, size_t size, callback handler)
+{
+	((rawHandler)handler)(dispatcher, client, header, data, size);
+	return (true);
+}
+
+/*
+ *	splits a received buffer in packets by their header.size and dispatches
+ *	them, returns false when one of them was rejected. A packet with an
+ *	impossible size loses the framing, the rest of the buffer is dropped
+ */
+bool	PacketDispatcher::receive(IClient *client, const Message &packet)
+{
+	Message			buffer;
+	const Message	*src = &packet;
+	const uint8_t	*data;
+	size_t			size;
+	size_t			index = 0;
+	bool			accepted = true;
+	t_header		header;
+
+	if (_stream)
+	{
+		_partialMutex.lock();
+
+		auto	partial = _partial.find(client->getHandle());
+
+		if (partial != _partial.end())
+		{
+			buffer = std::move(partial->second);
+			_partial.erase(partial);
+			buffer.append(packet);
+			src = &buffer;
+		}
+
+		_partialMutex.unlock();
+	}
+	data = (const uint8_t *)src->getPtr();
+	size = src->getSize();
+	while (index < size)
+	{
+		if (size - index < sizeof(t_header))
+		{
+			if (_stream)
+				break ;
+			reject(client, -1, TYPE_INVALID_PACKET_SIZE);
+			return (false);
+		}
+		memcpy(&header, data + index, sizeof(header));
+		ENDIAN(header.type);
+		ENDIAN(header.size);
+		if (header.size < sizeof(t_header) || header.size > PAQUET_MAX_SIZE || (!_stream && header.size > size - index))
+		{
+			if (header.type >= 0 && header.type < PACKET_DISPATCHER_TYPES && _table[header.type].call)
+				_table[header.type].rejected++;
+			reject(client, header.type, TYPE_INVALID_PACKET_SIZE);
+			return (false);
+		}
+		if (header.size > size - index)
+			break ;
+		accepted = dispatch(client, header, data + index) && accepted;
+		index += header.size;
+	}
+	//	the start of a packet whose end comes with the next buffer
+	if (index < size)
+	{
+		_partialMutex.lock();
+		_partial[client->getHandle()] = Message(data + index, size - index);
+		_partialMutex.unlock();
+	}
+	return (accepted);
+}
+
+//	drops the partial packet of a client, called from the client del callback
+void	PacketDispatcher::release(IClient *client)
+{
+	_partialMutex.lock();
+	_partial.erase(client->getHandle());
+	_partialMutex.unlock();
+}
+
+//	calls the handler of a packet whose size was checked, returns false when it was rejected
+bool	PacketDispatcher::dispatch(IClient *client, const t_header &header, const uint8_t *data)
+{
+	t_entry	*entry;
+
+	if (header.type < 0 || header.type >= PACKET_DISPATCHER_TYPES || !_table[header.type].call)
+	{
+		_unknown++;
+		reject(client, header.type, TYPE_INVALID_PACKET_TYPE);
+		return (false);
+	}
+	entry = &_table[header.type];
+	if (!entry->call(*this, client, header, data + sizeof(t_header), header.size - sizeof(t_header), entry->handler))
+	{
+		entry->rejected++;
+		reject(client, header.type, TYPE_INVALID_PACKET_SIZE);
+		return (false);
+	}
+	entry->received++;
+	entry->bytes += header.size;
+	return (true);
+}
+
+//	answers a rejected packet, error packets are never answered so two dispatchers can't loop
+void	PacketDispatcher::reject(IClient *client, int32_t type, int32_t error)
+{
+	uint8_t	packet[sizeof(t_header)];
+
+	if (type == TYPE_INVALID_PACKET_TYPE || type == TYPE_INVALID_PACKET_SIZE)
+		return ;
+	writeHeader(packet, error, sizeof(t_header));
+	_socket.send(client, Message(packet, sizeof(packet)));
+}
+
+void	PacketDispatcher::send(IClient *client, int32_t type, const Message &payload)
+{
+	Message	packet(sizeof(t_header) + payload.getSize());
+
+	writeHeader(&packet[0], type, packet.getSize());
+	if (payload.getSize())
+		memcpy(&packet[sizeof(t_header)], payload.getPtr(), payload.getSize());
+	_socket.send(client, packet);
+}
+
+//	the header and the reflected payload are written in one buffer
+void	PacketDispatcher::send(IClient *client, int32_t type, reflection::IReflectable &payload)
+{
+	Message	packet(sizeof(t_header) + payload.size());
+
+	writeHeader(&packet[0], type, packet.getSize());
+	payload.write(&packet[sizeof(t_header)]);
+	_socket.send(client, packet);
+}
+
+void	PacketDispatcher::writeHeader(uint8_t *dst, int32_t type, uint32_t size)
+{
+	t_header	header;
+
+	header.type = network::endian(type);
+	header.size = network::endian(size);
+	memcpy(dst, &header, sizeof(header));
+}
+
+PacketDispatcher::t_packetStats	PacketDispatcher::getStats(int32_t type) const
+{
+	t_packetStats	stats;
+
+	if (type < 0 || type >= PACKET_DISPATCHER_TYPES)
+		throw (std::out_of_range("packet type " + std::to_string(type) + " out of the dispatcher table"));
+	stats.received = _table[type].received;
+	stats.bytes = _table[type].bytes;
+	stats.rejected = _table[type].rejected;
+	return (stats);
+}
+
+uint64_t	PacketDispatcher::getUnknown(void) const
+{
+	return (_unknown);
+}
+
+void	*PacketDispatcher::getContext(int32_t type) const
+{
+	if (type < 0 || type >= PACKET_DISPATCHER_TYPES)
+		throw (std::out_of_range("packet type " + std::to_string(type) + " out of the dispatcher table"));
+	return (_table[type].context);
+}
+
+ISocket	&PacketDispatcher::getSocket(void)
+{
+	return (_socket);
+}
+
+void	PacketDispatcher::attachData(void *data)
+{
+	_data = data;
+}
+
+void	*PacketDispatcher::getData(void)
+{
+	return (_data);
+}
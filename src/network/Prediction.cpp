@@ -0,0 +1,175 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/Prediction.h"
+
+#include <math.h>
+
+using namespace	ExoEngine;
+using namespace	network;
+
+static float	distance(const glm::vec2 &a, const glm::vec2 &b)
+{
+	return (sqrt(pow(a.x - b.x, 2) + pow(a.y - b.y, 2)));
+}
+
+Prediction::Prediction(Object &object) : _object(object), _next(1), _oldest(1), _correction(0), _overflows(0)
+{
+}
+
+Prediction::~Prediction(void)
+{
+}
+
+Prediction::t_entry	&Prediction::at(uint32_t sequence)
+{
+	return (_ring[sequence % PREDICTION_HISTORY]);
+}
+
+//	the simulation shared by the client and the server, they must run inputs the same way
+void	Prediction::step(Object &object, const t_input &input)
+{
+	object.handleMovement(input.elapsedTime, input.acceleration);
+	object.handleRotation(input.elapsedTime, input.rotation);
+}
+
+Prediction::t_state	Prediction::capture(const Object &object)
+{
+	t_state	state = {object.getPos(), object.getSpeed(), object.getAngle(), object.getRotationSpeed()};
+
+	return (state);
+}
+
+void	Prediction::restore(const t_state &state)
+{
+	_object.setPos(state.pos);
+	_object.setSpeed(state.speed);
+	_object.setAngle(state.angle);
+	_object.setRotationSpeed(state.rotSpeed);
+}
+
+/*
+ *	runs an input on the object and keeps it until the server has run it,
+ *	the oldest input is forgotten when the server is PREDICTION_HISTORY
+ *	inputs behind
+ */
+const Prediction::t_input	&Prediction::apply(float elapsedTime, const glm::vec2 &acceleration, float rotation)
+{
+	t_entry	&entry = at(_next);
+
+	if (_next - _oldest >= PREDICTION_HISTORY)
+	{
+		_oldest++;
+		_overflows++;
+	}
+	entry.input = {_next++, elapsedTime, acceleration, rotation};
+	step(_object, entry.input);
+	entry.predicted = capture(_object);
+	return (entry.input);
+}
+
+/*
+ *	takes the state the server reached after running the input sequence,
+ *	returns how many inputs were run again, none when the prediction was right
+ */
+size_t	Prediction::reconcile(uint32_t sequence, const t_state &state)
+{
+	glm::vec2	before;
+	bool		known;
+	size_t		replayed = 0;
+
+	//	ignores states older than the last one and inputs never sent
+	if ((int32_t)(sequence - _oldest) < -1 || (int32_t)(_next - 1 - sequence) < 0)
+		return (0);
+	known = sequence && _next - sequence <= PREDICTION_HISTORY;
+	_oldest = sequence + 1;
+	if (known)
+	{
+		const t_state	&predicted = at(sequence).predicted;
+
+		if (distance(predicted.pos, state.pos) <= PREDICTION_TOLERANCE
+			&& distance(predicted.speed, state.speed) <= PREDICTION_TOLERANCE
+			&& fabs(predicted.angle - state.angle) <= PREDICTION_TOLERANCE)
+		{
+			_correction = 0;
+			return (0);
+		}
+	}
+	before = _object.getPos();
+	restore(state);
+	for (uint32_t i = _oldest; i != _next; i++)
+	{
+		t_entry	&entry = at(i);
+
+		step(_object, entry.input);
+		entry.predicted = capture(_object);
+		replayed++;
+	}
+	_correction = distance(before, _object.getPos());
+	return (replayed);
+}
+
+//	snapshots don't carry the rotation speed, the predicted one is kept
+size_t	Prediction::reconcile(uint32_t sequence, const Snapshot::t_objectState &state)
+{
+	t_state	full = {state.pos, state.speed, state.angle, _object.getRotationSpeed()};
+
+	if (sequence && (int32_t)(_next - 1 - sequence) >= 0 && _next - sequence <= PREDICTION_HISTORY)
+		full.rotSpeed = at(sequence).predicted.rotSpeed;
+	return (reconcile(sequence, full));
+}
+
+void	Prediction::clear(void)
+{
+	_oldest = _next;
+	_correction = 0;
+}
+
+size_t	Prediction::getPending(void) const
+{
+	return (_next - _oldest);
+}
+
+const Prediction::t_input	*Prediction::getInput(uint32_t sequence) const
+{
+	if (sequence - _oldest >= _next - _oldest)
+		return (nullptr);
+	return (&_ring[sequence % PREDICTION_HISTORY].input);
+}
+
+//	distance the last reconciliation moved the object, to smooth it out on display
+float	Prediction::getCorrection(void) const
+{
+	return (_correction);
+}
+
+size_t	Prediction::getOverflows(void) const
+{
+	return (_overflows);
+}
+
+Object	&Prediction::getObject(void)
+{
+	return (_object);
+}
@@ -0,0 +1,276 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/Reactor.h"
+#include "Log.h"
+
+#include <chrono>
+
+//	milliseconds the acceptor waits for connections before checking if it must stop
+#define ACCEPT_TIMEOUT	10
+
+using namespace	ExoEngine;
+using namespace	network;
+
+Reactor::Reactor(size_t threads, size_t size) : _listener(nullptr), _set(nullptr), _next(0), _running(true), _listening(false)
+{
+	if (!threads)
+		threads = 1;
+	for (size_t i = 0; i < threads; i++)
+	{
+		t_shard	*shard = new t_shard;
+
+		try
+		{
+			shard->socket = new TcpSocket(size, true);
+		}
+		catch (const std::exception &)
+		{
+			delete shard;
+			_running = false;
+			for (auto it = _shards.begin(); it != _shards.end(); it++)
+				(*it)->socket->wake();
+			for (auto it = _shards.begin(); it != _shards.end(); it++)
+			{
+				(*it)->thread.join();
+				delete (*it)->socket;
+				delete *it;
+			}
+			throw ;
+		}
+		shard->socket->setTimeout(REACTOR_POLL_TIMEOUT);
+		_shards.push_back(shard);
+		shard->thread = std::thread(&Reactor::loop, this, shard);
+	}
+}
+
+Reactor::~Reactor(void)
+{
+	TCPsocket	socket;
+
+	if (_listening)
+		unbind();
+	_running = false;
+	for (auto shard = _shards.begin(); shard != _shards.end(); shard++)
+		(*shard)->socket->wake();
+	for (auto shard = _shards.begin(); shard != _shards.end(); shard++)
+	{
+		(*shard)->thread.join();
+		while ((*shard)->incoming.pop(socket))
+			SDLNet_TCP_Close(socket);
+		delete (*shard)->socket;
+		delete *shard;
+	}
+}
+
+void	Reactor::bind(uint16_t port)
+{
+	IPaddress	ip;
+
+	if (_listening)
+		throw (std::runtime_error(std::string("cannot bind reactor to ").append(std::to_string(port)).append(": reactor already bind")));
+	if (SDLNet_ResolveHost(&ip, NULL, port))
+		throw (std::runtime_error(std::string("cannot bind reactor to ").append(std::to_string(port)).append(SDLNet_GetError())));
+	_set = SDLNet_AllocSocketSet(1);
+	if (!_set)
+		throw (std::runtime_error(std::string("cannot allocate socket set: ").append(SDLNet_GetError())));
+	_listener = SDLNet_TCP_Open(&ip);
+	if (!_listener || SDLNet_TCP_AddSocket(_set, _listener) == -1)
+	{
+		if (_listener)
+			SDLNet_TCP_Close(_listener);
+		SDLNet_FreeSocketSet(_set);
+		_listener = nullptr;
+		_set = nullptr;
+		throw (std::runtime_error(std::string("cannot bind reactor to ").append(std::to_string(port)).append(SDLNet_GetError())));
+	}
+	_listening = true;
+	_acceptor = std::thread(&Reactor::accept, this);
+}
+
+void	Reactor::unbind(void)
+{
+	if (!_listening)
+		throw (std::runtime_error("cannot unbind when reactor isn't bind"));
+	_listening = false;
+	_acceptor.join();
+	SDLNet_TCP_DelSocket(_set, _listener);
+	SDLNet_TCP_Close(_listener);
+	SDLNet_FreeSocketSet(_set);
+	_listener = nullptr;
+	_set = nullptr;
+}
+
+//	can be called from any thread, the message is dropped if the client left before its shard sends it
+void	Reactor::send(size_t shard, IClient::handle handle, const Message &message)
+{
+	if (shard >= _shards.size())
+		throw (std::out_of_range(std::string("invalid shard ").append(std::to_string(shard))));
+	_shards[shard]->outgoing.push({handle, message, false});
+	_shards[shard]->socket->wake();
+}
+
+void	Reactor::send(ISocket &shard, IClient::handle handle, const Message &message)
+{
+	send(getShardIndex(shard), handle, message);
+}
+
+void	Reactor::broadcast(const Message &message)
+{
+	for (auto shard = _shards.begin(); shard != _shards.end(); shard++)
+	{
+		(*shard)->outgoing.push({0, message, true});
+		(*shard)->socket->wake();
+	}
+}
+
+size_t	Reactor::getShardsNumber(void) const
+{
+	return (_shards.size());
+}
+
+TcpSocket	&Reactor::getShard(size_t shard)
+{
+	if (shard >= _shards.size())
+		throw (std::out_of_range(std::string("invalid shard ").append(std::to_string(shard))));
+	return (*_shards[shard]->socket);
+}
+
+size_t	Reactor::getShardIndex(const ISocket &shard) const
+{
+	for (size_t i = 0; i < _shards.size(); i++)
+		if (_shards[i]->socket == &shard)
+			return (i);
+	throw (std::invalid_argument("socket isn't a shard of this reactor"));
+}
+
+size_t	Reactor::getClientsNumber(void)
+{
+	size_t	total = 0;
+
+	for (auto shard = _shards.begin(); shard != _shards.end(); shard++)
+		total += (*shard)->socket->getClientsNumber();
+	return (total);
+}
+
+void	Reactor::setClientAddCb(void(*callback)(ISocket &, IClient *))
+{
+	for (auto shard = _shards.begin(); shard != _shards.end(); shard++)
+		(*shard)->socket->setClientAddCb(callback);
+}
+
+void	Reactor::setClientDelCb(void(*callback)(ISocket &, IClient *))
+{
+	for (auto shard = _shards.begin(); shard != _shards.end(); shard++)
+		(*shard)->socket->setClientDelCb(callback);
+}
+
+void	Reactor::setClientExceptionCb(void(*callback)(ISocket &, IClient *))
+{
+	for (auto shard = _shards.begin(); shard != _shards.end(); shard++)
+		(*shard)->socket->setClientExceptionCb(callback);
+}
+
+void	Reactor::setMessageSendCb(void(*callback)(ISocket &, IClient *, const Message &))
+{
+	for (auto shard = _shards.begin(); shard != _shards.end(); shard++)
+		(*shard)->socket->setMessageSendCb(callback);
+}
+
+void	Reactor::setMessageReceiveCb(void(*callback)(ISocket &, IClient *, const Message &))
+{
+	for (auto shard = _shards.begin(); shard != _shards.end(); shard++)
+		(*shard)->socket->setMessageReceiveCb(callback);
+}
+
+/*
+ *	SDL_net gives no access to SO_REUSEPORT, so a single listener accepts
+ *	every connection and hands them round robin to the shards
+ */
+void	Reactor::accept(void)
+{
+	TCPsocket	socket;
+	t_shard		*shard;
+	int			ret;
+
+	while (_listening)
+	{
+		ret = SDLNet_CheckSockets(_set, ACCEPT_TIMEOUT);
+		if (ret == -1)
+		{
+			_log.error << "reactor socket check failed: " << SDLNet_GetError() << std::endl;
+			std::this_thread::sleep_for(std::chrono::milliseconds(ACCEPT_TIMEOUT));
+			continue ;
+		}
+		if (ret <= 0 || !SDLNet_SocketReady(_listener))
+			continue ;
+		socket = SDLNet_TCP_Accept(_listener);
+		if (!socket)
+		{
+			_log.error << "cannot get incoming client: " << SDLNet_GetError() << std::endl;
+			continue ;
+		}
+		shard = _shards[_next++ % _shards.size()];
+		shard->incoming.push(socket);
+		shard->socket->wake();
+	}
+}
+
+void	Reactor::loop(t_shard *shard)
+{
+	TCPsocket	socket;
+	t_outgoing	outgoing;
+	IClient		*client;
+
+	while (_running)
+	{
+		try
+		{
+			while (shard->incoming.pop(socket))
+			{
+				try
+				{
+					shard->socket->adopt(socket);
+				}
+				catch (const std::exception &e)
+				{
+					SDLNet_TCP_Close(socket);
+					_log.error << "cannot adopt incoming client: " << e.what() << std::endl;
+				}
+			}
+			while (shard->outgoing.pop(outgoing))
+			{
+				if (outgoing.broadcast)
+					shard->socket->broadcast(outgoing.message);
+				else if ((client = shard->socket->getClient(outgoing.handle)))
+					shard->socket->send(client, outgoing.message);
+			}
+			shard->socket->pollEvent(SOCKET_ALLOW_READ | SOCKET_ALLOW_WRITE);
+		}
+		catch (const std::exception &e)
+		{
+			_log.error << "reactor shard: " << e.what() << std::endl;
+		}
+	}
+}
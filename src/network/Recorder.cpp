@@ -0,0 +1,153 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/Recorder.h"
+#include "BitStream.h"
+#include "Log.h"
+
+#include <string.h>
+
+using namespace	ExoEngine;
+using namespace	network;
+
+Recorder::Recorder(const std::string &path, ISocket::type type) : _last(std::chrono::steady_clock::now()), _next(0), _records(0), _bytes(0)
+{
+	_file.open(path.c_str(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+	if (!_file.is_open())
+		throw (std::runtime_error(std::string("cannot open capture file ").append(path).append(": ").append(strerror(errno))));
+	_buffer.reserve(CAPTURE_BUFFER_SIZE);
+	_buffer.insert(_buffer.end(), CAPTURE_MAGIC, CAPTURE_MAGIC + sizeof(CAPTURE_MAGIC) - 1);
+	_buffer.push_back(CAPTURE_VERSION);
+	_buffer.push_back((uint8_t)type);
+}
+
+Recorder::~Recorder(void)
+{
+	try
+	{
+		flush();
+	}
+	catch (const std::exception &e)
+	{
+		_log.error << e.what() << std::endl;
+	}
+	_file.close();
+}
+
+void	Recorder::record(event type, const IClient *client, const Message &message)
+{
+	_mutex.lock();
+
+	auto	found = _ids.find(client->getHandle());
+	uint32_t	id;
+
+	try
+	{
+		if (found == _ids.end())
+		{
+			id = _next++;
+			if (type != CLIENT_DEL)
+				_ids[client->getHandle()] = id;
+			if (type != CLIENT_ADD)
+				write(CLIENT_ADD, id, nullptr);
+		}
+		else
+		{
+			id = found->second;
+			if (type == CLIENT_DEL)
+				_ids.erase(found);
+		}
+		write(type, id, type == MESSAGE_SEND || type == MESSAGE_RECEIVE ? &message : nullptr);
+	}
+	catch (const std::exception &)
+	{
+		_mutex.unlock();
+		throw ;
+	}
+
+	_mutex.unlock();
+}
+
+void	Recorder::flush(void)
+{
+	_mutex.lock();
+
+	if (!writeBuffer() || !_file.flush().good())
+	{
+		_mutex.unlock();
+		throw (std::runtime_error("cannot write capture file"));
+	}
+
+	_mutex.unlock();
+}
+
+uint64_t	Recorder::getRecords(void) const
+{
+	return (_records);
+}
+
+uint64_t	Recorder::getBytes(void) const
+{
+	return (_bytes);
+}
+
+//	called with the mutex locked
+void	Recorder::write(event type, uint32_t id, const Message *message)
+{
+	std::chrono::steady_clock::time_point	current = std::chrono::steady_clock::now();
+	size_t									size = _buffer.size();
+	BitWriter								writer(_header);
+
+	_header.clear();
+	writer.writeBits(type, 8);
+	writer.writeVarint(std::chrono::duration_cast<std::chrono::microseconds>(current - _last).count());
+	writer.writeVarint(id);
+	if (message)
+		writer.writeVarint(message->getSize());
+	writer.flush();
+	_buffer.insert(_buffer.end(), (const uint8_t *)_header.getPtr(), (const uint8_t *)_header.getPtr() + _header.getSize());
+	if (message)
+		_buffer.insert(_buffer.end(), (const uint8_t *)message->getPtr(), (const uint8_t *)message->getPtr() + message->getSize());
+	//	advances by whole microseconds so rounding errors don't add up over the capture
+	_last += std::chrono::duration_cast<std::chrono::microseconds>(current - _last);
+	_records++;
+	_bytes += _buffer.size() - size;
+	//	a failed write must not break the socket, the capture is just cut short
+	if (_buffer.size() >= CAPTURE_BUFFER_SIZE && !writeBuffer())
+	{
+		_log.error << "cannot write capture file, " << _buffer.size() << " bytes dropped" << std::endl;
+		_buffer.clear();
+	}
+}
+
+bool	Recorder::writeBuffer(void)
+{
+	if (_buffer.empty())
+		return (true);
+	_file.write((const char *)_buffer.data(), _buffer.size());
+	if (!_file.good())
+		return (false);
+	_buffer.clear();
+	return (true);
+}
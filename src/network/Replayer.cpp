@@ -0,0 +1,239 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/Replayer.h"
+#include "network/TcpSocket.h"
+#include "network/UdpSocket.h"
+#include "network/LoopbackSocket.h"
+#include "BitStream.h"
+#include "Log.h"
+
+#include <fstream>
+#include <thread>
+#include <string.h>
+
+//	records replayed between two polls of the sockets when replaying as fast as possible
+#define REPLAY_POLL_INTERVAL	64
+
+using namespace	ExoEngine;
+using namespace	network;
+
+Replayer::Replayer(const std::string &path, Recorder::event direction) : _clients(0), _messages(0)
+{
+	std::ifstream	file(path.c_str(), std::ifstream::in | std::ifstream::binary | std::ifstream::ate);
+	Message			data;
+	size_t			index = sizeof(CAPTURE_MAGIC) - 1 + 2;
+	uint64_t		time = 0;
+	t_record		record;
+	uint64_t		size;
+
+	if (!file.is_open())
+		throw (std::runtime_error(std::string("cannot open capture file ").append(path).append(": ").append(strerror(errno))));
+	data.resize((size_t)file.tellg());
+	if (data.getSize() < index || !file.seekg(0).read((char *)&data[0], data.getSize())
+		|| memcmp(data.getPtr(), CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC) - 1))
+		throw (std::runtime_error(std::string(path).append(" isn't a capture file")));
+	if (data[index - 2] != CAPTURE_VERSION)
+		throw (std::runtime_error(std::string("unsupported capture version ").append(std::to_string(data[index - 2]))));
+	_type = (ISocket::type)data[index - 1];
+	while (index < data.getSize())
+	{
+		BitReader	reader(data, index);
+
+		try
+		{
+			record.type = (Recorder::event)reader.readBits(8);
+			if (record.type > Recorder::MESSAGE_RECEIVE)
+				throw (std::runtime_error(std::string("invalid capture record type ").append(std::to_string(record.type))));
+			time += reader.readVarint();
+			record.time = time;
+			record.client = (uint32_t)reader.readVarint();
+			size = record.type == Recorder::MESSAGE_SEND || record.type == Recorder::MESSAGE_RECEIVE ? reader.readVarint() : 0;
+		}
+		catch (const std::invalid_argument &e)
+		{
+			throw (std::runtime_error(std::string("truncated capture record: ").append(e.what())));
+		}
+		index = reader.getIndex();
+		if (record.type == Recorder::MESSAGE_SEND || record.type == Recorder::MESSAGE_RECEIVE)
+		{
+			if (size > data.getSize() - index)
+				throw (std::runtime_error("truncated capture record"));
+			index += size;
+			if (record.type != direction)
+				continue ;
+			record.message = Message((const uint8_t *)data.getPtr() + index - size, size);
+			_messages++;
+		}
+		else
+		{
+			record.message.clear();
+			if (record.type == Recorder::CLIENT_ADD)
+				_clients++;
+		}
+		_records.push_back(std::move(record));
+	}
+}
+
+Replayer::~Replayer(void)
+{
+}
+
+t_replayStats	Replayer::replay(const std::string &address, uint16_t port, double speed)
+{
+	return (replay(address, port, speed, _type));
+}
+
+t_replayStats	Replayer::replay(const std::string &address, uint16_t port, double speed, ISocket::type type)
+{
+	std::unordered_map<uint32_t, t_peer>	peers;
+	t_replayStats							stats = {0, 0, 0, 0, 0};
+	std::chrono::steady_clock::time_point	start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point	target;
+	uint64_t								first = _records.empty() ? 0 : _records.front().time;
+	size_t									count = 0;
+
+	try
+	{
+		for (auto record = _records.begin(); record != _records.end(); record++)
+		{
+			if (speed > 0)
+			{
+				target = start + std::chrono::microseconds((uint64_t)((record->time - first) / speed));
+				while (std::chrono::steady_clock::now() < target)
+				{
+					poll(peers);
+					std::this_thread::sleep_until(std::min(target, std::chrono::steady_clock::now() + std::chrono::milliseconds(1)));
+				}
+				stats.lag = std::max(stats.lag, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - target).count());
+			}
+			else if (++count % REPLAY_POLL_INTERVAL == 0)
+				poll(peers);
+
+			auto	peer = peers.find(record->client);
+
+			if (record->type == Recorder::CLIENT_ADD && peer == peers.end())
+			{
+				t_peer	&added = peers[record->client];
+
+				added.client = nullptr;
+				added.socket = create(type);
+				added.socket->attachData(&added);
+				added.socket->setClientAddCb(connected);
+				try
+				{
+					added.socket->connect(address, port);
+				}
+				catch (const std::exception &e)
+				{
+					_log.error << "cannot replay client " << record->client << ": " << e.what() << std::endl;
+					delete added.socket;
+					peers.erase(record->client);
+					continue ;
+				}
+				stats.clients++;
+			}
+			else if (record->type == Recorder::CLIENT_DEL && peer != peers.end())
+			{
+				drain(peer->second.socket);
+				delete peer->second.socket;
+				peers.erase(peer);
+			}
+			else if ((record->type == Recorder::MESSAGE_SEND || record->type == Recorder::MESSAGE_RECEIVE) && peer != peers.end() && peer->second.client)
+			{
+				peer->second.socket->send(peer->second.client, record->message);
+				stats.messages++;
+				stats.bytes += record->message.getSize();
+			}
+		}
+		poll(peers);
+	}
+	catch (const std::exception &)
+	{
+		for (auto peer = peers.begin(); peer != peers.end(); peer++)
+			delete peer->second.socket;
+		throw ;
+	}
+	for (auto peer = peers.begin(); peer != peers.end(); peer++)
+		delete peer->second.socket;
+	stats.duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return (stats);
+}
+
+ISocket::type	Replayer::getType(void) const
+{
+	return (_type);
+}
+
+size_t	Replayer::getClientsNumber(void) const
+{
+	return (_clients);
+}
+
+size_t	Replayer::getMessagesNumber(void) const
+{
+	return (_messages);
+}
+
+//	seconds between the first and the last record
+double	Replayer::getDuration(void) const
+{
+	return (_records.empty() ? 0 : (_records.back().time - _records.front().time) / 1e6);
+}
+
+ISocket	*Replayer::create(ISocket::type type)
+{
+	switch (type)
+	{
+		case ISocket::TCP:
+			return (new TcpSocket(1));
+		case ISocket::UDP:
+			return (new UdpSocket(1));
+		case ISocket::LOOPBACK:
+			return (new LoopbackSocket(1));
+	}
+	throw (std::invalid_argument(std::string("invalid socket type ").append(std::to_string(type))));
+}
+
+void	Replayer::connected(ISocket &socket, IClient *client)
+{
+	((t_peer *)socket.getData())->client = client;
+}
+
+//	flushes what was sent and drops the replies
+void	Replayer::poll(std::unordered_map<uint32_t, t_peer> &peers)
+{
+	for (auto peer = peers.begin(); peer != peers.end(); peer++)
+		peer->second.socket->pollEvent(SOCKET_ALLOW_READ | SOCKET_ALLOW_WRITE);
+}
+
+//	polls socket until it wrote what was queued or REPLAY_DRAIN_TIMEOUT ms passed
+void	Replayer::drain(ISocket *socket)
+{
+	std::chrono::steady_clock::time_point	deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(REPLAY_DRAIN_TIMEOUT);
+
+	do
+		socket->pollEvent(SOCKET_ALLOW_WRITE);
+	while (socket->getMetrics().sendQueue && std::chrono::steady_clock::now() < deadline);
+}
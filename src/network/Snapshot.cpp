@@ -0,0 +1,312 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/Snapshot.h"
+#include "network/network.h"
+#include "World.h"
+
+#include <string.h>
+#include <algorithm>
+
+//	id and change mask, the smallest entry a snapshot can hold
+#define ENTRY_MIN_SIZE	(sizeof(uint32_t) + sizeof(uint8_t))
+
+using namespace	ExoEngine;
+using namespace	network;
+
+template	<typename T>
+static T	readField(const Message &src, size_t &index)
+{
+	T	value;
+
+	if (index + sizeof(T) > src.getSize())
+		throw (std::invalid_argument("cannot read " + std::to_string(sizeof(T)) +
+			" bytes, only " + std::to_string(src.getSize() - index) + " left"));
+	memcpy((void *)&value, (const uint8_t *)src.getPtr() + index, sizeof(T));
+	index += sizeof(T);
+	return (endian(value));
+}
+
+static uint8_t	changes(const Snapshot::t_objectState &a, const Snapshot::t_objectState &b)
+{
+	uint8_t	mask = 0;
+
+	if (a.pos != b.pos)
+		mask |= Snapshot::FIELD_POS;
+	if (a.speed != b.speed)
+		mask |= Snapshot::FIELD_SPEED;
+	if (a.angle != b.angle)
+		mask |= Snapshot::FIELD_ANGLE;
+	if (a.bitfield != b.bitfield)
+		mask |= Snapshot::FIELD_BITFIELD;
+	return (mask);
+}
+
+static void	writeEntry(Message &dst, const Snapshot::t_objectState &state, uint8_t mask)
+{
+	if (state.id > 0xffffffff)
+		throw (std::out_of_range(std::string("cannot replicate object ").append(std::to_string(state.id)).append(": id too big")));
+	dst.append(endian((uint32_t)state.id));
+	dst.append(mask);
+	if (mask & Snapshot::FIELD_POS)
+	{
+		dst.append(endian(state.pos.x));
+		dst.append(endian(state.pos.y));
+	}
+	if (mask & Snapshot::FIELD_SPEED)
+	{
+		dst.append(endian(state.speed.x));
+		dst.append(endian(state.speed.y));
+	}
+	if (mask & Snapshot::FIELD_ANGLE)
+		dst.append(endian(state.angle));
+	if (mask & Snapshot::FIELD_BITFIELD)
+		dst.append(endian(state.bitfield));
+}
+
+Snapshot::Snapshot(uint16_t sequence) : _sequence(sequence)
+{
+}
+
+Snapshot::~Snapshot(void)
+{
+}
+
+void	Snapshot::capture(World &world)
+{
+	world.lock();
+
+	_objects.clear();
+	_objects.reserve(world.getObjects().size());
+	for (auto object = world.getObjects().begin(); object != world.getObjects().end(); object++)
+		_objects.push_back({object->first, object->second->getPos(), object->second->getSpeed(),
+			(float)object->second->getAngle(), object->second->getBitfield()});
+
+	world.unlock();
+}
+
+/*
+ *	objects of `previous` missing from this snapshot were removed on the
+ *	peer and are destroyed, objects of this snapshot missing from the world
+ *	can't be built here (type and hitboxes aren't replicated): their ids are
+ *	pushed in `created` for the caller to spawn before the next apply
+ */
+void	Snapshot::apply(World &world, const Snapshot *previous, std::vector<size_t> *created) const
+{
+	world.lock();
+
+	try
+	{
+		if (previous)
+		{
+			auto	current = _objects.begin();
+
+			for (auto old = previous->_objects.begin(); old != previous->_objects.end(); old++)
+			{
+				while (current != _objects.end() && current->id < old->id)
+					current++;
+				if (current != _objects.end() && current->id == old->id)
+					continue ;
+				if (world.getObjects().count(old->id))
+					world.removeObject(old->id);
+			}
+		}
+		for (auto state = _objects.begin(); state != _objects.end(); state++)
+		{
+			auto	object = world.getObjects().find(state->id);
+
+			if (object == world.getObjects().end())
+			{
+				if (created)
+					created->push_back(state->id);
+				continue ;
+			}
+			object->second->setPos(state->pos);
+			object->second->setSpeed(state->speed);
+			object->second->setAngle(state->angle);
+			object->second->setBitfield(state->bitfield);
+		}
+	}
+	catch (const std::exception &)
+	{
+		world.unlock();
+		throw ;
+	}
+
+	world.unlock();
+}
+
+void	Snapshot::add(const t_objectState &state)
+{
+	if (!_objects.empty() && _objects.back().id >= state.id)
+		throw (std::invalid_argument("snapshot objects must be added by increasing id"));
+	_objects.push_back(state);
+}
+
+const Snapshot::t_objectState	*Snapshot::find(size_t id) const
+{
+	auto	state = std::lower_bound(_objects.begin(), _objects.end(), id,
+		[](const t_objectState &a, size_t b) { return (a.id < b); });
+
+	if (state == _objects.end() || state->id != id)
+		return (nullptr);
+	return (&*state);
+}
+
+void	Snapshot::clear(void)
+{
+	_objects.clear();
+}
+
+void	Snapshot::encode(const Snapshot *baseline, Message &dst) const
+{
+	static const std::vector<t_objectState>	empty;
+	const std::vector<t_objectState>		&base = baseline ? baseline->_objects : empty;
+	size_t									count;
+	uint32_t								entries = 0;
+	auto									current = _objects.begin();
+	auto									previous = base.begin();
+
+	dst.append(endian(_sequence));
+	dst.append(endian(baseline ? baseline->_sequence : (uint16_t)0));
+	dst.append((uint8_t)(baseline ? 1 : 0));
+	count = dst.getSize();
+	dst.append(entries);
+	while (current != _objects.end() || previous != base.end())
+	{
+		if (previous == base.end() || (current != _objects.end() && current->id < previous->id))
+		{
+			writeEntry(dst, *current++, FIELD_ALL);
+			entries++;
+		}
+		else if (current == _objects.end() || previous->id < current->id)
+		{
+			writeEntry(dst, *previous++, FIELD_REMOVED);
+			entries++;
+		}
+		else
+		{
+			uint8_t	mask = changes(*current, *previous);
+
+			if (mask)
+			{
+				writeEntry(dst, *current, mask);
+				entries++;
+			}
+			current++;
+			previous++;
+		}
+	}
+	entries = endian(entries);
+	memcpy(&dst[count], &entries, sizeof(entries));
+}
+
+size_t	Snapshot::decode(const Snapshot *baseline, const Message &src, size_t index)
+{
+	static const std::vector<t_objectState>	empty;
+	std::vector<t_objectState>				objects;
+	uint16_t								sequence, baseSequence;
+	uint32_t								entries;
+	size_t									lastId = 0;
+	bool									hasBaseline;
+
+	sequence = readField<uint16_t>(src, index);
+	baseSequence = readField<uint16_t>(src, index);
+	hasBaseline = readField<uint8_t>(src, index);
+	entries = readField<uint32_t>(src, index);
+	if (hasBaseline && (!baseline || baseline->_sequence != baseSequence))
+		throw (std::runtime_error(std::string("cannot decode snapshot ").append(std::to_string(sequence))
+			.append(": missing baseline ").append(std::to_string(baseSequence))));
+
+	//	the count comes from the wire, it can't exceed what the message holds
+	if (entries > (src.getSize() - index) / ENTRY_MIN_SIZE)
+		throw (std::invalid_argument(std::string("cannot decode snapshot ").append(std::to_string(sequence))
+			.append(": ").append(std::to_string(entries)).append(" entries in ").append(std::to_string(src.getSize() - index)).append(" bytes")));
+
+	const std::vector<t_objectState>	&base = hasBaseline ? baseline->_objects : empty;
+	auto								previous = base.begin();
+
+	objects.reserve(base.size() + entries);
+	for (uint32_t i = 0; i < entries; i++)
+	{
+		t_objectState	state = t_objectState();
+		uint8_t			mask;
+
+		state.id = readField<uint32_t>(src, index);
+		//	the merge with the baseline needs entries sorted by id
+		if (i && state.id <= lastId)
+			throw (std::invalid_argument(std::string("cannot decode snapshot ").append(std::to_string(sequence))
+				.append(": object ").append(std::to_string(state.id)).append(" out of order")));
+		lastId = state.id;
+		mask = readField<uint8_t>(src, index);
+		while (previous != base.end() && previous->id < state.id)
+			objects.push_back(*previous++);
+		if (previous != base.end() && previous->id == state.id)
+			state = *previous++;
+		if (mask & FIELD_REMOVED)
+			continue ;
+		if (mask & FIELD_POS)
+		{
+			state.pos.x = readField<float>(src, index);
+			state.pos.y = readField<float>(src, index);
+		}
+		if (mask & FIELD_SPEED)
+		{
+			state.speed.x = readField<float>(src, index);
+			state.speed.y = readField<float>(src, index);
+		}
+		if (mask & FIELD_ANGLE)
+			state.angle = readField<float>(src, index);
+		if (mask & FIELD_BITFIELD)
+			state.bitfield = readField<uint32_t>(src, index);
+		objects.push_back(state);
+	}
+	while (previous != base.end())
+		objects.push_back(*previous++);
+	_sequence = sequence;
+	_objects.swap(objects);
+	return (index);
+}
+
+bool	Snapshot::peek(const Message &src, size_t index, uint16_t &sequence, uint16_t &baseline)
+{
+	sequence = readField<uint16_t>(src, index);
+	baseline = readField<uint16_t>(src, index);
+	return (readField<uint8_t>(src, index));
+}
+
+uint16_t	Snapshot::getSequence(void) const
+{
+	return (_sequence);
+}
+
+void	Snapshot::setSequence(uint16_t sequence)
+{
+	_sequence = sequence;
+}
+
+const std::vector<Snapshot::t_objectState>	&Snapshot::getObjects(void) const
+{
+	return (_objects);
+}
@@ -0,0 +1,84 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/SnapshotReceiver.h"
+#include "Log.h"
+
+using namespace	ExoEngine;
+using namespace	network;
+
+SnapshotReceiver::SnapshotReceiver(void) : _latest(0), _hasLatest(false)
+{
+	for (size_t i = 0; i < SNAPSHOT_RING_SIZE; i++)
+		_valid[i] = false;
+}
+
+SnapshotReceiver::~SnapshotReceiver(void)
+{
+}
+
+bool	SnapshotReceiver::receive(const Message &src, uint16_t &sequence)
+{
+	const Snapshot	*baseline = nullptr;
+	uint16_t		base;
+	size_t			slot;
+
+	try
+	{
+		if (Snapshot::peek(src, 0, sequence, base))
+		{
+			if (!_valid[base % SNAPSHOT_RING_SIZE] || _ring[base % SNAPSHOT_RING_SIZE].getSequence() != base)
+			{
+				_log.debug << "snapshot " << sequence << " dropped: baseline " << base << " unknown" << std::endl;
+				return (false);
+			}
+			baseline = &_ring[base % SNAPSHOT_RING_SIZE];
+		}
+		//	too old, its slot may hold a more recent snapshot
+		if (_hasLatest && (int16_t)(_latest - sequence) >= SNAPSHOT_RING_SIZE)
+			return (false);
+		slot = sequence % SNAPSHOT_RING_SIZE;
+		_valid[slot] = false;
+		_ring[slot].decode(baseline, src, 0);
+		_valid[slot] = true;
+	}
+	catch (const std::exception &e)
+	{
+		_log.warning << "cannot decode snapshot: " << e.what() << std::endl;
+		return (false);
+	}
+	if (!_hasLatest || (int16_t)(sequence - _latest) > 0)
+	{
+		_latest = sequence;
+		_hasLatest = true;
+	}
+	return (true);
+}
+
+const Snapshot	*SnapshotReceiver::getLatest(void) const
+{
+	if (!_hasLatest)
+		return (nullptr);
+	return (&_ring[_latest % SNAPSHOT_RING_SIZE]);
+}
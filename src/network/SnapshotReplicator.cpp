@@ -0,0 +1,115 @@
+/*
+ *	MIT License
+ *
+ *	Copyright (c) 2020 Gaëtan Dezeiraud and Ribault Paul
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+#include "network/SnapshotReplicator.h"
+
+using namespace	ExoEngine;
+using namespace	network;
+
+SnapshotReplicator::SnapshotReplicator(void) : _sequence(0)
+{
+}
+
+SnapshotReplicator::~SnapshotReplicator(void)
+{
+}
+
+std::shared_ptr<const Snapshot>	SnapshotReplicator::capture(World &world)
+{
+	std::shared_ptr<Snapshot>	snapshot = std::make_shared<Snapshot>(nextSequence());
+
+	snapshot->capture(world);
+	return (snapshot);
+}
+
+uint16_t	SnapshotReplicator::nextSequence(void)
+{
+	uint16_t	sequence;
+
+	_mutex.lock();
+
+	sequence = _sequence++;
+
+	_mutex.unlock();
+	return (sequence);
+}
+
+void	SnapshotReplicator::encode(IClient::handle client, const std::shared_ptr<const Snapshot> &snapshot, Message &dst)
+{
+	const Snapshot	*baseline = nullptr;
+
+	_mutex.lock();
+
+	t_client	&state = _clients[client];
+
+	if (state.hasAck && (uint16_t)(snapshot->getSequence() - state.acked) < SNAPSHOT_RING_SIZE)
+	{
+		const std::shared_ptr<const Snapshot>	&acked = state.ring[state.acked % SNAPSHOT_RING_SIZE];
+
+		if (acked && acked->getSequence() == state.acked)
+			baseline = acked.get();
+	}
+	try
+	{
+		snapshot->encode(baseline, dst);
+	}
+	catch (const std::exception &)
+	{
+		_mutex.unlock();
+		throw ;
+	}
+	state.ring[snapshot->getSequence() % SNAPSHOT_RING_SIZE] = snapshot;
+
+	_mutex.unlock();
+}
+
+void	SnapshotReplicator::acknowledge(IClient::handle client, uint16_t sequence)
+{
+	_mutex.lock();
+
+	auto	state = _clients.find(client);
+
+	if (state != _clients.end())
+	{
+		const std::shared_ptr<const Snapshot>	&sent = state->second.ring[sequence % SNAPSHOT_RING_SIZE];
+
+		if (sent && sent->getSequence() == sequence &&
+			(!state->second.hasAck || (int16_t)(sequence - state->second.acked) > 0))
+		{
+			state->second.acked = sequence;
+			state->second.hasAck = true;
+		}
+	}
+
+	_mutex.unlock();
+}
+
+void	SnapshotReplicator::remove(IClient::handle client)
+{
+	_mutex.lock();
+
+	_clients.erase(client);
+
+	_mutex.unlock();
+}
@@ -23,19 +23,27 @@
  */
 
 #include "network/TcpClient.h"
+#include "network/SocketDescriptor.h"
 #include "network/network.h"
 #include "Log.h"
 
+#ifdef __linux__
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <sys/socket.h>
+#endif
+
 using namespace	ExoEngine;
 using namespace	network;
 
-TcpClient::TcpClient(const TCPsocket &socket) : _socket(socket)
+TcpClient::TcpClient(const TCPsocket &socket, size_t highWaterMark, OutboundQueue::policy slowConsumer) : _socket(socket), _outbound(highWaterMark, slowConsumer), _compressor(nullptr)
 {
 	_address = SDLNet_TCP_GetPeerAddress(_socket);
 }
 
 TcpClient::~TcpClient()
 {
+	delete _compressor;
 	SDLNet_TCP_Close(_socket);
 }
 
@@ -79,11 +87,112 @@ SDLNet_GenericSocket	&TcpClient::getSocket(void)
 	return ((SDLNet_GenericSocket &)_socket);
 }
 
+int		TcpClient::getFd(void) const
+{
+	return (getDescriptor(_socket));
+}
+
+OutboundQueue	&TcpClient::getOutboundQueue(void)
+{
+	return (_outbound);
+}
+
+Compressor	*TcpClient::getCompressor(void)
+{
+	return (_compressor);
+}
+
+bool	TcpClient::queue(const Message &message)
+{
+	if (!_compressor)
+		return (_outbound.push(message));
+	return (queue(Message(message)));
+}
+
+/*
+ *	frames and compresses the message when compression is enabled, the
+ *	deflate stream must see messages in the order they are queued. The
+ *	message is kept with its frame for the send callback.
+ */
+bool	TcpClient::queue(Message &&message)
+{
+	Message	frame;
+	bool	compressed;
+
+	if (!_compressor)
+		return (_outbound.push(std::move(message)));
+	_sendMutex.lock();
+
+	try
+	{
+		compressed = _compressor->encode(message, frame);
+	}
+	catch (const std::exception &)
+	{
+		_sendMutex.unlock();
+		throw ;
+	}
+	if (!_outbound.push(std::move(frame), std::move(message)))
+	{
+		if (compressed)
+			_outbound.abort();
+		_sendMutex.unlock();
+		return (false);
+	}
+
+	_sendMutex.unlock();
+	return (true);
+}
+
+void	TcpClient::enableCompression(int level, size_t minSize, const std::shared_ptr<const std::string> &dictionary)
+{
+	Message	hello;
+
+	_sendMutex.lock();
+
+	if (_compressor)
+	{
+		_sendMutex.unlock();
+		throw (std::runtime_error("compression already enabled"));
+	}
+	try
+	{
+		_compressor = new Compressor(level, minSize, dictionary);
+	}
+	catch (const std::exception &)
+	{
+		_sendMutex.unlock();
+		throw ;
+	}
+	_compressor->hello(hello);
+	_outbound.push(std::move(hello), Message());
+
+	_sendMutex.unlock();
+}
+
 void	TcpClient::updateAddress(const IPaddress &address)
 {
 	*_address = address;
 }
 
+//	the rtt is the kernel estimate, only available on linux
+t_clientMetrics	TcpClient::getMetrics(void)
+{
+	t_clientMetrics	metrics = IClient::getMetrics();
+#ifdef __linux__
+	struct tcp_info	info;
+	socklen_t		size = sizeof(info);
+
+	if (!getsockopt(getFd(), IPPROTO_TCP, TCP_INFO, &info, &size))
+	{
+		metrics.rtt = info.tcpi_rtt;
+		metrics.rttVar = info.tcpi_rttvar;
+	}
+#endif
+	metrics.sendQueue = _outbound.getPending();
+	return (metrics);
+}
+
 bool	TcpClient::operator==(const IPaddress &address) const
 {
 	return ((SDLNet_Read32(&address.host) == SDLNet_Read32(&_address->host) &&
@@ -24,13 +24,41 @@
 
 #include "network/TcpSocket.h"
 #include "network/TcpClient.h"
+#include "Reflectable.h"
 #include "Log.h"
 
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 using namespace	ExoEngine;
 using namespace	network;
 
-TcpSocket::TcpSocket(size_t size) : ISocket(size)
+/*
+ *	a wakeable socket keeps the read end of a pipe in its set, so wake can
+ *	interrupt a pollEvent waiting with a long timeout in another thread
+ */
+TcpSocket::TcpSocket(size_t size, bool wakeable) : ISocket(wakeable ? size + 1 : size), _highWaterMark(OUTBOUND_QUEUE_HIGH_WATER_MARK), _slowConsumer(OutboundQueue::DISCONNECT),
+	_backlog(false), _compression(false), _compressionLevel(Z_DEFAULT_COMPRESSION), _compressionMinSize(COMPRESSOR_MIN_SIZE)
 {
+	memset(&_compressionStats, 0, sizeof(_compressionStats));
+	_wakeup[0] = -1;
+	_wakeup[1] = -1;
+	_wakeupHead.ready = 0;
+	_wakeupHead.channel = -1;
+	if (!wakeable)
+		return ;
+	if (pipe(_wakeup) == -1)
+		throw (std::runtime_error(std::string("cannot create wakeup pipe: ").append(strerror(errno))));
+	_wakeupHead.channel = _wakeup[0];
+	if (fcntl(_wakeup[0], F_SETFL, O_NONBLOCK) == -1 || fcntl(_wakeup[1], F_SETFL, O_NONBLOCK) == -1
+		|| SDLNet_AddSocket(_set, (SDLNet_GenericSocket)&_wakeupHead) == -1)
+	{
+		close(_wakeup[0]);
+		close(_wakeup[1]);
+		throw (std::runtime_error("cannot add wakeup pipe to set"));
+	}
 }
 
 TcpSocket::~TcpSocket(void)
@@ -39,7 +67,7 @@ TcpSocket::~TcpSocket(void)
 
 	if (_binded)
 		unbind();
-	for (size_t i = 0; i < _clients.size(); i++)
+	for (size_t i = _clients.size(); i-- > 0; )
 	{
 		try
 		{
@@ -52,6 +80,12 @@ TcpSocket::~TcpSocket(void)
 	}
 
 	_mutex.unlock();
+	drainEvents();
+	if (_wakeup[0] != -1)
+	{
+		close(_wakeup[0]);
+		close(_wakeup[1]);
+	}
 }
 
 void	TcpSocket::bind(uint16_t port)
@@ -161,10 +195,8 @@ void	TcpSocket::connect(const std::string &address, uint16_t port)
 		_mutex.unlock();
 		throw (std::runtime_error(std::string("cannot add binded socket to set: ").append(SDLNet_GetError())));
 	}
-	newClient = new TcpClient(socket);
-	_clients.push_back(newClient);
-	if (_clientAddCb)
-		_clientAddCb(*this, _clients.back());
+	newClient = _pool.create(socket, _highWaterMark, _slowConsumer);
+	add(dynamic_cast<TcpClient *>(newClient));
 	_mutex.unlock();
 }
 
@@ -172,20 +204,16 @@ void	TcpSocket::disconnect(IClient *client)
 {
 	_mutex.lock();
 
-	for (auto tmp = _clients.begin(); tmp != _clients.end(); tmp++)
-		if (client == *tmp)
+	if (owns(client))
+	{
+		if (SDLNet_DelSocket(_set, client->getSocket()) == -1)
 		{
-			if (SDLNet_DelSocket(_set, client->getSocket()) == -1)
-			{
-				_mutex.unlock();
-				throw (std::runtime_error(std::string("cannot remove client socket from set: ").append(SDLNet_GetError())));
-			}
-			if (_clientDelCb)
-				_clientDelCb(*this, client);
-			delete client;
-			_clients.erase(tmp);
-			break ;
+			_mutex.unlock();
+			throw (std::runtime_error(std::string("cannot remove client socket from set: ").append(SDLNet_GetError())));
 		}
+		onClientDel(client);
+		release(client);
+	}
 	_mutex.unlock();
 }
 
@@ -194,18 +222,39 @@ void	TcpSocket::pollEvent(uint8_t mask)
 	TCPsocket			new_socket;
 	IClient				*new_client;
 	int					ret;
+	uint64_t			received;
 
 	_mutex.lock();
 
+	received = _counters.messagesReceived.load(std::memory_order_relaxed);
+
+	schedulePending();
+	releaseConditioned();
 	(void)mask;
-	if (!_binded && !_clients.size())
+	if (!_binded && !_clients.size() && _wakeup[0] == -1)
 		return (_mutex.unlock());
-	ret = SDLNet_CheckSockets(_set, _timeout);
+	flush();
+	//	SDL_net only waits for readable sockets, a backlog is waited for with poll then the set is only checked
+	if (_backlog && waitWritable() == -1)
+	{
+		_mutex.unlock();
+		throw (std::runtime_error(std::string("socket poll failed: ").append(strerror(errno))));
+	}
+	ret = SDLNet_CheckSockets(_set, _backlog ? 0 : pollTimeout());
 	if (ret == -1)
 	{
 		_mutex.unlock();
 		throw (std::runtime_error(std::string("socket check failed: ").append(SDLNet_GetError())));
 	}
+	if (ret > 0 && _wakeupHead.ready)
+	{
+		char	buffer[64];
+
+		while (read(_wakeup[0], buffer, sizeof(buffer)) > 0)
+			;
+		_wakeupHead.ready = 0;
+		ret--;
+	}
 	if (ret > 0)
 	{
 		while (ret > 0 && isBind() && SDLNet_SocketReady(getSocket()))
@@ -216,79 +265,285 @@ void	TcpSocket::pollEvent(uint8_t mask)
 				_mutex.unlock();
 				throw (std::runtime_error(std::string("cannot get incoming client: ").append(SDLNet_GetError())));
 			}
-			new_client = new TcpClient(new_socket);
-			if (!new_client)
+			try
+			{
+				new_client = _pool.create(new_socket, _highWaterMark, _slowConsumer);
+			}
+			catch (const std::exception &e)
 			{
+				SDLNet_TCP_Close(new_socket);
 				_mutex.unlock();
-				throw (std::runtime_error("cannot get incoming client: ran out of memory"));
+				throw (std::runtime_error(std::string("cannot get incoming client: ").append(e.what())));
 			}
 			if (SDLNet_TCP_AddSocket(_set, new_socket) == -1)
 			{
-				delete new_client;
+				_pool.destroy(dynamic_cast<TcpClient *>(new_client));
 				_mutex.unlock();
 				throw (std::runtime_error(std::string("cannot add client socket to set: ").append(SDLNet_GetError())));
 			}
-			_clients.push_back(new_client);
-			if (_clientAddCb)
-				_clientAddCb(*this, _clients.back());
+			add(dynamic_cast<TcpClient *>(new_client));
 			ret--;
 		}
-		for (auto client = _clients.begin(); client != _clients.end() && ret > 0; client++)
-			while (ret > 0 && SDLNet_SocketReady((*client)->getSocket()))
+		/*
+		 *	clients are walked by dense index, a client removed during the walk
+		 *	is replaced by the last one so the index isn't incremented
+		 */
+		for (size_t i = 0; i < _clients.size() && ret > 0; )
+		{
+			IClient			*client = _clients[i];
+			IClient::handle	handle = client->getHandle();
+
+			while (ret > 0 && SDLNet_SocketReady(client->getSocket()))
 			{
-				Message	message;
 				char	buffer[SOCKET_READ_BUFFER_SIZE];
 				int		read;
 
-				read = SDLNet_TCP_Recv((TCPsocket)(*client)->getSocket(), (void *)buffer, SOCKET_READ_BUFFER_SIZE);
+				read = SDLNet_TCP_Recv((TCPsocket)client->getSocket(), (void *)buffer, SOCKET_READ_BUFFER_SIZE);
+				ret--;
 				if (!read)
 				{
-					if (SDLNet_DelSocket(_set, (*client)->getSocket()) == -1)
+					if (SDLNet_DelSocket(_set, client->getSocket()) == -1)
 					{
 						_mutex.unlock();
 						throw (std::runtime_error(std::string("cannot remove client socket from set: ").append(SDLNet_GetError())));
 					}
-					if (_clientDelCb)
-						_clientDelCb(*this, (*client));
-					_clients.erase(client);
+					onClientDel(client);
+					release(client);
 				}
 				else if (read > 0)
 				{
-					message.append((void *)buffer, read);
-					if (_messageReceiveCb)
-						_messageReceiveCb(*this, (*client), message);
+					countReceived(client, read);
+					receive(dynamic_cast<TcpClient *>(client), buffer, read);
 				}
 				else
 				{
-					if (_clientExceptionCb)
-						_clientExceptionCb(*this, (*client));
+					onClientException(client);
+					disconnect(client);
 				}
-				ret--;
+				if (!_clients.contains(handle))
+					break ;
 			}
+			if (_clients.contains(handle))
+				i++;
+		}
 	}
+	flush();
+	countBatch(received);
 	_mutex.unlock();
 }
 
+/*
+ *	send only queues the message, it is written by the next pollEvent or
+ *	flush. It doesn't take the socket mutex, held by pollEvent while it
+ *	waits, but the lock of the client table: the client can't be released
+ *	while the message is queued and a send never waits for a poll.
+ */
 void	TcpSocket::send(IClient *client, const Message &message)
 {
-	_mutex.lock();
+	if (!client)
+	{
+		_log.error << __FUNCTION__ << " client NULL" << std::endl;
+		return ;
+	}
+	_clientsMutex.lock();
+	try
+	{
+		if (!owns(client))
+			_log.debug << __FUNCTION__ << " client already disconnected, message dropped" << std::endl;
+		else if (!condition(client, message))
+			transmit(client, message);
+	}
+	catch (const std::exception &)
+	{
+		_clientsMutex.unlock();
+		throw ;
+	}
+	_clientsMutex.unlock();
+}
 
-	int	ret;
+/*
+ *	the object is written straight into a buffer recycled by the send queue
+ *	of the client, so it is serialized once and never copied. Conditioned
+ *	and compressed sends need the message itself and take the usual path.
+ */
+void	TcpSocket::send(IClient *client, reflection::IReflectable &object)
+{
+	TcpClient	*tcp = dynamic_cast<TcpClient *>(client);
+	Message		message;
+	bool		serialize = false;
 
-	if (!client)
+	if (!tcp)
 	{
 		_log.error << __FUNCTION__ << " client NULL" << std::endl;
-		_mutex.unlock();
 		return ;
 	}
-	ret = SDLNet_TCP_Send((TCPsocket)client->getSocket(), message.getPtr(), (int)message.getSize());
-	if (ret < (int)message.getSize() && _clientExceptionCb)
-		_clientExceptionCb(*this, client);
-	if (_messageSendCb)
-		_messageSendCb(*this, client, message);
+	_clientsMutex.lock();
+	try
+	{
+		if (!owns(client))
+			_log.debug << __FUNCTION__ << " client already disconnected, message dropped" << std::endl;
+		else if (_conditioner || tcp->getCompressor())
+			serialize = true;
+		else
+		{
+			message = tcp->getOutboundQueue().acquire(object.size());
+			if (message.getSize())
+				object.write(&message[0]);
+			transmit(client, std::move(message));
+		}
+	}
+	catch (const std::exception &)
+	{
+		_clientsMutex.unlock();
+		throw ;
+	}
+	_clientsMutex.unlock();
+	//	checks the client again through send
+	if (serialize)
+		ISocket::send(client, object);
+}
+
+void	TcpSocket::transmit(IClient *client, const Message &message)
+{
+	if (!dynamic_cast<TcpClient *>(client)->queue(message))
+	{
+		countDrop(client);
+		_log.debug << "send queue of " << client->getStrAddress() << ":" << client->getStrPort() << " full, message dropped" << std::endl;
+	}
+	else
+		countSent(client, 1, 0);
+}
+
+void	TcpSocket::transmit(IClient *client, Message &&message)
+{
+	if (!dynamic_cast<TcpClient *>(client)->queue(std::move(message)))
+	{
+		countDrop(client);
+		_log.debug << "send queue of " << client->getStrAddress() << ":" << client->getStrPort() << " full, message dropped" << std::endl;
+	}
+	else
+		countSent(client, 1, 0);
+}
+
+void	TcpSocket::flush(void)
+{
+	_mutex.lock();
+
+	_backlog = false;
+	for (size_t i = 0; i < _clients.size(); )
+	{
+		IClient::handle	handle = _clients[i]->getHandle();
+
+		try
+		{
+			flush(dynamic_cast<TcpClient *>(_clients[i]));
+		}
+		catch (const std::exception &)
+		{
+			_mutex.unlock();
+			throw ;
+		}
+		if (_clients.contains(handle))
+			i++;
+	}
+
+	_mutex.unlock();
+}
+
+//	makes a pollEvent waiting in another thread return, does nothing unless the socket is wakeable
+void	TcpSocket::wake(void)
+{
+	char	byte = 0;
+
+	if (_wakeup[1] != -1 && write(_wakeup[1], &byte, sizeof(byte)) == -1 && errno != EAGAIN)
+		_log.warning << "cannot wake socket: " << strerror(errno) << std::endl;
+}
+
+/*
+ *	takes ownership of a connection accepted by another socket, so
+ *	connections can be handed to sockets polled by other threads
+ */
+IClient	*TcpSocket::adopt(TCPsocket socket)
+{
+	IClient	*client;
+
+	_mutex.lock();
+
+	if (SDLNet_TCP_AddSocket(_set, socket) == -1)
+	{
+		_mutex.unlock();
+		throw (std::runtime_error(std::string("cannot add adopted socket to set: ").append(SDLNet_GetError())));
+	}
+	try
+	{
+		client = _pool.create(socket, _highWaterMark, _slowConsumer);
+	}
+	catch (const std::exception &)
+	{
+		SDLNet_TCP_DelSocket(_set, socket);
+		_mutex.unlock();
+		throw ;
+	}
+	add(dynamic_cast<TcpClient *>(client));
+
+	_mutex.unlock();
+	return (client);
+}
+
+void	TcpSocket::setHighWaterMark(size_t highWaterMark)
+{
+	_mutex.lock();
+
+	_highWaterMark = highWaterMark;
+	for (auto client = _clients.begin(); client != _clients.end(); client++)
+		dynamic_cast<TcpClient *>(*client)->getOutboundQueue().setHighWaterMark(highWaterMark);
+
+	_mutex.unlock();
+}
+
+void	TcpSocket::setSlowConsumerPolicy(OutboundQueue::policy slowConsumer)
+{
+	_mutex.lock();
+
+	_slowConsumer = slowConsumer;
+	for (auto client = _clients.begin(); client != _clients.end(); client++)
+		dynamic_cast<TcpClient *>(*client)->getOutboundQueue().setPolicy(slowConsumer);
+
 	_mutex.unlock();
 }
 
+/*
+ *	applies to clients connected afterward, both ends of a connection must
+ *	enable it and use the same dictionary for messages to be compressed
+ */
+void	TcpSocket::setCompression(bool enable, int level, size_t minSize, const std::string &dictionary)
+{
+	_mutex.lock();
+
+	_compression = enable;
+	_compressionLevel = level;
+	_compressionMinSize = minSize;
+	_dictionary = dictionary.size() ? std::make_shared<const std::string>(dictionary) : nullptr;
+
+	_mutex.unlock();
+}
+
+//	compression counters of every client, including disconnected ones
+t_compressionStats	TcpSocket::getCompressionStats(void)
+{
+	t_compressionStats	stats;
+
+	_mutex.lock();
+
+	stats = _compressionStats;
+	for (auto client = _clients.begin(); client != _clients.end(); client++)
+		if (dynamic_cast<TcpClient *>(*client)->getCompressor())
+			dynamic_cast<TcpClient *>(*client)->getCompressor()->addStats(stats);
+
+	_mutex.unlock();
+	return (stats);
+}
+
 SDLNet_GenericSocket	TcpSocket::getSocket(void)
 {
 	SDLNet_GenericSocket	tmp;
@@ -305,3 +560,118 @@ ISocket::type	TcpSocket::getType(void) const
 {
 	return (TCP);
 }
+
+void	TcpSocket::release(IClient *client)
+{
+	_clientsMutex.lock();
+	_clients.erase(client->getHandle());
+	_clientsMutex.unlock();
+	if (!deferRelease(client))
+		destroy(client);
+}
+
+void	TcpSocket::destroy(IClient *client)
+{
+	Compressor	*compressor = dynamic_cast<TcpClient *>(client)->getCompressor();
+
+	if (compressor)
+		compressor->addStats(_compressionStats);
+	_pool.destroy(dynamic_cast<TcpClient *>(client));
+}
+
+void	TcpSocket::flush(TcpClient *client)
+{
+	OutboundQueue	&queue = client->getOutboundQueue();
+	int				written;
+
+	if (queue.overflowed())
+	{
+		_log.warning << "disconnecting slow client " << client->getStrAddress() << ":" << client->getStrPort() << std::endl;
+		disconnect(client);
+		return ;
+	}
+	if (queue.isEmpty())
+		return ;
+	written = queue.flush(client->getFd(), *this, client, _messageSendCb || _recorder ? &ISocket::messageSent : nullptr);
+	if (written == -1)
+	{
+		onClientException(client);
+		return (disconnect(client));
+	}
+	if (written)
+		countSent(client, 0, written);
+	if (!queue.isEmpty())
+		_backlog = true;
+}
+
+void	TcpSocket::add(TcpClient *client)
+{
+	if (_compression)
+	{
+		try
+		{
+			client->enableCompression(_compressionLevel, _compressionMinSize, _dictionary);
+		}
+		catch (const std::exception &e)
+		{
+			_log.error << "cannot enable compression for " << client->getStrAddress() << ":" << client->getStrPort() << ": " << e.what() << std::endl;
+		}
+	}
+	_clientsMutex.lock();
+	try
+	{
+		client->setHandle(_clients.insert(client));
+	}
+	catch (const std::exception &)
+	{
+		_clientsMutex.unlock();
+		throw ;
+	}
+	_clientsMutex.unlock();
+	onClientAdd(client);
+}
+
+/*
+ *	called with the mutex locked while a client has bytes the kernel didn't
+ *	take: every descriptor is polled for reading, the backlogged ones for
+ *	writing too, the set is then only checked without waiting
+ */
+int		TcpSocket::waitWritable(void)
+{
+	TcpClient	*client;
+
+	_polled.clear();
+	if (_binded)
+		_polled.push_back({getDescriptor(_socket), POLLIN, 0});
+	if (_wakeup[0] != -1)
+		_polled.push_back({_wakeup[0], POLLIN, 0});
+	for (size_t i = 0; i < _clients.size(); i++)
+	{
+		client = dynamic_cast<TcpClient *>(_clients[i]);
+		_polled.push_back({client->getFd(), (short)(client->getOutboundQueue().isEmpty() ? POLLIN : POLLIN | POLLOUT), 0});
+	}
+	if (poll(_polled.data(), _polled.size(), (int)pollTimeout()) == -1 && errno != EINTR)
+		return (-1);
+	return (0);
+}
+
+void	TcpSocket::receive(TcpClient *client, const char *data, size_t size)
+{
+	std::vector<Message>	messages;
+	IClient::handle			handle = client->getHandle();
+
+	if (!client->getCompressor())
+		return (onMessageReceive(client, Message(data, size)));
+	try
+	{
+		client->getCompressor()->decode(data, size, messages);
+	}
+	catch (const std::exception &e)
+	{
+		_log.error << "disconnecting " << client->getStrAddress() << ":" << client->getStrPort() << ": " << e.what() << std::endl;
+		disconnect(client);
+		return ;
+	}
+	for (auto message = messages.begin(); message != messages.end() && _clients.contains(handle); message++)
+		onMessageReceive(client, *message);
+}
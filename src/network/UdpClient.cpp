@@ -76,6 +76,16 @@ SDLNet_GenericSocket	&UdpClient::getSocket(void)
 	return ((SDLNet_GenericSocket &)_socket);
 }
 
+Fragmenter	&UdpClient::getFragmenter(void)
+{
+	return (_fragmenter);
+}
+
+Aggregator	&UdpClient::getAggregator(void)
+{
+	return (_aggregator);
+}
+
 bool	UdpClient::operator==(const IPaddress &address) const
 {
 	return ((SDLNet_Read32(&address.host) == SDLNet_Read32(&_address.host) &&
@@ -24,18 +24,42 @@
 
 #include "network/UdpSocket.h"
 #include "network/UdpClient.h"
+#include "network/SocketDescriptor.h"
 #include "Log.h"
 
+#include <string.h>
+
+#ifdef __linux__
+# include <netinet/in.h>
+# include <sys/socket.h>
+#endif
+
 using namespace	ExoEngine;
 using namespace	network;
 
-UdpSocket::UdpSocket(size_t size) : ISocket(size)
+//	mtu probes must not be fragmented by the ip layer to mean anything
+static void	dontFragment(UDPsocket socket)
+{
+#ifdef __linux__
+	int	value = IP_PMTUDISC_PROBE;
+
+	if (setsockopt(getDescriptor(socket), IPPROTO_IP, IP_MTU_DISCOVER, &value, sizeof(value)))
+		_log.debug << "cannot set the don't fragment bit, mtu probes may pass fragmented" << std::endl;
+#else
+	(void)socket;
+#endif
+}
+
+UdpSocket::UdpSocket(size_t size) : ISocket(size), _aggregation(false), _budget(0)
 {
 	_mutex.lock();
 
 	_packet = SDLNet_AllocPacket(SOCKET_READ_BUFFER_SIZE);
-	if (!_packet)
+	_output = SDLNet_AllocPacket(UDP_MTU_MAX);
+	if (!_packet || !_output)
 	{
+		if (_packet)
+			SDLNet_FreePacket(_packet);
 		_mutex.unlock();
 		throw (std::runtime_error("cannot allocate enough space for udp packet buffer"));
 	}
@@ -48,10 +72,13 @@ UdpSocket::~UdpSocket(void)
 
 	if (_binded)
 		unbind();
-	for (size_t i = 0; i < _clients.size(); i++)
+	for (size_t i = _clients.size(); i-- > 0; )
 		disconnect(_clients[i]);
 
 	_mutex.unlock();
+	drainEvents();
+	SDLNet_FreePacket(_packet);
+	SDLNet_FreePacket(_output);
 }
 
 void	UdpSocket::bind(uint16_t port)
@@ -69,6 +96,7 @@ void	UdpSocket::bind(uint16_t port)
 		_mutex.unlock();
 		throw (std::runtime_error(std::string("cannot bind socket to ").append(std::to_string(port)).append(SDLNet_GetError())));
 	}
+	dontFragment(_socket);
 	if (SDLNet_UDP_AddSocket(_set, _socket) == -1)
 	{
 		_mutex.unlock();
@@ -154,15 +182,15 @@ void	UdpSocket::connect(const std::string &address, uint16_t port)
 		_mutex.unlock();
 		throw (std::runtime_error(std::string("cannot bind udp socket to ip address: ").append(SDLNet_GetError())));
 	}
+	dontFragment(newSocket);
 	if (SDLNet_UDP_AddSocket(_set, newSocket) == -1)
 	{
 		_mutex.unlock();
 		throw (std::runtime_error(std::string("cannot add socket to set: ").append(SDLNet_GetError())));
 	}
-	newClient = new UdpClient(newSocket, ip);
-	_clients.push_back(newClient);
-	if (_clientAddCb)
-		_clientAddCb(*this, newClient);
+	newClient = _pool.create(newSocket, ip);
+	newClient->setHandle(_clients.insert(newClient));
+	onClientAdd(newClient);
 	_mutex.unlock();
 }
 
@@ -170,15 +198,11 @@ void	UdpSocket::disconnect(IClient *client)
 {
 	_mutex.lock();
 
-	for (auto tmp = _clients.begin(); tmp != _clients.end(); tmp++)
-		if (client == *tmp)
-		{
-			if (_clientDelCb)
-				_clientDelCb(*this, client);
-			delete client;
-			_clients.erase(tmp);
-			break ;
-		}
+	if (owns(client))
+	{
+		onClientDel(client);
+		release(client);
+	}
 
 	_mutex.unlock();
 }
@@ -188,13 +212,20 @@ void	UdpSocket::pollEvent(uint8_t mask)
 	IClient		*new_client;
 	int			ret, ret2;
 	bool		found;
+	uint64_t	received;
 
 	_mutex.lock();
 
+	received = _counters.messagesReceived.load(std::memory_order_relaxed);
+
+	schedulePending();
+	releaseConditioned();
 	if (!_binded && !_clients.size())
 		return _mutex.unlock();
-	(void)mask;
-	ret = SDLNet_CheckSockets(_set, _timeout);
+	maintain();
+	if (mask & SOCKET_ALLOW_WRITE)
+		flush();
+	ret = SDLNet_CheckSockets(_set, pollTimeout());
 	if (ret == -1)
 	{
 		_mutex.unlock();
@@ -212,19 +243,16 @@ void	UdpSocket::pollEvent(uint8_t mask)
 					if (_clients[i]->getAddress().host == _packet->address.host)
 					{
 						_clients[i]->updateAddress(_packet->address);
-						if (_messageReceiveCb)
-							_messageReceiveCb(*this, _clients[i], Message(_packet->data, _packet->len));
+						receive(dynamic_cast<UdpClient *>(_clients[i]), _packet->data, _packet->len);
 						found = true;
 						break ;
 					}
 				if (!found)
 				{
-					new_client = new UdpClient(_socket, _packet->address);
-					_clients.push_back(new_client);
-					if (_clientAddCb)
-						_clientAddCb(*this, new_client);
-					if (_messageReceiveCb)
-						_messageReceiveCb(*this, new_client, Message(_packet->data, _packet->len));
+					new_client = _pool.create(_socket, _packet->address);
+					new_client->setHandle(_clients.insert(new_client));
+					onClientAdd(new_client);
+					receive(dynamic_cast<UdpClient *>(new_client), _packet->data, _packet->len);
 				}
 			}
 			else if (ret2 == -1)
@@ -234,55 +262,378 @@ void	UdpSocket::pollEvent(uint8_t mask)
 			}
 			ret--;
 		}
-		for (size_t i = 0; i < _clients.size() && ret > 0; i++)
-			while (ret > 0 && SDLNet_SocketReady(_clients[i]->getSocket()))
+		//	a client removed by a callback is replaced by the last one, see TcpSocket::pollEvent
+		for (size_t i = 0; i < _clients.size() && ret > 0; )
+		{
+			IClient			*client = _clients[i];
+			IClient::handle	handle = client->getHandle();
+
+			while (ret > 0 && SDLNet_SocketReady(client->getSocket()))
 			{
-				ret2 = SDLNet_UDP_Recv((UDPsocket)_clients[i]->getSocket(), _packet);
+				ret2 = SDLNet_UDP_Recv((UDPsocket)client->getSocket(), _packet);
 				if (ret2 == 1)
-				{
-					if (_messageReceiveCb)
-						_messageReceiveCb(*this, _clients[i], Message(_packet->data, _packet->len));
-				}
+					receive(dynamic_cast<UdpClient *>(client), _packet->data, _packet->len);
 				else if (ret2 == -1)
 				{
 					_mutex.unlock();
 					throw (std::runtime_error(std::string("error while receiving udp packet: ").append(SDLNet_GetError())));
 				}
 				ret--;
+				if (!_clients.contains(handle))
+					break ;
 			}
+			if (_clients.contains(handle))
+				i++;
+		}
 	}
+	if (mask & SOCKET_ALLOW_WRITE)
+		flush();
+	countBatch(received);
 
 	_mutex.unlock();
 }
 
 void	UdpSocket::send(IClient *client, const Message &message)
 {
-	UDPpacket	packet;
+	send(client, message, 0);
+}
 
-	_mutex.lock();
+//	the priority only matters with aggregation, when a flush is over budget
+void	UdpSocket::send(IClient *client, const Message &message, uint8_t priority)
+{
+	size_t	dropped;
 
 	if (!client)
 	{
 		_log.error << __FUNCTION__ << " client NULL" << std::endl;
-		_mutex.unlock();
 		return ;
 	}
-	packet.channel = -1;
-	packet.data = (Uint8 *)message.getPtr();
-	packet.len = (int)message.getSize();
-	packet.maxlen = (int)message.getSize();
-	packet.address = client->getAddress();
-	if (SDLNet_UDP_Send((UDPsocket)client->getSocket(), -1, &packet))
-		_messageSendCb(*this, client, message);
-	else
+	//	checked before queueing, a flush can't report it to the sender
+	if (message.getSize() > UDP_MESSAGE_MAX_SIZE)
+		throw (std::invalid_argument(std::string("cannot send udp message of ").append(std::to_string(message.getSize())).append(" bytes: greater than UDP_MESSAGE_MAX_SIZE")));
+	if (condition(client, message))
+		return ;
+	_mutex.lock();
+
+	if (!_aggregation)
 	{
 		_mutex.unlock();
-		throw (std::runtime_error(std::string("cannot send udp packet: ").append(SDLNet_GetError())));
+		return (transmit(client, message));
+	}
+	dropped = dynamic_cast<UdpClient *>(client)->getAggregator().push(message, priority);
+	for (size_t i = 0; i < dropped; i++)
+		countDrop(client);
+	if (dropped)
+		_log.debug << "send queue of " << client->getStrAddress() << ":" << client->getStrPort() << " full, " << dropped << " messages dropped" << std::endl;
+
+	_mutex.unlock();
+}
+
+//	sends the queued messages of every client, called by pollEvent with SOCKET_ALLOW_WRITE
+void	UdpSocket::flush(void)
+{
+	_mutex.lock();
+
+	//	a client removed by a send callback is replaced by the last one, see TcpSocket::pollEvent
+	for (size_t i = 0; i < _clients.size(); )
+	{
+		IClient::handle	handle = _clients[i]->getHandle();
+
+		try
+		{
+			flush(dynamic_cast<UdpClient *>(_clients[i]));
+		}
+		catch (const std::exception &e)
+		{
+			_log.error << "cannot flush udp client: " << e.what() << std::endl;
+		}
+		if (_clients.contains(handle))
+			i++;
+	}
+
+	_mutex.unlock();
+}
+
+/*
+ *	messages queued and not flushed yet are still sent by the next flush,
+ *	a null budget flushes every queued message
+ */
+void	UdpSocket::setAggregation(bool enable, size_t budget)
+{
+	_mutex.lock();
+
+	_aggregation = enable;
+	_budget = budget;
+
+	_mutex.unlock();
+}
+
+/*
+ *	a message fitting in the mtu of the client goes whole, a larger one is
+ *	split in fragments of the mtu
+ */
+void	UdpSocket::transmit(IClient *client, const Message &message)
+{
+	Fragmenter				&fragmenter = dynamic_cast<UdpClient *>(client)->getFragmenter();
+	const uint8_t			*data = (const uint8_t *)message.getPtr();
+	size_t					size = message.getSize();
+	size_t					length;
+	Fragmenter::t_fragment	fragment;
+
+	if (size > UDP_MESSAGE_MAX_SIZE)
+		throw (std::invalid_argument(std::string("cannot send udp message of ").append(std::to_string(size)).append(" bytes: greater than UDP_MESSAGE_MAX_SIZE")));
+	_mutex.lock();
+
+	try
+	{
+		if (size + 1 <= fragmenter.getMtu())
+		{
+			_output->data[0] = Fragmenter::WHOLE;
+			memcpy(_output->data + 1, data, size);
+			datagram(client, size + 1);
+		}
+		else
+		{
+			fragment.id = fragmenter.nextId();
+			fragment.size = (uint16_t)(fragmenter.getMtu() - UDP_FRAGMENT_HEADER_SIZE);
+			fragment.count = (uint16_t)((size + fragment.size - 1) / fragment.size);
+			for (fragment.index = 0; fragment.index < fragment.count; fragment.index++)
+			{
+				length = std::min((size_t)fragment.size, size - (size_t)fragment.index * fragment.size);
+				Fragmenter::write(_output->data, fragment);
+				memcpy(_output->data + UDP_FRAGMENT_HEADER_SIZE, data + (size_t)fragment.index * fragment.size, length);
+				datagram(client, UDP_FRAGMENT_HEADER_SIZE + length);
+			}
+		}
 	}
+	catch (const std::exception &)
+	{
+		_mutex.unlock();
+		throw ;
+	}
+	countSent(client, 1, 0);
+	onMessageSend(client, message);
 
 	_mutex.unlock();
 }
 
+/*
+ *	packs the messages taken from the queue of the client in bundles, a
+ *	message too large for a bundle is sent on its own, fragmented if needed.
+ *	The entries are taken in a local vector so a flush run by a send
+ *	callback doesn't touch them, _entries only keeps its buffer. When a
+ *	send fails the messages left are counted as drops
+ */
+void	UdpSocket::flush(UdpClient *client)
+{
+	IClient::handle						handle = client->getHandle();
+	size_t								mtu = client->getFragmenter().getMtu();
+	size_t								size = 0;
+	size_t								first = 0;
+	size_t								length;
+	std::vector<Aggregator::t_entry>	entries;
+
+	if (client->getAggregator().isEmpty())
+		return ;
+	entries.swap(_entries);
+	client->getAggregator().take(_budget, entries);
+	try
+	{
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			length = entries[i].message.getSize();
+			if (UDP_BUNDLE_HEADER_SIZE + UDP_BUNDLE_ENTRY_SIZE + length > mtu)
+			{
+				if (!seal(client, entries, size, first, i))
+					break ;
+				size = 0;
+				first = i;
+				transmit(client, entries[i].message);
+				first = i + 1;
+				if (!_clients.contains(handle))
+					break ;
+				continue ;
+			}
+			if (size + UDP_BUNDLE_ENTRY_SIZE + length > mtu)
+			{
+				if (!seal(client, entries, size, first, i))
+					break ;
+				size = 0;
+				first = i;
+			}
+			if (!size)
+			{
+				_output->data[0] = Fragmenter::BUNDLE;
+				size = UDP_BUNDLE_HEADER_SIZE;
+			}
+			SDLNet_Write16((Uint16)length, _output->data + size);
+			memcpy(_output->data + size + UDP_BUNDLE_ENTRY_SIZE, entries[i].message.getPtr(), length);
+			size += UDP_BUNDLE_ENTRY_SIZE + length;
+			if (i + 1 == entries.size())
+				seal(client, entries, size, first, entries.size());
+		}
+	}
+	catch (const std::exception &)
+	{
+		for (size_t i = first; i < entries.size() && _clients.contains(handle); i++)
+			countDrop(client);
+		entries.clear();
+		if (_entries.capacity() < entries.capacity())
+			_entries.swap(entries);
+		throw ;
+	}
+	entries.clear();
+	if (_entries.capacity() < entries.capacity())
+		_entries.swap(entries);
+}
+
+/*
+ *	sends the bundle of entries first to last, a bundle of one message goes
+ *	whole. Returns false if a send callback removed the client.
+ */
+bool	UdpSocket::seal(UdpClient *client, const std::vector<Aggregator::t_entry> &entries, size_t size, size_t first, size_t last)
+{
+	IClient::handle	handle = client->getHandle();
+
+	if (first == last)
+		return (true);
+	if (last - first == 1)
+	{
+		memmove(_output->data + 1, _output->data + UDP_BUNDLE_HEADER_SIZE + UDP_BUNDLE_ENTRY_SIZE, size - UDP_BUNDLE_HEADER_SIZE - UDP_BUNDLE_ENTRY_SIZE);
+		_output->data[0] = Fragmenter::WHOLE;
+		size -= UDP_BUNDLE_HEADER_SIZE + UDP_BUNDLE_ENTRY_SIZE - 1;
+	}
+	datagram(client, size);
+	for (size_t i = first; i < last; i++)
+	{
+		countSent(client, 1, 0);
+		onMessageSend(client, entries[i].message);
+		if (!_clients.contains(handle))
+			return (false);
+	}
+	return (true);
+}
+
+//	sends the first size bytes of the output packet, called with the mutex locked
+void	UdpSocket::datagram(IClient *client, size_t size)
+{
+	_output->channel = -1;
+	_output->len = (int)size;
+	_output->address = client->getAddress();
+	if (!SDLNet_UDP_Send((UDPsocket)client->getSocket(), -1, _output))
+	{
+		_counters.sendErrors.fetch_add(1, std::memory_order_relaxed);
+		throw (std::runtime_error(std::string("cannot send udp packet: ").append(SDLNet_GetError())));
+	}
+	countSent(client, 0, size);
+}
+
+//	handles a datagram by its kind, called by pollEvent
+void	UdpSocket::receive(UdpClient *client, const uint8_t *data, size_t size)
+{
+	Fragmenter::t_fragment	fragment;
+	Message					message;
+
+	countReceived(client, size);
+	if (!size)
+		return ;
+	switch (data[0])
+	{
+		case Fragmenter::WHOLE:
+			onMessageReceive(client, Message(data + 1, size - 1));
+			break ;
+		case Fragmenter::FRAGMENT:
+			if (!Fragmenter::read(data, size, fragment))
+				break ;
+			if (!client->getFragmenter().add(fragment, data + UDP_FRAGMENT_HEADER_SIZE, size - UDP_FRAGMENT_HEADER_SIZE, _buffers, std::chrono::steady_clock::now(), message))
+				break ;
+			onMessageReceive(client, message);
+			_buffers.release(std::move(message));
+			break ;
+		case Fragmenter::PROBE:
+			if (size < UDP_PROBE_HEADER_SIZE || SDLNet_Read16(data + 1) != size)
+				break ;
+			_output->data[0] = Fragmenter::PROBE_ACK;
+			SDLNet_Write16((Uint16)size, _output->data + 1);
+			try
+			{
+				datagram(client, UDP_PROBE_HEADER_SIZE);
+			}
+			catch (const std::exception &e)
+			{
+				_log.debug << "cannot acknowledge mtu probe: " << e.what() << std::endl;
+			}
+			break ;
+		case Fragmenter::PROBE_ACK:
+			if (size >= UDP_PROBE_HEADER_SIZE)
+				client->getFragmenter().acknowledge(SDLNet_Read16(data + 1));
+			break ;
+		case Fragmenter::BUNDLE:
+			bundle(client, data + UDP_BUNDLE_HEADER_SIZE, size - UDP_BUNDLE_HEADER_SIZE);
+			break ;
+		default:
+			_log.debug << "unknown datagram from " << client->getStrAddress() << ":" << client->getStrPort() << " dropped" << std::endl;
+	}
+}
+
+//	delivers the messages of a bundle until one is truncated or the client is gone
+void	UdpSocket::bundle(UdpClient *client, const uint8_t *data, size_t size)
+{
+	IClient::handle	handle = client->getHandle();
+	size_t			length;
+
+	while (size >= UDP_BUNDLE_ENTRY_SIZE && _clients.contains(handle))
+	{
+		length = SDLNet_Read16(data);
+		if (UDP_BUNDLE_ENTRY_SIZE + length > size)
+		{
+			_log.debug << "truncated bundle from " << client->getStrAddress() << ":" << client->getStrPort() << " dropped" << std::endl;
+			return ;
+		}
+		onMessageReceive(client, Message(data + UDP_BUNDLE_ENTRY_SIZE, length));
+		data += UDP_BUNDLE_ENTRY_SIZE + length;
+		size -= UDP_BUNDLE_ENTRY_SIZE + length;
+	}
+}
+
+//	probes too large for the path are expected to fail, they aren't errors
+void	UdpSocket::probe(UdpClient *client, const std::vector<uint16_t> &sizes)
+{
+	for (auto size = sizes.begin(); size != sizes.end(); size++)
+	{
+		memset(_output->data, 0, *size);
+		_output->data[0] = Fragmenter::PROBE;
+		SDLNet_Write16(*size, _output->data + 1);
+		_output->channel = -1;
+		_output->len = *size;
+		_output->address = client->getAddress();
+		if (SDLNet_UDP_Send((UDPsocket)client->getSocket(), -1, _output))
+			countSent(client, 0, *size);
+	}
+}
+
+//	sends the mtu probes due and drops the messages whose fragments timed out
+void	UdpSocket::maintain(void)
+{
+	std::chrono::steady_clock::time_point	now = std::chrono::steady_clock::now();
+	std::vector<uint16_t>					sizes;
+	size_t									expired;
+
+	if (now < _maintenance)
+		return ;
+	_maintenance = now + std::chrono::milliseconds(UDP_MAINTENANCE_INTERVAL);
+	for (auto it = _clients.begin(); it != _clients.end(); it++)
+	{
+		UdpClient	*client = dynamic_cast<UdpClient *>(*it);
+
+		if (client->getFragmenter().probe(now, sizes))
+			probe(client, sizes);
+		expired = client->getFragmenter().expire(now, _buffers);
+		if (expired)
+			_log.debug << expired << " incomplete messages from " << client->getStrAddress() << ":" << client->getStrPort() << " timed out" << std::endl;
+	}
+}
+
 SDLNet_GenericSocket	UdpSocket::getSocket(void)
 {
 	SDLNet_GenericSocket	tmp;
@@ -299,3 +650,16 @@ ISocket::type	UdpSocket::getType(void) const
 {
 	return (UDP);
 }
+
+void	UdpSocket::release(IClient *client)
+{
+	_clients.erase(client->getHandle());
+	if (!deferRelease(client))
+		destroy(client);
+}
+
+void	UdpSocket::destroy(IClient *client)
+{
+	dynamic_cast<UdpClient *>(client)->getFragmenter().clear(_buffers);
+	_pool.destroy(dynamic_cast<UdpClient *>(client));
+}